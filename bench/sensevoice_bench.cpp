@@ -0,0 +1,531 @@
+// sensevoice_bench: reproducible benchmark of the recognition pipeline (AudioProcessor
+// features, Silero VAD, ASRModel inference and CTC, Tokenizer) over a fixed WAV corpus.
+// Every combination of --threads, --batch_sizes and --clip_seconds runs over the same clips
+// and the whole sweep is reported as one JSON document: throughput in audio-seconds per
+// second, request and per-stage latency percentiles from Metrics, and peak RSS per
+// configuration and for the whole process.
+//
+//   sensevoice_bench --corpus audio/ --threads 1,2,4 --batch_sizes 1,8 --clip_seconds 0,5
+
+#include "asr_model.hpp"
+#include "vad_detector.hpp"
+#include "model_downloader.hpp"
+#include "offline_transcriber.hpp"
+#include "resampler.hpp"
+#include "metrics.hpp"
+#include "ort_runtime.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+
+namespace {
+
+const int kSampleRate = 16000;
+
+struct BenchOptions {
+    std::string corpus;                       // directory of .wav files or a list file
+    std::string model_dir = "~/.cache/sensevoice";
+    std::string output_path;                  // empty: stdout
+    std::string language = "zh";
+    std::vector<int> threads = {1};           // concurrent model sessions
+    std::vector<int> batch_sizes = {1};       // clips per recognize call
+    std::vector<double> clip_seconds = {0.0}; // 0: whole files
+    int intra_op_threads = 1;
+    std::string providers = "cpu";            // execution provider preference list
+    std::string precision = "auto";           // ASR model variant
+    std::string shape_buckets;                // LFR frame counts inputs are padded to; empty: off
+    int iterations = 3;                       // timed passes over the clips per configuration
+    int warmup = 1;                           // untimed passes first
+    bool run_vad = true;
+    bool vad_gate = false;                    // energy pre-gate in front of Silero
+    bool map_models = false;                  // sessions from mmapped model files
+};
+
+struct RunResult {
+    int threads = 1;
+    int batch_size = 1;
+    double clip_seconds = 0.0;
+    size_t clips = 0;
+    double audio_seconds = 0.0;
+    double wall_seconds = 0.0;
+    LatencyHistogram::Summary request;
+    Metrics::Snapshot metrics;
+    double peak_rss_mb = -1.0;  // high-water mark during this run; < 0 if it cannot be reset
+    std::string provider;  // the one the model's sessions were placed on
+};
+
+struct VadResult {
+    double audio_seconds = 0.0;
+    double wall_seconds = 0.0;
+    bool gated = false;
+    double gated_fraction = 0.0;   // windows the energy gate kept from the model
+    LatencyHistogram::Summary window;
+};
+
+template <typename T>
+std::vector<T> parseList(const std::string& text) {
+    std::vector<T> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            values.push_back(static_cast<T>(std::atof(item.c_str())));
+        }
+    }
+    return values;
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string out;
+    out.reserve(text.size() + 2);
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buffer[8];
+                    snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    out += buffer;
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    return out;
+}
+
+// Process-wide peak seen before the kernel's high-water mark was last reset
+double process_peak_rss_mb = 0.0;
+
+// VmHWM from /proc/self/status, else ru_maxrss (which clear_refs resets along with VmHWM)
+double peakRssMb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::atof(line.c_str() + 6) / 1024.0;  // reported in kB
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_maxrss) / 1024.0;  // ru_maxrss is in KiB on Linux
+}
+
+// Starts a new high-water mark at the current RSS (Linux 4.0+); false where unsupported
+bool resetPeakRss() {
+    process_peak_rss_mb = std::max(process_peak_rss_mb, peakRssMb());
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+    clear_refs.flush();
+    return static_cast<bool>(clear_refs);
+}
+
+double processPeakRssMb() {
+    return std::max(process_peak_rss_mb, peakRssMb());
+}
+
+// Sorted so the corpus order, and with it every clip, is the same on every machine
+std::vector<std::string> listCorpus(const std::string& corpus) {
+    std::vector<std::string> paths;
+    std::error_code ec;
+    if (std::filesystem::is_directory(corpus, ec)) {
+        for (const auto& entry : std::filesystem::directory_iterator(corpus, ec)) {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            if (entry.is_regular_file() && extension == ".wav") {
+                paths.push_back(entry.path().string());
+            }
+        }
+        std::sort(paths.begin(), paths.end());
+    } else {
+        paths = OfflineTranscriber::expandInputs(corpus);
+    }
+    return paths;
+}
+
+bool loadCorpus(const std::vector<std::string>& paths, std::vector<std::vector<float>>& files) {
+    for (const auto& path : paths) {
+        std::vector<float> audio;
+        int sample_rate = 0;
+        if (!OfflineTranscriber::readAudio(path, audio, sample_rate)) {
+            return false;
+        }
+        files.push_back(Resampler::resample(audio, sample_rate, kSampleRate));
+    }
+    return !files.empty();
+}
+
+// Consecutive clips of exactly clip_seconds; a tail shorter than half a clip is dropped
+std::vector<std::vector<float>> makeClips(const std::vector<std::vector<float>>& files, double clip_seconds) {
+    if (clip_seconds <= 0.0) {
+        return files;
+    }
+    const size_t clip = static_cast<size_t>(clip_seconds * kSampleRate);
+    std::vector<std::vector<float>> clips;
+    for (const auto& audio : files) {
+        for (size_t begin = 0; begin < audio.size(); begin += clip) {
+            size_t end = std::min(audio.size(), begin + clip);
+            if (end - begin >= clip / 2) {
+                clips.emplace_back(audio.begin() + begin, audio.begin() + end);
+            }
+        }
+    }
+    return clips;
+}
+
+std::unique_ptr<ASRModel> createModel(const BenchOptions& options, const ModelDownloader& downloader,
+                                      int sessions, int max_batch) {
+    ASRModel::Config config;
+    config.execution_providers = OrtRuntime::parseProviders(options.providers);
+    std::string precision;
+    config.model_path = downloader.getAsrModelPath(
+        options.precision, OrtRuntime::isGpuProvider(OrtRuntime::firstAvailableProvider(config.execution_providers)),
+        &precision);
+    config.quantized = precision == "int8";
+    config.half_precision = precision == "fp16";
+    config.config_path = downloader.getModelPath(ModelDownloader::CONFIG_NAME);
+    config.vocab_path = downloader.getModelPath(ModelDownloader::VOCAB_NAME);
+    config.decoder_path = downloader.getModelPath(ModelDownloader::DECODER_NAME);
+    config.language = options.language;
+    config.num_sessions = sessions;
+    config.batch_size = max_batch;
+    config.intra_op_threads = options.intra_op_threads;
+    config.allow_spinning = false;  // spinning sessions would skew each other's timings
+    config.shape_buckets = ASRModel::parseShapeBuckets(options.shape_buckets);
+
+    auto model = std::make_unique<ASRModel>(config);
+    if (!model->initialize()) {
+        return nullptr;
+    }
+    return model;
+}
+
+RunResult runConfiguration(ASRModel& model, const std::vector<std::vector<float>>& clips,
+                           const BenchOptions& options, int threads, int batch_size) {
+    // Fixed groups of batch_size consecutive clips, pulled by the threads in order
+    std::vector<std::vector<std::vector<float>>> groups;
+    for (size_t begin = 0; begin < clips.size(); begin += batch_size) {
+        size_t end = std::min(clips.size(), begin + static_cast<size_t>(batch_size));
+        groups.emplace_back(clips.begin() + begin, clips.begin() + end);
+    }
+
+    // The peak includes the loaded model, which is resident when the mark is reset
+    const bool peak_reset = resetPeakRss();
+
+    LatencyHistogram request_latency;
+    auto pass = [&](bool timed) {
+        std::atomic<size_t> next{0};
+        auto worker = [&] {
+            for (size_t g = next.fetch_add(1); g < groups.size(); g = next.fetch_add(1)) {
+                auto start = std::chrono::steady_clock::now();
+                if (batch_size == 1) {
+                    model.recognize(groups[g][0].data(), groups[g][0].size());
+                } else {
+                    model.recognizeBatch(groups[g]);
+                }
+                if (timed) {
+                    request_latency.record(
+                        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads; ++t) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : pool) {
+            thread.join();
+        }
+    };
+
+    for (int i = 0; i < options.warmup; ++i) {
+        pass(false);
+    }
+
+    Metrics::instance().reset();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.iterations; ++i) {
+        pass(true);
+    }
+
+    RunResult result;
+    result.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.threads = threads;
+    result.batch_size = batch_size;
+    result.clips = clips.size();
+    for (const auto& clip : clips) {
+        result.audio_seconds += static_cast<double>(clip.size()) / kSampleRate;
+    }
+    result.audio_seconds *= options.iterations;
+    result.request = request_latency.summary();
+    result.metrics = Metrics::instance().snapshot();
+    if (peak_reset) {
+        result.peak_rss_mb = peakRssMb();
+    }
+    return result;
+}
+
+// One Silero window at a time over every file, the way the live recorder drives it
+bool runVad(const ModelDownloader& downloader, const std::vector<std::vector<float>>& files, bool gate,
+            VadResult& result) {
+    VADDetector::Config config;
+    config.model_path = downloader.getModelPath(ModelDownloader::VAD_MODEL_NAME);
+    config.history_size = 1;
+    config.pre_gate = gate;
+    VADDetector vad(config);
+    if (!vad.initialize()) {
+        return false;
+    }
+
+    const size_t window = static_cast<size_t>(config.window_size);
+    Metrics::instance().reset();
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& audio : files) {
+        vad.reset();
+        for (size_t offset = 0; offset + window <= audio.size(); offset += window) {
+            vad.detectVAD(audio.data() + offset, window);
+        }
+        result.audio_seconds += static_cast<double>(audio.size()) / kSampleRate;
+    }
+    result.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.window = Metrics::instance().snapshot().stages[static_cast<size_t>(Metrics::Stage::VADWindow)].latency;
+    result.gated = gate;
+    if (vad.getWindowsProcessed() > 0) {
+        result.gated_fraction = static_cast<double>(vad.getWindowsGated()) / vad.getWindowsProcessed();
+    }
+    return true;
+}
+
+void writeLatency(std::ostream& out, const LatencyHistogram::Summary& latency) {
+    out << "{\"count\": " << latency.count
+        << ", \"mean_ms\": " << (latency.count ? latency.sum / latency.count * 1e3 : 0.0)
+        << ", \"p50_ms\": " << latency.p50 * 1e3
+        << ", \"p95_ms\": " << latency.p95 * 1e3
+        << ", \"p99_ms\": " << latency.p99 * 1e3
+        << ", \"max_ms\": " << latency.max * 1e3 << "}";
+}
+
+void writeReport(std::ostream& out, const BenchOptions& options, size_t num_files, double corpus_seconds,
+                 const VadResult* vad, const std::vector<RunResult>& runs) {
+    struct utsname system;
+    uname(&system);
+
+    out.precision(6);
+    out << "{\n";
+    out << "  \"benchmark\": \"sensevoice_bench\",\n";
+    out << "  \"system\": {\"machine\": \"" << jsonEscape(system.machine) << "\", \"hardware_threads\": "
+        << std::thread::hardware_concurrency() << ", \"ort_api_version\": " << ORT_API_VERSION << "},\n";
+    out << "  \"settings\": {\"language\": \"" << jsonEscape(options.language) << "\", \"providers\": \""
+        << jsonEscape(options.providers) << "\", \"precision\": \"" << jsonEscape(options.precision)
+        << "\", \"shape_buckets\": \"" << jsonEscape(options.shape_buckets)
+        << "\", \"intra_op_threads\": "
+        << options.intra_op_threads << ", \"iterations\": " << options.iterations
+        << ", \"warmup\": " << options.warmup << ", \"mmap_models\": " << (options.map_models ? "true" : "false")
+        << "},\n";
+    out << "  \"corpus\": {\"files\": " << num_files << ", \"audio_seconds\": " << corpus_seconds << "},\n";
+    if (vad) {
+        out << "  \"vad\": {\"audio_seconds\": " << vad->audio_seconds << ", \"wall_seconds\": " << vad->wall_seconds
+            << ", \"rtf\": " << (vad->audio_seconds > 0.0 ? vad->wall_seconds / vad->audio_seconds : 0.0)
+            << ", \"pre_gate\": " << (vad->gated ? "true" : "false")
+            << ", \"gated_fraction\": " << vad->gated_fraction << ", \"window_latency\": ";
+        writeLatency(out, vad->window);
+        out << "},\n";
+    }
+
+    out << "  \"runs\": [";
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const RunResult& run = runs[i];
+        out << (i ? ",\n" : "\n") << "    {\"provider\": \"" << run.provider << "\", \"threads\": " << run.threads
+            << ", \"batch_size\": " << run.batch_size
+            << ", \"clip_seconds\": " << run.clip_seconds << ", \"clips\": " << run.clips
+            << ", \"audio_seconds\": " << run.audio_seconds << ", \"wall_seconds\": " << run.wall_seconds
+            << ", \"throughput\": " << (run.wall_seconds > 0.0 ? run.audio_seconds / run.wall_seconds : 0.0)
+            << ", \"rtf\": " << run.metrics.rtf << ", \"peak_rss_mb\": ";
+        if (run.peak_rss_mb < 0.0) {
+            out << "null";
+        } else {
+            out << run.peak_rss_mb;
+        }
+        out << ",\n     \"request_latency\": ";
+        writeLatency(out, run.request);
+        out << ",\n     \"stages\": {";
+        bool first = true;
+        for (const auto& stage : run.metrics.stages) {
+            if (stage.latency.count == 0) {
+                continue;
+            }
+            out << (first ? "" : ", ") << "\"" << stage.name << "\": ";
+            writeLatency(out, stage.latency);
+            first = false;
+        }
+        out << "}}";
+    }
+    out << "\n  ],\n";
+    out << "  \"peak_rss_mb\": " << processPeakRssMb() << "\n";
+    out << "}\n";
+}
+
+void printUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " --corpus <dir|list.txt> [options]" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --corpus <dir|list.txt>     WAV files to run (a directory is read in sorted order)" << std::endl;
+    std::cout << "  --model_dir <dir>           Model cache directory (default: ~/.cache/sensevoice)" << std::endl;
+    std::cout << "  --threads <n,...>           Concurrent sessions to sweep (default: 1)" << std::endl;
+    std::cout << "  --batch_sizes <n,...>       Clips per recognize call to sweep (default: 1)" << std::endl;
+    std::cout << "  --clip_seconds <s,...>      Clip lengths to cut the corpus into, 0 = whole files (default: 0)" << std::endl;
+    std::cout << "  --intra_op_threads <n>      ORT intra-op threads per session (default: 1)" << std::endl;
+    std::cout << "  --provider <list>           Execution providers to try in order (default: cpu)" << std::endl;
+    std::cout << "  --precision <type>          ASR model variant: auto, int8, fp32 or fp16 (default: auto)" << std::endl;
+    std::cout << "  --shape_buckets <n,...>     Pad inputs up to these frame counts (60ms each) (default: off)" << std::endl;
+    std::cout << "  --mmap_models               Create sessions from mmapped model files" << std::endl;
+    std::cout << "  --iterations <n>            Timed passes per configuration (default: 3)" << std::endl;
+    std::cout << "  --warmup <n>                Untimed passes per configuration (default: 1)" << std::endl;
+    std::cout << "  --language <code>           Recognition language (default: zh)" << std::endl;
+    std::cout << "  --no_vad                    Skip the Silero VAD pass" << std::endl;
+    std::cout << "  --vad_gate                  Put the energy pre-gate in front of Silero in the VAD pass" << std::endl;
+    std::cout << "  --output <file>             Write the JSON report here (default: stdout)" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--corpus" && i + 1 < argc) {
+            options.corpus = argv[++i];
+        } else if (arg == "--model_dir" && i + 1 < argc) {
+            options.model_dir = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = parseList<int>(argv[++i]);
+        } else if (arg == "--batch_sizes" && i + 1 < argc) {
+            options.batch_sizes = parseList<int>(argv[++i]);
+        } else if (arg == "--clip_seconds" && i + 1 < argc) {
+            options.clip_seconds = parseList<double>(argv[++i]);
+        } else if (arg == "--intra_op_threads" && i + 1 < argc) {
+            options.intra_op_threads = std::atoi(argv[++i]);
+        } else if (arg == "--provider" && i + 1 < argc) {
+            options.providers = argv[++i];
+        } else if (arg == "--precision" && i + 1 < argc) {
+            options.precision = argv[++i];
+        } else if (arg == "--shape_buckets" && i + 1 < argc) {
+            options.shape_buckets = argv[++i];
+        } else if (arg == "--mmap_models") {
+            options.map_models = true;
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            options.iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--language" && i + 1 < argc) {
+            options.language = argv[++i];
+        } else if (arg == "--no_vad") {
+            options.run_vad = false;
+        } else if (arg == "--vad_gate") {
+            options.vad_gate = true;
+        } else if (arg == "--output" && i + 1 < argc) {
+            options.output_path = argv[++i];
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    options.threads.erase(std::remove_if(options.threads.begin(), options.threads.end(),
+                                         [](int n) { return n < 1; }), options.threads.end());
+    options.batch_sizes.erase(std::remove_if(options.batch_sizes.begin(), options.batch_sizes.end(),
+                                             [](int n) { return n < 1; }), options.batch_sizes.end());
+    if (options.corpus.empty() || options.threads.empty() || options.batch_sizes.empty() ||
+        options.clip_seconds.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Library logging goes to stderr so stdout carries nothing but the report
+    std::streambuf* stdout_buffer = std::cout.rdbuf(std::cerr.rdbuf());
+
+    ModelDownloader::Config downloader_config;
+    downloader_config.cache_dir = options.model_dir;
+    ModelDownloader downloader(downloader_config);
+    if (!downloader.ensureModelsExist()) {
+        std::cout.rdbuf(stdout_buffer);
+        std::cerr << "Failed to ensure models exist" << std::endl;
+        return 1;
+    }
+    OrtRuntime::setModelMapping(options.map_models);
+
+    std::vector<std::string> paths = listCorpus(options.corpus);
+    std::vector<std::vector<float>> files;
+    if (!loadCorpus(paths, files)) {
+        std::cout.rdbuf(stdout_buffer);
+        std::cerr << "Failed to load corpus: " << options.corpus << std::endl;
+        return 1;
+    }
+    double corpus_seconds = 0.0;
+    for (const auto& audio : files) {
+        corpus_seconds += static_cast<double>(audio.size()) / kSampleRate;
+    }
+    std::cerr << "Corpus: " << files.size() << " files, " << corpus_seconds << "s" << std::endl;
+
+    VadResult vad;
+    bool have_vad = options.run_vad && runVad(downloader, files, options.vad_gate, vad);
+
+    const int max_batch = *std::max_element(options.batch_sizes.begin(), options.batch_sizes.end());
+    std::vector<RunResult> runs;
+    for (int threads : options.threads) {
+        auto model = createModel(options, downloader, threads, max_batch);
+        if (!model) {
+            std::cout.rdbuf(stdout_buffer);
+            std::cerr << "Failed to initialize ASR model" << std::endl;
+            return 1;
+        }
+        for (double clip_seconds : options.clip_seconds) {
+            std::vector<std::vector<float>> clips = makeClips(files, clip_seconds);
+            if (clips.empty()) {
+                continue;
+            }
+            for (int batch_size : options.batch_sizes) {
+                std::cerr << "Running threads=" << threads << " batch=" << batch_size
+                          << " clip=" << clip_seconds << "s (" << clips.size() << " clips)" << std::endl;
+                RunResult run = runConfiguration(*model, clips, options, threads, batch_size);
+                run.provider = OrtRuntime::providerName(model->getExecutionProvider());
+                run.clip_seconds = clip_seconds;
+                std::cerr << "  throughput " << run.audio_seconds / run.wall_seconds << " audio-s/s, p95 "
+                          << run.request.p95 * 1e3 << "ms" << std::endl;
+                runs.push_back(std::move(run));
+            }
+        }
+    }
+
+    std::cout.rdbuf(stdout_buffer);
+    if (options.output_path.empty()) {
+        writeReport(std::cout, options, files.size(), corpus_seconds, have_vad ? &vad : nullptr, runs);
+    } else {
+        std::ofstream out(options.output_path);
+        writeReport(out, options, files.size(), corpus_seconds, have_vad ? &vad : nullptr, runs);
+        if (!out) {
+            std::cerr << "Cannot write report: " << options.output_path << std::endl;
+            return 1;
+        }
+        std::cerr << "Report written to " << options.output_path << std::endl;
+    }
+    return 0;
+}
@@ -4,10 +4,17 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <onnxruntime_cxx_api.h>
+#include "audio_processor.hpp"
+#include "ort_runtime.hpp"
+#include "ctc_decoder.hpp"
 
-class AudioProcessor;
 class Tokenizer;
+class OnlineFeatureExtractor;
+class ResultCache;
 
 class ASRModel {
 public:
@@ -16,11 +23,93 @@ public:
         std::string config_path;
         std::string vocab_path;
         std::string decoder_path;
-        int batch_size = 1;
+        std::string cache_dir;  // startup cache (binary vocabulary); empty disables
+        int batch_size = 8;  // max utterances per session run in recognizeBatch
         int sample_rate = 16000;
         std::string language = "zh";
         bool use_itn = true;
-        bool quantized = true;
+        bool quantized = true;          // model_path is the int8 (QDQ) variant
+        bool half_precision = false;    // model_path is the fp16 variant
+        bool strip_digits = true;  // drop digit runs from the text (see Tokenizer::Config)
+        bool use_onnx_decoder = false;  // detokenize with decoder_path instead of the token table
+        bool print_performance = false; // per-call stage breakdown on stdout; Metrics always records
+        
+        // Concurrency: each session is an inference worker with its own feature scratch, so up
+        // to num_sessions recognize calls run in parallel; further callers wait for a free one
+        int num_sessions = 1;
+        int intra_op_threads = 2;          // per session, or the size of the global pool
+        int inter_op_threads = 1;
+        bool parallel_execution = false;   // ORT_PARALLEL; only pays off with inter_op_threads > 1
+        bool use_global_thread_pool = false;  // one intra-op pool in the shared OrtRuntime Env
+        bool allow_spinning = true;        // turn off when sessions outnumber spare cores
+        
+        // Execution providers in order of preference; those this ORT build lacks or that reject
+        // the model are skipped, and CPU is always the last resort. quantized / half_precision
+        // let TensorRT build matching int8 / fp16 engines.
+        std::vector<OrtRuntime::Provider> execution_providers;
+        int device_id = 0;
+        
+        // ORT intra-op affinity strings ("1,2;3;4": one entry per extra thread). With the global
+        // pool only the first entry is used; otherwise session i uses entry i % size.
+        std::vector<std::string> thread_affinities;
+        
+        // Encoder frames (60ms each) the per-session logits buffer is sized for up front;
+        // longer inputs grow it once and it is then kept
+        int preallocate_frames = 100;
+        
+        // Shape buckets (LFR frames, ascending): inputs are zero-padded up to the next bucket
+        // while speech_lengths keeps the real length, so ORT sees a few shapes and reuses
+        // their memory patterns and arena blocks. Longer inputs run unpadded. Empty disables.
+        std::vector<size_t> shape_buckets;
+        bool memory_pattern = true;        // ORT memory-pattern planning per input shape
+        
+        // Shared CPU arena of the OrtRuntime; applies process-wide, so it only takes effect
+        // if this model creates the runtime (or the runtime was created with the same values)
+        OrtRuntime::ArenaExtend arena_extend = OrtRuntime::ArenaExtend::PowerOfTwo;
+        size_t arena_max_bytes = 0;        // 0 = unbounded
+        
+        // Run every session over warmup_frames at initialize(), so the first requests do not
+        // pay for arena growth and kernel setup. Empty: the shape buckets, else 3s/6s/12s.
+        bool warmup = true;
+        std::vector<size_t> warmup_frames;
+        
+        // CTC argmax threads; only inputs of several hundred encoder frames are split
+        int decode_threads = 1;
+        
+        // Fill Result::tokens with each token's time span and confidence, taken from the CTC
+        // frames it was emitted on (one softmax per covered frame, no alignment pass)
+        bool token_timestamps = false;
+        
+        // Prefix beam search (beam_size > 1) with optional contextual biasing towards hotwords
+        int beam_size = 1;
+        int beam_top_k = 8;
+        std::vector<std::string> hotwords;
+        float hotword_weight = 1.5f;
+        
+        // Results of the last result_cache_entries distinct clips, looked up by a hash of the
+        // PCM before any feature extraction (of the features for recognizeFeaturesDetailed);
+        // byte-identical audio skips the model. 0 disables.
+        size_t result_cache_entries = 0;
+    };
+    
+    // Text token of a transcript; times are seconds from the start of the recognized audio,
+    // at the encoder's 60ms frame resolution
+    struct Token {
+        std::string text;          // vocabulary piece without the SentencePiece "▁" marker
+        bool word_start = false;   // the piece carried "▁" (a new word in spaced languages)
+        double start = 0.0;
+        double end = 0.0;
+        float confidence = 0.0f;   // mean CTC posterior over the token's frames
+    };
+    
+    // Transcript plus the rich-transcription tags SenseVoice emits ahead of the text
+    struct Result {
+        std::string text;
+        std::string language;  // detected language, e.g. "zh"
+        std::string emotion;   // e.g. "NEUTRAL"
+        std::string event;     // e.g. "Speech", "BGM"
+        bool itn = false;      // text was inverse-normalized
+        std::vector<Token> tokens;  // with Config::token_timestamps only
     };
 
     ASRModel(const Config& config);
@@ -29,20 +118,77 @@ public:
     bool initialize();
     void cleanup();
     
+    // All recognize* calls are thread-safe once initialize() has returned
     std::string recognize(const std::vector<float>& audio);
     std::string recognize(const float* audio, size_t length);
+    Result recognizeDetailed(const float* audio, size_t length);
+    
+    // Recognize precomputed LFR+CMVN features, row-major [num_frames x 560]. Tokens emitted on
+    // the first skip_frames frames (left context already transcribed) are dropped.
+    // recognizeFeatures serves overlapping streaming windows and bypasses the result cache;
+    // recognizeFeaturesDetailed is meant for whole utterances and uses it, keyed on the features.
+    std::string recognizeFeatures(const float* features, size_t num_frames, size_t skip_frames = 0);
+    Result recognizeFeaturesDetailed(const float* features, size_t num_frames, size_t skip_frames = 0);
+    
+    // Streaming front-end with this model's feature configuration
+    std::unique_ptr<OnlineFeatureExtractor> createStreamingFrontend() const;
+    
+    // Batch processing: pads utterances to [N, T_max, 560] and runs them in one session call.
+    // languages may be empty (use config language) or hold one entry per utterance. With the
+    // result cache on, only clips missing from it are run.
+    std::vector<std::string> recognizeBatch(const std::vector<std::vector<float>>& audio_batch,
+                                            const std::vector<std::string>& languages = {});
+    std::vector<Result> recognizeBatchDetailed(const std::vector<std::vector<float>>& audio_batch,
+                                               const std::vector<std::string>& languages = {});
+    
+    const std::string& getLanguage() const { return config_.language; }
+    OrtRuntime::Provider getExecutionProvider() const { return provider_; }
+    int getNumSessions() const { return static_cast<int>(workers_.size()); }
     
-    // Batch processing
-    std::vector<std::string> recognizeBatch(const std::vector<std::vector<float>>& audio_batch);
+    // Encoder input frames (LFR) an utterance of num_samples will occupy
+    size_t getFeatureFrames(size_t num_samples) const;
+    // Input length after shape bucketing
+    size_t getPaddedFrames(size_t frames) const;
+    // Comma-separated frame counts, sorted ascending; zeros and duplicates are dropped
+    static std::vector<size_t> parseShapeBuckets(const std::string& list);
+    
+    // One zero-input run per session and length (plus a full batch at the shortest length);
+    // sessions are warmed in parallel
+    void warmup(const std::vector<size_t>& frame_lengths);
 
 private:
     Config config_;
-    std::unique_ptr<Ort::Session> session_;
-    std::unique_ptr<Ort::Env> env_;
+    OrtRuntime* runtime_ = nullptr;
+    OrtRuntime::Provider provider_ = OrtRuntime::Provider::CPU;
     Ort::MemoryInfo memory_info_;
     
-    std::unique_ptr<AudioProcessor> audio_processor_;
+    // One inference worker per session; everything a recognize call mutates lives here.
+    // Inputs and outputs go through an IoBinding over buffers that are only ever grown,
+    // so a steady-state call allocates no tensor memory and CTC reads the logits in place.
+    struct Worker {
+        std::unique_ptr<Ort::Session> session;
+        std::unique_ptr<Ort::IoBinding> binding;
+        std::unique_ptr<AudioProcessor> audio_processor;
+        std::vector<float> feature_buffer;   // encoder input tensor
+        std::vector<int32_t> lengths;        // speech_lengths / language / textnorm inputs [N]
+        std::vector<int32_t> language_ids;
+        std::vector<int32_t> textnorm_ids;
+        std::vector<float> logits_buffer;    // ctc_logits output [N, T + offset, V]
+        std::vector<int32_t> out_lens32;     // encoder_out_lens output, element type per model
+        std::vector<int64_t> out_lens64;
+    };
+    class WorkerLease;
+    
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<Worker*> idle_workers_;
+    std::mutex pool_mutex_;
+    std::condition_variable pool_cv_;
+    
+    AudioProcessor::Config audio_config_;
+    int feature_dim_ = 0;
     std::unique_ptr<Tokenizer> tokenizer_;
+    std::unique_ptr<CTCDecoder> ctc_decoder_;
+    std::unique_ptr<ResultCache> result_cache_;  // kept across cleanup(); stale entries go at initialize()
     
     // Model parameters
     int blank_id_ = 0;
@@ -54,15 +200,48 @@ private:
     std::vector<const char*> output_names_;
     std::vector<std::vector<int64_t>> input_shapes_;
     std::vector<std::vector<int64_t>> output_shapes_;
+    ONNXTensorElementDataType out_lens_type_ = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
     
-    bool initializeSession();
+    // Logits layout, learned from the first run (ORT-allocated) and used to bind preallocated
+    // outputs afterwards: output frames = input frames + offset (the prepended query frames)
+    std::atomic<int> vocab_size_{0};
+    std::atomic<int> output_frame_offset_{-1};
+    
+    struct StageTimes {
+        double feature = 0.0;
+        double inference = 0.0;
+        double ctc = 0.0;
+        double detokenize = 0.0;
+    };
+    
+    bool initializeEnv();
+    bool initializeSession(size_t index, Worker& worker);
+    Worker* acquireWorker();
+    void releaseWorker(Worker* worker);
     bool loadConfig();
     void initializeLanguageMaps();
+    void initializeHotwords();
+    
+    // features holds padded_length frames, the first sequence_length of them real
+    Result inferAndDecode(Worker& worker, float* features, size_t sequence_length, size_t padded_length,
+                          size_t skip_frames, StageTimes& times);
+    void warmupRun(Worker& worker, int batch, size_t frames);
+    // Shared body of the recognizeFeatures* calls; throws on inference errors
+    Result decodeFeatures(const float* features, size_t num_frames, size_t skip_frames);
+    // Tags, text and (if enabled) timed tokens of a decoded row; frame_offset is the number of
+    // query frames the encoder prepended to its output
+    Result makeResult(CTCDecoder::Result& decoded, int frame_offset);
+    void printPerformance(const StageTimes& times, double duration, double audio_duration);
+    // Inputs are worker.lengths / language_ids / textnorm_ids, filled by the caller
+    std::vector<Ort::Value> runInference(Worker& worker, float* features, int batch, int frames, int feature_dim);
+    void bindOutputs(Worker& worker, int batch, int frames);
+    int validOutputFrames(const std::vector<Ort::Value>& outputs, size_t row, int input_frames, int padded_frames);
     
-    std::vector<float> extractFeatures(const std::vector<float>& audio);
-    std::vector<int> decodeCTC(const std::vector<float>& logits, int sequence_length);
-    std::string postProcess(const std::vector<int>& token_ids);
+    // Model file identity (path, size, mtime) and the decoding settings fixed at initialize()
+    std::string modelFingerprint() const;
+    // Per-call settings that change the result: language and ITN
+    std::string cacheSettings(const std::string& language) const;
     
-    int getLanguageId(const std::string& language);
-    int getTextnormId(bool use_itn);
+    int getLanguageId(const std::string& language) const;
+    int getTextnormId(bool use_itn) const;
 };
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class ASRModel;
+class BatchScheduler;
+class MultiStreamVAD;
+class WebSocketConnection;
+
+// WebSocket front-end for many concurrent PCM streams. Each connection is one session with
+// its own Silero slot in the shared MultiStreamVAD, an endpointing state machine, and a
+// StreamingRecognizer for partials; finished segments go through the shared BatchScheduler,
+// so utterances from different sessions are batched together on the model's session pool.
+// The scheduler runs one batch per model session at a time, so a session's finals may arrive
+// out of order; clients order them by "segment".
+//
+// Protocol (ws://host:port/?sample_rate=16000&language=zh):
+//   client -> server  binary frames of s16le mono PCM; text {"type":"end"} to flush and close
+//   server -> client  {"type":"ready"}, {"type":"partial",...}, {"type":"final",...},
+//                     {"type":"error","message":...}, {"type":"end"}
+// GET /metrics returns Metrics::prometheusText() plus server gauges, GET /healthz "ok".
+//
+// Backpressure: a session stops reading its socket (leaving TCP flow control to slow the
+// client) while its audio is more than max_backlog_seconds ahead of the VAD, while
+// max_pending_finals of its segments wait in the scheduler, or while its buffered audio
+// exceeds max_session_memory_bytes. A session stalled longer than max_stall_seconds is closed.
+class ASRServer {
+public:
+    struct Config {
+        std::string host = "0.0.0.0";
+        int port = 8765;
+        size_t max_sessions = 32;            // further upgrades get 503
+        size_t max_message_bytes = 1 << 20;  // larger frames close the session with 1009
+
+        // Endpointing on the VAD probabilities (see OfflineTranscriber::Config)
+        double trigger_threshold = 0.5;
+        double stop_threshold = 0.35;
+        double min_silence_seconds = 0.5;
+        double max_segment_seconds = 20.0;
+        double pre_speech_seconds = 0.3;     // audio kept before the trigger window
+        bool partial_results = true;
+        size_t partial_chunk_frames = 10;    // LFR frames between partials (600ms)
+
+        // Per-session limits
+        double max_backlog_seconds = 2.0;
+        size_t max_pending_finals = 2;
+        size_t max_session_memory_bytes = 8 << 20;  // buffered audio plus partial-decoding features
+        double max_stall_seconds = 30.0;
+        int socket_timeout_ms = 10000;
+    };
+
+    ASRServer(ASRModel& model, BatchScheduler& scheduler, MultiStreamVAD& vad, const Config& config);
+    ~ASRServer();
+
+    ASRServer(const ASRServer&) = delete;
+    ASRServer& operator=(const ASRServer&) = delete;
+
+    // Binds, listens and starts the accept and VAD threads
+    bool start();
+    // Closes every session and joins all threads
+    void stop();
+    bool isRunning() const { return running_.load(); }
+
+    size_t activeSessions() const { return active_sessions_.load(); }
+    std::string metricsText() const;
+
+private:
+    struct Session;
+
+    ASRModel& model_;
+    BatchScheduler& scheduler_;
+    MultiStreamVAD& vad_;
+    Config config_;
+
+    int listen_fd_ = -1;
+    std::atomic<bool> running_;
+    std::thread accept_thread_;
+    std::thread vad_thread_;
+
+    // Sessions by VAD stream id; the VAD thread routes results through this table
+    std::mutex sessions_mutex_;
+    std::condition_variable sessions_cv_;
+    std::vector<std::shared_ptr<Session>> sessions_;
+    size_t connections_ = 0;  // detached connection threads still running
+
+    std::mutex vad_mutex_;
+    std::condition_variable vad_cv_;
+    bool vad_pending_ = false;
+
+    std::atomic<size_t> active_sessions_;
+    std::atomic<uint64_t> sessions_total_;
+    std::atomic<uint64_t> sessions_rejected_;
+    std::atomic<uint64_t> backpressure_pauses_;
+    std::atomic<uint64_t> bytes_received_;
+
+    void acceptLoop();
+    void vadLoop();
+    void handleConnection(int fd);
+
+    std::shared_ptr<Session> openSession(const std::shared_ptr<WebSocketConnection>& connection,
+                                         int sample_rate, const std::string& language);
+    void closeSession(const std::shared_ptr<Session>& session);
+    void runSession(const std::shared_ptr<Session>& session);
+
+    void onVadResult(int stream_id, float probability, size_t window_index);
+    void acceptAudio(const std::shared_ptr<Session>& session, const std::string& pcm);
+    void processVadResults(const std::shared_ptr<Session>& session);
+    void processWindow(const std::shared_ptr<Session>& session, size_t window_index, float probability);
+    void endSegment(const std::shared_ptr<Session>& session);
+    bool flushSession(const std::shared_ptr<Session>& session);
+    bool shouldPause(const Session& session) const;
+    size_t sessionMemory(const Session& session) const;
+    void notifyVad();
+};
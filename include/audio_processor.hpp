@@ -5,6 +5,8 @@
 #include <complex>
 #include <cmath>
 
+struct fftwf_plan_s;
+
 class AudioProcessor {
 public:
     struct Config {
@@ -14,12 +16,24 @@ public:
         int n_mels = 80;
         int n_fft = 512;  // Changed to ensure power-of-2 for efficient FFT
         float preemphasis = 0.97f;
+        int lfr_m = 7;    // LFR: frames stacked per output frame
+        int lfr_n = 6;    // LFR: output frame hop in fbank frames
         bool apply_cmvn = true;
         std::string cmvn_file;
+        
+        // FFT planning: plans are built once in initialize() and reused for every frame
+        int fft_batch_frames = 32;     // frames transformed per batched plan execution
+        bool fft_measure = false;      // FFTW_MEASURE instead of FFTW_ESTIMATE
+        std::string fft_wisdom_file;   // optional wisdom cache, imported once per process and
+                                       // rewritten only when MEASURE planning adds wisdom
     };
 
     AudioProcessor(const Config& config);
     ~AudioProcessor();
+    
+    // Owns FFTW plans and aligned buffers
+    AudioProcessor(const AudioProcessor&) = delete;
+    AudioProcessor& operator=(const AudioProcessor&) = delete;
 
     bool initialize();
     void loadCMVN(const std::string& cmvn_file);
@@ -28,11 +42,27 @@ public:
     std::vector<std::vector<float>> extractFeatures(const std::vector<float>& audio);
     std::vector<std::vector<float>> extractFeatures(const float* audio, size_t length);
     
+    // Writes fbank+LFR+CMVN features straight into a caller-provided row-major buffer of
+    // at least getNumLFRFrames(length) * getFeatureDim() floats (e.g. an ORT input tensor).
+    // Scratch memory is reused across calls, so one processor must not be shared between threads.
+    // Returns the number of frames written, or 0 if max_frames is too small.
+    size_t extractFeatures(const float* audio, size_t length, float* output, size_t max_frames);
+    
     // Individual processing steps
     std::vector<float> preprocess(const std::vector<float>& audio);
     std::vector<std::vector<float>> computeFbank(const std::vector<float>& audio);
     std::vector<std::vector<float>> applyLFR(const std::vector<std::vector<float>>& features);
     void applyCMVN(std::vector<std::vector<float>>& features);
+    
+    // Number of LFR frames extractFeatures produces for num_samples of audio
+    size_t getNumLFRFrames(size_t num_samples) const;
+    size_t getNumFbankFrames(size_t num_samples) const;
+    int getFeatureDim() const { return config_.n_mels * config_.lfr_m; }
+    const Config& getConfig() const { return config_; }
+    
+    // Contiguous stages used by the streaming front-end (input already pre-emphasized)
+    size_t computeFbankInto(const float* signal, size_t length, float* output);
+    void applyCMVNInto(float* features, size_t num_frames);
 
 private:
     Config config_;
@@ -41,27 +71,50 @@ private:
     bool cmvn_loaded_ = false;
     std::vector<float> cmvn_mean_;
     std::vector<float> cmvn_var_;
+    std::vector<float> cmvn_inv_std_;
     
-    // Mel filterbank
-    std::vector<std::vector<float>> mel_filterbank_;
+    // Mel filterbank, stored as compact spans of each triangle's non-zero weights
+    struct MelSpan {
+        int start_bin = 0;
+        int num_bins = 0;
+        size_t weight_offset = 0;   // into mel_weights_
+    };
+    std::vector<MelSpan> mel_spans_;
+    std::vector<float> mel_weights_;
     
     // Window function
     std::vector<float> window_;
     
+    // Reusable scratch buffers (grow-only)
+    std::vector<float> signal_buffer_;
+    std::vector<float> fbank_buffer_;
+    std::vector<float> power_buffer_;          // fft_batch_frames x (n_fft/2+1)
+    
+    // Cached FFTW plans over aligned per-processor buffers; a processor is used by one thread
+    // at a time, so each worker thread gets its own scratch by owning its own processor
+    fftwf_plan_s* fft_plan_ = nullptr;         // one frame
+    fftwf_plan_s* fft_batch_plan_ = nullptr;   // fft_batch_frames frames per execution
+    float* fft_in_ = nullptr;                  // fft_batch_frames x n_fft
+    float* fft_out_ = nullptr;                 // fft_batch_frames x (n_fft/2+1) complex
+    
+    bool initializeFFT();
+    void destroyFFT();
+    void destroyPlans();  // caller holds the planner mutex
+    
     void initializeMelFilterbank();
     void initializeWindow();
     
-    // FFT and spectral processing
-    std::vector<std::complex<float>> fft(const std::vector<float>& signal);
-    std::vector<float> computePowerSpectrum(const std::vector<std::complex<float>>& fft_result);
-    std::vector<float> applyMelFilterbank(const std::vector<float>& power_spectrum);
+    // Spectral processing
+    void computePowerSpectrum(const std::complex<float>* fft_result, float* power_spectrum, size_t num_frames = 1);
+    void applyMelFilterbank(const float* power_spectrum, float* mel_features, size_t num_frames = 1);
+    
+    // Contiguous pipeline stages
+    void preemphasize(const float* audio, size_t length, float* output);
+    void computeFbankFrame(const float* frame, float* mel_features);
+    void windowFrame(const float* frame, float* fft_input);
+    void spectraToLogMel(const std::complex<float>* spectra, size_t num_frames, float* mel_features);
+    void applyLFRInto(const float* fbank, size_t num_frames, float* output);
     
     // Utility functions
-    float melScale(float freq);
-    float invMelScale(float mel);
     std::vector<float> createHammingWindow(int size);
-    
-    // Frame processing
-    std::vector<std::vector<float>> frameSignal(const std::vector<float>& signal);
-    void padFeatures(std::vector<std::vector<float>>& features, int target_length);
 };
\ No newline at end of file
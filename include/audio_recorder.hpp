@@ -6,18 +6,22 @@
 #include <thread>
 #include <atomic>
 #include <queue>
+#include <deque>
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
 #include <string>
 #include <portaudio.h>
+#include "ring_buffer.hpp"
 
 // Forward declaration
 class VADDetector;
+class Resampler;
 
 class AudioRecorder {
 public:
     using AudioCallback = std::function<void(const std::vector<float>&)>;
+    using SpeechCallback = std::function<void(const float* samples, size_t length)>;
     
     struct Config {
         int sample_rate = 16000;
@@ -28,7 +32,10 @@ public:
         double max_record_time = 5.0; // seconds
         double trigger_threshold = 0.6;
         double stop_threshold = 0.35;
-        std::string vad_type = "energy"; // "energy" or "silero"
+        std::string vad_type = "energy"; // "energy", "silero" or "cascade" (energy-gated Silero)
+        double ring_buffer_seconds = 2.0; // capture backlog the processing thread may fall behind by
+        int pre_speech_frames = 10;       // buffers of audio kept from before speech onset
+        size_t max_queued_segments = 4;   // continuous mode: oldest segment dropped beyond this
     };
 
     AudioRecorder();
@@ -47,11 +54,29 @@ public:
     bool isRecording() const { return is_recording_.load(); }
     std::vector<float> getLastRecording();
     
+    // Continuous listening: the stream stays open and every endpointed utterance is queued,
+    // so recognition of one segment overlaps capture of the next. max_record_time then
+    // bounds a single segment, measured from its speech onset.
+    bool startContinuous();
+    void stopContinuous();
+    bool isContinuous() const { return continuous_.load(); }
+    
+    // Blocks until a segment is available; returns false once stopped and drained
+    bool waitForSegment(std::vector<float>& segment);
+    size_t queuedSegments();
+    
     // Set VAD callback
     void setVADCallback(AudioCallback callback) { vad_callback_ = callback; }
     
+    // Receives recorded speech incrementally as it is appended (pre-speech buffer at onset,
+    // then every frame), so processing can overlap capture. Runs on the processing thread.
+    void setSpeechCallback(SpeechCallback callback) { speech_callback_ = callback; }
+    
     // Set VAD detector for Silero VAD
     void setVADDetector(VADDetector* vad_detector) { vad_detector_ = vad_detector; }
+    
+    // Samples dropped because the processing thread fell behind the capture callback
+    size_t getOverflowCount() const { return overflow_samples_.load(); }
 
 private:
     static int audioCallback(const void* input_buffer, void* output_buffer,
@@ -60,7 +85,16 @@ private:
                            PaStreamCallbackFlags status_flags,
                            void* user_data);
     
+    // The realtime callback only copies into capture_ring_; VAD and endpointing run on
+    // processing_thread_, which consumes one buffer of frames_per_buffer frames at a time
+    void processingThread();
     void processAudioFrame(const float* input, unsigned long frame_count);
+    void startProcessing();
+    void stopProcessing();
+    void resetCaptureState();
+    
+    // Endpoint reached: queue the segment (continuous) or end the recording; caller holds buffer_mutex_
+    void finishSegment();
     void recordingThread();
     
     Config config_;
@@ -70,11 +104,28 @@ private:
     std::atomic<bool> should_stop_;
     
     std::vector<float> audio_buffer_;
-    std::vector<float> pre_speech_buffer_;
+    CircularBuffer<float> pre_speech_buffer_;
     std::mutex buffer_mutex_;
     
+    // Capture path
+    SpscRingBuffer<float> capture_ring_;
+    std::vector<float> frame_buffer_;   // one buffer read back from the ring
+    std::thread processing_thread_;
+    std::atomic<bool> processing_running_;
+    std::atomic<size_t> overflow_samples_;
+    std::atomic<int64_t> last_callback_ns_;   // steady_clock time of the newest capture callback
+    std::mutex data_mutex_;
+    std::condition_variable data_cv_;   // stop signal for the polling processing thread
+    
+    // Endpoint notification and the continuous-mode segment queue
+    std::atomic<bool> continuous_;
+    std::deque<std::vector<float>> segments_;
+    std::mutex segment_mutex_;
+    std::condition_variable segment_cv_;
+    
     std::thread recording_thread_;
     AudioCallback vad_callback_;
+    SpeechCallback speech_callback_;
     VADDetector* vad_detector_;
     
     std::chrono::steady_clock::time_point last_speech_time_;
@@ -87,10 +138,12 @@ private:
     
     // VAD related
     bool useEnergyVAD() const { return config_.vad_type == "energy"; }
-    bool useSileroVAD() const { return config_.vad_type == "silero"; }
+    bool useSileroVAD() const { return config_.vad_type == "silero" || config_.vad_type == "cascade"; }
     float computeEnergyVAD(const float* input, unsigned long frame_count);
     float computeSileroVAD(const std::vector<float>& audio_chunk);
     
     // VAD buffer for Silero VAD (moved from static variable)
     std::vector<float> vad_buffer_;
+    std::unique_ptr<Resampler> vad_resampler_;   // capture rate -> 16kHz, null at 16kHz
+    std::vector<float> resampled_chunk_;
 };
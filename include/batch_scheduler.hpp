@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <deque>
+#include <future>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+
+class ASRModel;
+
+// Queues utterances, groups them by feature length and feeds ASRModel::recognizeBatch.
+// A bucket is flushed when it reaches max_batch_size, when adding another request would
+// exceed max_padded_frames, or when its oldest request has waited max_wait_ms.
+// Each of num_workers threads runs one batch at a time, leasing one model session for it;
+// set num_workers to the model's session count so batches use every session. Other callers
+// (e.g. streaming partials) may use the same model concurrently and share its session pool.
+class BatchScheduler {
+public:
+    using ResultCallback = std::function<void(const std::string&)>;
+
+    struct Config {
+        int max_batch_size = 8;
+        size_t max_padded_frames = 4000;   // N * T_max budget in LFR frames per batch
+        int max_wait_ms = 20;              // latency deadline of the oldest queued request
+        size_t bucket_width_frames = 32;   // utterances within this LFR length range share a bucket
+        int num_workers = 1;               // batches recognized concurrently
+    };
+
+    BatchScheduler(ASRModel& model, const Config& config);
+    ~BatchScheduler();
+
+    bool start();
+    void stop();
+    bool isRunning() const { return running_.load(); }
+
+    // Queue an utterance; an empty language uses the model's configured language. If the
+    // model call throws, the future rethrows the error and the callback gets an empty string.
+    std::future<std::string> submit(std::vector<float> audio, const std::string& language = "");
+    void submit(std::vector<float> audio, ResultCallback callback, const std::string& language = "");
+
+    size_t pendingRequests();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        std::vector<float> audio;
+        std::string language;
+        size_t frames = 0;
+        Clock::time_point deadline;
+        std::promise<std::string> promise;
+        ResultCallback callback;
+    };
+
+    ASRModel& model_;
+    Config config_;
+
+    // Buckets keyed by frames / bucket_width_frames, each in arrival order
+    std::map<size_t, std::deque<Request>> buckets_;
+    size_t pending_ = 0;
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+
+    std::vector<std::thread> worker_threads_;
+    std::atomic<bool> running_;
+
+    void enqueue(Request request);
+    void workerLoop();
+    bool bucketReady(const std::deque<Request>& bucket, Clock::time_point now) const;
+    std::vector<Request> takeBatch(std::deque<Request>& bucket);
+    void runBatch(std::vector<Request>& batch);
+    // Never throw: a callback's exception is reported and dropped
+    static void complete(Request& request, const std::string& text);
+    // Future callers receive the error; callbacks get an empty result
+    static void fail(Request& request, std::exception_ptr error);
+};
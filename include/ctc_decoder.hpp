@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+// CTC decoding of SenseVoice logits [T, V]. Greedy by default: the per-frame argmax runs
+// through simd::argmax and, for long inputs, is split over frames across a small pool of
+// threads the decoder keeps for its lifetime. With
+// beam_size > 1 a prefix beam search keeps the top_k tokens per frame, optionally biased
+// towards a hotword list compiled into a token trie. SenseVoice's rich-transcription tokens
+// (<|zh|>, <|NEUTRAL|>, <|Speech|>, <|withitn|>) are returned as structured fields instead
+// of text, so nothing downstream has to strip them. With token_spans set, every text token
+// also gets the output frames it was emitted over and its posterior, for timestamps.
+class CTCDecoder {
+public:
+    struct Config {
+        int blank_id = 0;
+        int num_threads = 1;                 // argmax threads for long inputs (num_threads - 1 pooled)
+        size_t min_frames_per_thread = 256;  // below this a thread is not worth starting
+
+        // Prefix beam search; beam_size 1 keeps greedy decoding
+        int beam_size = 1;
+        int top_k = 8;                           // non-blank tokens expanded per frame
+        float blank_skip_probability = 0.999f;   // frames this sure of blank only extend by blank
+        float hotword_weight = 1.5f;             // log-score bonus per matched hotword token
+
+        bool token_spans = false;  // fill Result::spans; one softmax per frame a token covers
+    };
+
+    // Output frames [start_frame, end_frame) a token was emitted over: its run of frames in
+    // greedy decoding, its first frame and the following frames it stays the argmax with beams
+    struct TokenSpan {
+        int start_frame = 0;
+        int end_frame = 0;
+        float confidence = 0.0f;  // mean posterior of the token over the span
+    };
+
+    struct Result {
+        std::vector<int> tokens;  // text tokens only, blanks and repeats collapsed
+        std::vector<TokenSpan> spans;  // one per token when Config::token_spans is set
+        std::string language;     // e.g. "zh", empty if the model emitted none
+        std::string emotion;      // e.g. "NEUTRAL"
+        std::string event;        // e.g. "Speech"
+        bool itn = false;         // "<|withitn|>" was emitted
+    };
+
+    enum class TokenKind : uint8_t {
+        Text,
+        Language,
+        Emotion,
+        Event,
+        TextNorm,
+        Special,  // any other <|...|> marker; dropped
+    };
+
+    explicit CTCDecoder(const Config& config);
+    ~CTCDecoder();
+
+    // Classifies every vocabulary entry once; entries are the token strings by id
+    void setVocabulary(const std::vector<std::string>& tokens);
+
+    // Token sequences to bias the beam search towards; replaces any previous list.
+    // Not thread-safe against concurrent decode().
+    void setHotwords(const std::vector<std::vector<int>>& hotwords);
+    size_t numHotwords() const { return num_hotwords_; }
+
+    // Tokens first emitted before start_frame are dropped (already transcribed left context);
+    // special tokens are reported wherever they occur
+    Result decode(const float* logits, int num_frames, int vocab_size, int start_frame = 0) const;
+
+    TokenKind kind(int id) const {
+        return id >= 0 && static_cast<size_t>(id) < kinds_.size() ? kinds_[id] : TokenKind::Text;
+    }
+
+private:
+    // Emitted token, the output frame it was first emitted on and one past its last frame
+    struct Emission {
+        int token;
+        int frame;
+        int end;
+    };
+
+    // Hotword trie over token ids; node 0 is the root, children form a sibling list.
+    // Failure links (Aho-Corasick) point at the longest proper suffix that is also a trie path,
+    // so a mismatch keeps whatever tail of the match can still grow into a hotword.
+    struct HotwordNode {
+        int token = -1;
+        int first_child = -1;
+        int next_sibling = -1;
+        int fail = 0;
+        int depth = 0;
+        int output_depth = 0;  // length of the longest hotword ending here, via failure links
+        bool terminal = false;
+    };
+    struct BeamScratch;
+    class ArgmaxPool;
+
+    Config config_;
+    std::vector<TokenKind> kinds_;
+    std::vector<std::string> names_;  // tag inside <|...|> for special tokens, empty otherwise
+    std::vector<HotwordNode> hotword_trie_;
+    size_t num_hotwords_ = 0;
+    std::unique_ptr<ArgmaxPool> argmax_pool_;  // with num_threads > 1 only
+
+    void argmaxFrames(const float* logits, int begin, int end, int vocab_size, int* best) const;
+    void greedySearch(const float* logits, int num_frames, int vocab_size, std::vector<Emission>& out) const;
+    void beamSearch(const float* logits, int num_frames, int vocab_size, std::vector<Emission>& out) const;
+    int hotwordChild(int node, int token) const;
+    int hotwordNext(int node, int token) const;  // goto with failure links; 0 if nothing matches
+    // Span of a text emission; frames up to limit that still argmax to the token extend it
+    TokenSpan tokenSpan(const float* logits, int vocab_size, const Emission& emission, int limit) const;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+// Cheap first stage in front of a neural VAD. Each window is reduced to its level in dB and
+// a zero-crossing rate, both from simd::dotProduct: energy is <x, x>, and the crossing rate
+// comes from the lag-1 autocorrelation r1 = <x[0..n-1), x[1..n)> / <x, x> as acos(r1) / pi
+// (exact for Gaussian signals, close enough to tell hiss from voicing). A noise floor follows
+// the quiet windows, falling quickly and rising slowly, and the gate opens for windows well
+// above it. Noise-like windows (high crossing rate, e.g. fricatives) need a smaller margin.
+class EnergyGate {
+public:
+    struct Config {
+        float margin_db = 9.0f;            // above the noise floor that opens the gate
+        float fricative_margin_db = 4.0f;  // margin for windows with a high crossing rate
+        float fricative_zcr = 0.3f;        // crossings per sample that count as noise-like
+        float min_floor_db = -75.0f;       // floor never tracks below digital silence
+        float floor_fall = 0.2f;           // fraction of the gap closed per quieter window
+        float floor_rise_db = 0.1f;        // per window (~3dB/s at 32ms windows)
+        int hangover_windows = 8;          // kept open after the last loud window
+    };
+
+    explicit EnergyGate(const Config& config);
+
+    void reset();
+
+    // True if the window may hold speech. speech_hint (the model's last verdict was speech)
+    // keeps the gate open and stops the floor from rising into the talker's level.
+    bool process(const float* samples, size_t length, bool speech_hint);
+
+    float noiseFloorDb() const { return floor_db_; }
+    float lastLevelDb() const { return level_db_; }
+    float lastZeroCrossingRate() const { return zcr_; }
+
+private:
+    Config config_;
+    bool initialized_ = false;
+    float floor_db_ = 0.0f;
+    float level_db_ = 0.0f;
+    float zcr_ = 0.0f;
+    int hangover_ = 0;
+};
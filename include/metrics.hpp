@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Lock-free latency histogram: log-spaced buckets (4 per octave, 1us to ~4.5min), each a
+// relaxed atomic counter, so record() is a handful of uncontended atomic adds from any thread.
+// Percentiles are interpolated within a bucket, which bounds their error to ~19%.
+class LatencyHistogram {
+public:
+    struct Summary {
+        uint64_t count = 0;
+        double sum = 0.0;  // seconds
+        double max = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+    };
+
+    // count > 1 records the same latency for several events (e.g. one batched VAD run)
+    void record(double seconds, uint64_t count = 1);
+    Summary summary() const;
+    void reset();
+
+private:
+    static constexpr int kBucketsPerOctave = 4;
+    static constexpr size_t kNumBuckets = 28 * kBucketsPerOctave + 1;
+
+    static size_t bucketIndex(double seconds);
+    static double bucketUpperBound(size_t index);
+
+    std::array<std::atomic<uint64_t>, kNumBuckets> buckets_{};
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+};
+
+// Process-wide pipeline metrics: one histogram per stage plus real-time-factor counters.
+// Everything is always recorded (the cost is a clock read and a few atomic adds); reading
+// happens through snapshot() or prometheusText(), never on the hot path.
+class Metrics {
+public:
+    enum class Stage {
+        Feature,     // fbank + LFR + CMVN for one utterance or batch
+        Inference,   // one ASR session run
+        CTC,         // CTC decode of one utterance
+        Detokenize,  // token ids to text for one utterance
+        VADWindow,   // one Silero window
+        Endpoint,    // capture callback delivering the last audio until the endpoint fires
+    };
+    static constexpr size_t kNumStages = 6;
+
+    struct StageStats {
+        const char* name;
+        LatencyHistogram::Summary latency;
+    };
+
+    struct Snapshot {
+        std::vector<StageStats> stages;
+        uint64_t utterances = 0;
+        double audio_seconds = 0.0;    // audio recognized
+        double compute_seconds = 0.0;  // wall time spent recognizing it
+        double rtf = 0.0;              // compute / audio
+        uint64_t cache_hits = 0;       // result cache lookups answered without inference
+        uint64_t cache_misses = 0;
+    };
+
+    static Metrics& instance();
+
+    void record(Stage stage, double seconds, uint64_t count = 1) {
+        histograms_[static_cast<size_t>(stage)].record(seconds, count);
+    }
+
+    // One recognized utterance (or batch row group) for the RTF counters
+    void addRecognition(double audio_seconds, double compute_seconds, uint64_t utterances = 1);
+    // One result cache lookup; hits are not counted as recognitions
+    void addCacheLookup(bool hit) {
+        (hit ? cache_hits_ : cache_misses_).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Snapshot snapshot() const;
+    // Prometheus text exposition format (summaries with 0.5/0.95/0.99 quantiles and counters)
+    std::string prometheusText() const;
+    void reset();
+
+    static const char* stageName(Stage stage);
+
+private:
+    Metrics() = default;
+
+    std::array<LatencyHistogram, kNumStages> histograms_;
+    std::atomic<uint64_t> utterances_{0};
+    std::atomic<uint64_t> audio_ns_{0};
+    std::atomic<uint64_t> compute_ns_{0};
+    std::atomic<uint64_t> cache_hits_{0};
+    std::atomic<uint64_t> cache_misses_{0};
+};
+
+// Records the time from construction to destruction into a stage histogram; elapsed, when
+// given, also receives the duration in seconds
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Metrics::Stage stage, double* elapsed = nullptr)
+        : stage_(stage), elapsed_(elapsed), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+        Metrics::instance().record(stage_, seconds);
+        if (elapsed_) {
+            *elapsed_ = seconds;
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Metrics::Stage stage_;
+    double* elapsed_;
+    std::chrono::steady_clock::time_point start_;
+};
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <map>
 #include <functional>
+#include <cstddef>
+#include <cstdint>
 
 class ModelDownloader {
 public:
@@ -11,7 +15,19 @@ public:
         std::string cache_dir = "~/.cache/sensevoice";
         std::string model_url = "https://archive.spacemit.com/spacemit-ai/openwebui/sensevoice.tar.gz";
         bool verify_checksum = false;
-        std::string expected_checksum = "";
+        std::string expected_checksum = "";  // SHA-256 of the archive, computed while it downloads
+        
+        // Range-parallel download: files are fetched as chunk_bytes ranges over up to
+        // connections transfers, and finished chunks are recorded next to the partial file
+        // so an interrupted download resumes. Servers without range support get one transfer.
+        int connections = 4;
+        size_t chunk_bytes = 8 << 20;
+        int max_retries = 3;                 // per chunk
+        
+        // Individual model files at <asset_base_url>/<name>; when set, only the missing files
+        // are fetched, and the archive is the fallback
+        std::string asset_base_url;
+        std::map<std::string, std::string> asset_checksums;  // file name -> SHA-256
     };
 
     ModelDownloader();
@@ -19,15 +35,25 @@ public:
     ~ModelDownloader();
 
     bool ensureModelsExist();
+    // Archive download, unpacked while the bytes arrive
     bool downloadModels(ProgressCallback progress_cb = nullptr);
+    // Missing files one by one from asset_base_url
+    bool downloadAssets(const std::vector<std::string>& model_names, ProgressCallback progress_cb = nullptr);
     bool extractModels(const std::string& archive_path);
     
     std::string getModelPath(const std::string& model_name) const;
+    // ASR model variant for a precision: "int8", "fp32", "fp16" or "auto" (fp16 when a GPU
+    // provider will run it, int8 otherwise). A variant missing on disk falls back to the
+    // nearest one present; selected receives the precision actually picked.
+    std::string getAsrModelPath(const std::string& precision, bool gpu, std::string* selected = nullptr) const;
+    // Derived assets (binary vocabulary, optimized ORT models) that speed up later launches
+    std::string getStartupCacheDir() const;
     bool isModelAvailable(const std::string& model_name) const;
     
     // Model file names
     static const std::string ASR_MODEL_NAME;
     static const std::string ASR_MODEL_QUANT_NAME;
+    static const std::string ASR_MODEL_FP16_NAME;  // optional, not in the default archive
     static const std::string VAD_MODEL_NAME;
     static const std::string CONFIG_NAME;
     static const std::string VOCAB_NAME;
@@ -43,18 +69,27 @@ private:
     bool fileExists(const std::string& path) const;
     size_t getFileSize(const std::string& path) const;
     
-    // cURL callbacks
-    static size_t writeCallback(void* contents, size_t size, size_t nmemb, void* userp);
-    static int progressCallback(void* clientp, double dltotal, double dlnow, 
-                               double ultotal, double ulnow);
+    // Receives a download's bytes in file order; returning false aborts it
+    using DataSink = std::function<bool(const uint8_t* data, size_t size)>;
     
-    struct DownloadData {
-        std::string* buffer;
-        ProgressCallback progress_cb;
+    struct RemoteInfo {
+        int64_t size = -1;        // -1: unknown
+        bool ranges = false;      // server advertises byte ranges
+        std::string validator;    // ETag or Last-Modified, ties resume state to one revision
     };
     
+    enum class TransferStatus { Done, Failed, NoRanges };
+    
+    bool probe(const std::string& url, RemoteInfo& info);
+    // Downloads to output_path (via output_path + ".part"), feeding sink on the way
     bool downloadFile(const std::string& url, const std::string& output_path,
-                     ProgressCallback progress_cb);
+                     ProgressCallback progress_cb, const DataSink& sink = nullptr);
+    TransferStatus downloadRanges(const std::string& url, const std::string& part_path, const RemoteInfo& info,
+                                  ProgressCallback progress_cb, const DataSink& sink);
+    bool downloadStream(const std::string& url, const std::string& part_path,
+                        ProgressCallback progress_cb, const DataSink& sink);
+    // Moves an unpacked archive (optionally inside a sensevoice/ folder) into the cache
+    bool installExtracted(const std::string& temp_dir);
     bool verifyChecksum(const std::string& file_path, const std::string& expected_checksum);
     std::string calculateSHA256(const std::string& file_path);
 };
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+#include <onnxruntime_cxx_api.h>
+
+// Silero VAD over many concurrent streams (e.g. telephone channels) with one batched
+// session run per round instead of one run per 32ms window per stream.
+// Each stream owns a slot in contiguous state [2, max_streams, 128] and context
+// [max_streams, context_size] arrays; process() gathers every stream with a full window
+// into a [B, context + window] batch, runs it once and scatters the new states back.
+class MultiStreamVAD {
+public:
+    struct Config {
+        std::string model_path;
+        int sample_rate = 16000;
+        int window_size = 512;     // 32ms at 16kHz
+        int context_size = 64;
+        size_t max_streams = 64;
+        size_t max_batch = 64;     // windows per session run
+    };
+
+    // Called from process() for every window, in stream order within a batch
+    using ResultCallback = std::function<void(int stream_id, float probability, size_t window_index)>;
+
+    explicit MultiStreamVAD(const Config& config);
+    ~MultiStreamVAD();
+
+    MultiStreamVAD(const MultiStreamVAD&) = delete;
+    MultiStreamVAD& operator=(const MultiStreamVAD&) = delete;
+
+    bool initialize();
+
+    // Returns a stream id, or -1 if all max_streams slots are in use
+    int addStream();
+    void removeStream(int stream_id);
+    void resetStream(int stream_id);
+
+    // Thread-safe; only buffers the samples
+    void pushAudio(int stream_id, const float* samples, size_t length);
+    void pushAudio(int stream_id, const std::vector<float>& samples) { pushAudio(stream_id, samples.data(), samples.size()); }
+
+    // Runs batched inference until no stream has a full window; returns windows processed.
+    // Call from one thread (e.g. a timer every window period).
+    size_t process();
+
+    void setResultCallback(ResultCallback callback) { result_callback_ = std::move(callback); }
+
+    // Probability of each stream's most recent window
+    float getLastProbability(int stream_id) const;
+    size_t numStreams() const;
+    int getSampleRate() const { return config_.sample_rate; }
+    int getWindowSize() const { return config_.window_size; }
+
+private:
+    struct Stream {
+        bool active = false;
+        uint32_t generation = 0;       // bumped on remove/reset so in-flight results are dropped
+        std::vector<float> pending;    // samples not yet consumed, from pending_offset
+        size_t pending_offset = 0;
+        size_t windows_processed = 0;
+        float last_probability = 0.0f;
+    };
+
+    Config config_;
+    std::unique_ptr<Ort::Session> session_;
+    Ort::MemoryInfo memory_info_;
+
+    std::vector<std::string> input_names_str_;
+    std::vector<std::string> output_names_str_;
+    std::vector<const char*> input_names_;
+    std::vector<const char*> output_names_;
+
+    mutable std::mutex mutex_;
+    std::vector<Stream> streams_;
+    std::vector<float> states_;      // [2, max_streams, 128]
+    std::vector<float> contexts_;    // [max_streams, context_size]
+
+    // Batch scratch, sized for max_batch at initialize()
+    std::vector<float> batch_input_;      // [B, context + window]
+    std::vector<float> batch_state_in_;   // [2, B, 128]
+    std::vector<float> batch_state_out_;
+    std::vector<float> batch_prob_;       // [B, 1]
+    std::vector<int> batch_slots_;
+    std::vector<uint32_t> batch_generations_;
+    std::vector<size_t> batch_windows_;
+    int64_t sample_rate_value_ = 16000;
+
+    ResultCallback result_callback_;
+
+    static constexpr size_t kStateSize = 128;
+
+    bool initializeSession();
+    size_t gatherBatch();
+    void scatterBatch(size_t batch);
+    void clearSlot(int slot);
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <utility>
+#include <ostream>
+#include "asr_model.hpp"
+
+class VADDetector;
+
+// File/batch transcription for long recordings: reads audio with libsndfile, cuts it into
+// speech segments with Silero VAD over the whole file, then recognizes the segments through
+// ASRModel::recognizeBatch from one thread per model session. Segments are sorted by length
+// before batching so each padded batch wastes few frames.
+class OfflineTranscriber {
+public:
+    struct Config {
+        std::string vad_model_path;        // empty: fixed-length chunks of max_segment_seconds
+        double trigger_threshold = 0.5;
+        double stop_threshold = 0.35;
+        double min_silence_seconds = 0.5;  // silence that closes a segment
+        double min_speech_seconds = 0.25;  // shorter segments are dropped
+        double max_segment_seconds = 20.0; // longer speech is split here
+        double speech_pad_seconds = 0.1;   // kept on both sides of every segment
+        size_t max_padded_frames = 4000;   // N * T_max budget in LFR frames per batch
+        int num_threads = 0;               // decode threads; 0 = one per model session
+    };
+
+    struct Segment {
+        double start = 0.0;  // seconds from the start of the file
+        double end = 0.0;
+        std::string text;
+        std::vector<ASRModel::Token> tokens;  // times from the start of the file; empty unless
+                                              // the model has token_timestamps on
+    };
+
+    OfflineTranscriber(ASRModel& model, const Config& config);
+    ~OfflineTranscriber();
+
+    bool initialize();
+
+    // Reads a mono float signal at the file's rate; multi-channel files are averaged down to mono
+    static bool readAudio(const std::string& path, std::vector<float>& audio, int& sample_rate);
+
+    // audio is 16kHz mono; transcribeFile resamples other rates first
+    std::vector<Segment> transcribe(const std::vector<float>& audio);
+    bool transcribeFile(const std::string& path, std::vector<Segment>& segments);
+
+    // Expands a list file (one path per line, '#' comments) or returns the path itself
+    static std::vector<std::string> expandInputs(const std::string& input);
+
+    // One line per segment, followed by an indented line per token when segments carry tokens
+    static void writeSegments(std::ostream& out, const std::string& path, const std::vector<Segment>& segments);
+
+private:
+    using SampleRange = std::pair<size_t, size_t>;
+
+    ASRModel& model_;
+    Config config_;
+    std::unique_ptr<VADDetector> vad_;
+
+    std::vector<SampleRange> segmentAudio(const std::vector<float>& audio);
+    std::vector<SampleRange> fixedChunks(size_t num_samples) const;
+    void decodeSegments(const std::vector<float>& audio, const std::vector<SampleRange>& ranges,
+                        std::vector<ASRModel::Result>& results);
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include "audio_processor.hpp"
+
+// Streaming front-end producing the same features as AudioProcessor::extractFeatures,
+// but from arbitrary-size PCM chunks. The pre-emphasis sample, the partial frame tail
+// and the fbank frames still needed by LFR are carried across calls, and each LFR frame
+// is emitted as soon as its lfr_m fbank frames exist. inputFinished() flushes the
+// trailing frames with the same last-frame padding as the whole-utterance path.
+class OnlineFeatureExtractor {
+public:
+    using FrameCallback = std::function<void(const float* frame, size_t dim)>;
+
+    explicit OnlineFeatureExtractor(const AudioProcessor::Config& config);
+    ~OnlineFeatureExtractor();
+
+    bool initialize();
+    void reset();
+
+    void acceptWaveform(const float* samples, size_t length);
+    void acceptWaveform(const std::vector<float>& samples) { acceptWaveform(samples.data(), samples.size()); }
+    void inputFinished();
+    bool isFinished() const { return input_finished_; }
+
+    // All LFR frames emitted since reset(), row-major [numFramesReady() x getFeatureDim()]
+    size_t numFramesReady() const { return num_lfr_frames_; }
+    const float* frames() const { return features_.data(); }
+    size_t getFeatureDim() const { return feature_dim_; }
+
+    // Called on the producing thread for every new LFR frame
+    void setFrameCallback(FrameCallback callback) { frame_callback_ = std::move(callback); }
+
+private:
+    std::unique_ptr<AudioProcessor> processor_;
+    AudioProcessor::Config config_;
+    size_t feature_dim_ = 0;
+
+    // Pre-emphasis carry-over
+    float last_sample_ = 0.0f;
+    bool has_last_sample_ = false;
+
+    // Pre-emphasized samples not yet covered by a full frame hop
+    std::vector<float> pending_samples_;
+
+    // Fbank frames [fbank_offset_, fbank_offset_ + fbank_.size() / n_mels) still needed by LFR
+    std::vector<float> fbank_;
+    size_t fbank_offset_ = 0;
+    size_t num_fbank_frames_ = 0;
+
+    // Emitted LFR+CMVN features
+    std::vector<float> features_;
+    size_t num_lfr_frames_ = 0;
+    bool input_finished_ = false;
+
+    FrameCallback frame_callback_;
+
+    void emitFrame(size_t lfr_index, size_t last_fbank_frame);
+    void trimFbank();
+};
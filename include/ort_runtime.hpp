@@ -0,0 +1,135 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <onnxruntime_cxx_api.h>
+
+class MappedFile;
+
+// Process-wide ONNX Runtime context shared by ASRModel, VADDetector and Tokenizer.
+// Owns the single Ort::Env (optionally with global thread pools), a CPU arena allocator
+// registered on the Env that every session allocates from, and a PrepackedWeightsContainer
+// so sessions of the same model share their prepacked weight buffers. With a model cache
+// directory set, the first session of each model saves ORT's optimized graph there in ORT
+// format and later launches load that file with graph optimization turned off.
+// Sessions can be placed on an execution provider from a preference list; providers this
+// ORT build lacks, or that reject the model, are skipped and CPU is always the last resort.
+// With model mapping on, model files are mmapped once and sessions are created from that
+// memory, so processes on the same host share the model pages through the page cache.
+class OrtRuntime {
+public:
+    enum class Provider {
+        CPU,
+        XNNPACK,
+        CUDA,
+        TensorRT,
+        SpacemiT,  // RISC-V EP of SpacemiT's ORT build (configure with ASR_ENABLE_SPACEMIT)
+    };
+
+    struct ProviderOptions {
+        int device_id = 0;             // CUDA / TensorRT
+        int xnnpack_threads = 1;       // XNNPACK's own pool
+        bool fp16 = false;             // TensorRT may build fp16 engines (fp16 model variant)
+        bool int8 = false;             // TensorRT runs the QDQ int8 model in int8
+    };
+
+    // Growth of the shared CPU arena (ORT's arena_extend_strategy)
+    enum class ArenaExtend {
+        PowerOfTwo = 0,       // each new chunk doubles: few allocations, up to 2x slack
+        SameAsRequested = 1,  // grow by exactly the request: tight memory, more allocations
+    };
+
+    struct Config {
+        OrtLoggingLevel log_level = ORT_LOGGING_LEVEL_WARNING;
+
+        // Global pools: sessions run on the Env's threads instead of spawning their own
+        bool use_global_thread_pool = false;
+        int intra_op_threads = 2;
+        int inter_op_threads = 1;
+        bool allow_spinning = true;
+        std::string intra_op_affinity;   // ORT affinity string for the global intra-op pool
+
+        bool share_allocator = true;         // one CPU arena for all sessions
+        ArenaExtend arena_extend = ArenaExtend::PowerOfTwo;
+        size_t arena_max_bytes = 0;          // cap on the shared arena; 0 = unbounded
+        bool share_prepacked_weights = true; // dedupe prepacked weights across sessions
+    };
+
+    // The first call creates the runtime; later calls return it unchanged and warn
+    // if they ask for a different threading or arena setup
+    static OrtRuntime& instance(const Config& config);
+    static OrtRuntime& instance();
+
+    ~OrtRuntime();
+    OrtRuntime(const OrtRuntime&) = delete;
+    OrtRuntime& operator=(const OrtRuntime&) = delete;
+
+    Ort::Env& env() { return *env_; }
+    const Config& getConfig() const { return config_; }
+    bool hasGlobalThreadPool() const { return config_.use_global_thread_pool; }
+
+    // Applies the shared thread pool and allocator settings to a session's options.
+    // Callers set their own thread counts only when hasGlobalThreadPool() is false.
+    void configureSession(Ort::SessionOptions& options) const;
+
+    // Creates a session on the shared Env, using the prepacked weights container if enabled.
+    // The runtime sets the optimization level itself, since a cached model is already optimized.
+    std::unique_ptr<Ort::Session> createSession(
+        const std::string& model_path, Ort::SessionOptions& options,
+        GraphOptimizationLevel optimization_level = GraphOptimizationLevel::ORT_ENABLE_ALL);
+
+    // Tries each provider in order (CPU appended if missing); selected reports the one used
+    std::unique_ptr<Ort::Session> createSession(
+        const std::string& model_path, Ort::SessionOptions& options,
+        GraphOptimizationLevel optimization_level, const std::vector<Provider>& providers,
+        const ProviderOptions& provider_options, Provider* selected = nullptr);
+
+    // Process-wide; takes effect for sessions created afterwards. Empty disables the cache.
+    static void setModelCacheDir(const std::string& dir);
+    // Process-wide, like the cache dir. ORT-format files (the model cache) are used in place,
+    // initializers included; .onnx files are parsed from the mapping but their weights are
+    // still copied. Models with external data files must be loaded by path.
+    static void setModelMapping(bool enabled);
+
+    // "cpu", "xnnpack", "cuda", "tensorrt", "spacemit"
+    static const char* providerName(Provider provider);
+    static bool parseProvider(const std::string& name, Provider& provider);
+    // "power_of_two" or "same_as_requested"
+    static bool parseArenaExtend(const std::string& name, ArenaExtend& extend);
+    // Comma-separated names; "auto" expands to defaultProviders(). Unknown names are reported and skipped.
+    static std::vector<Provider> parseProviders(const std::string& list);
+    static bool isProviderAvailable(Provider provider);
+    static bool isGpuProvider(Provider provider) { return provider == Provider::CUDA || provider == Provider::TensorRT; }
+    // The GPU if this build has one, then the RISC-V EP, then CPU
+    static std::vector<Provider> defaultProviders();
+    // First provider of a preference list this build has; CPU if none
+    static Provider firstAvailableProvider(const std::vector<Provider>& providers);
+
+private:
+    explicit OrtRuntime(const Config& config);
+
+    std::unique_ptr<Ort::Session> openSession(const std::string& model_path, const Ort::SessionOptions& options);
+    // Mapping of model_path, created on first use and kept for the runtime's lifetime since
+    // sessions reference it; nullptr if the file cannot be mapped
+    const MappedFile* mapModel(const std::string& model_path);
+    // Drops the path from the mapping table, so a rebuilt file is mapped afresh; the old
+    // mapping stays alive in case a session still points into it
+    void retireMapping(const std::string& model_path);
+    std::unique_ptr<Ort::Session> createCachedSession(const std::string& model_path, Ort::SessionOptions& options,
+                                                      GraphOptimizationLevel optimization_level, Provider provider);
+    // Returns false if the provider cannot be added to these options
+    static bool appendProvider(Ort::SessionOptions& options, Provider provider, const ProviderOptions& provider_options);
+    // Cache entry for this model file, optimization level and provider; empty when caching is off
+    static std::string optimizedModelPath(const std::string& model_path, GraphOptimizationLevel optimization_level,
+                                          Provider provider);
+
+    Config config_;
+    std::unique_ptr<Ort::Env> env_;
+    std::unique_ptr<Ort::PrepackedWeightsContainer> prepacked_weights_;
+    std::mutex session_mutex_;   // session creation touches the shared container and the mappings
+    std::map<std::string, std::unique_ptr<MappedFile>> mapped_models_;
+    std::vector<std::unique_ptr<MappedFile>> retired_mappings_;
+};
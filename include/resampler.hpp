@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// Streaming polyphase FIR resampler for a rational ratio L/M (input_rate * L / M = output_rate).
+// One Kaiser-windowed sinc low-pass is designed per ratio and split into L phases stored
+// time-reversed, so each output sample is a single simd::dotProduct over the input history.
+// Filter banks are built lazily, once per ratio, and shared by every instance; the first
+// resampler constructed also builds the common 48k, 44.1k and 8k to 16k banks. History
+// carries across process() calls, so chunked input gives the same output as one call over
+// the whole signal. Output sample m is aligned with input time m * M / L: the filter's
+// lookahead is held back until enough input has arrived.
+class Resampler {
+public:
+    struct Config {
+        int input_rate = 48000;
+        int output_rate = 16000;
+        int zero_crossings = 16;   // filter half-width in zero crossings of the narrower band
+        float cutoff = 0.92f;      // passband edge relative to the lower Nyquist frequency
+        double kaiser_beta = 8.0;  // ~80dB stopband
+    };
+
+    explicit Resampler(const Config& config);
+    Resampler(int input_rate, int output_rate);
+
+    // Appends the output for input[0, length) to output; no allocation once output has capacity
+    void process(const float* input, size_t length, std::vector<float>& output);
+
+    // Pushes zeros through the filter to emit the samples still held by its delay line
+    void flush(std::vector<float>& output);
+    void reset();
+
+    bool isPassthrough() const { return up_ == down_; }
+    int getInputRate() const { return config_.input_rate; }
+    int getOutputRate() const { return config_.output_rate; }
+
+    // One-shot conversion; output length is round(n * L / M)
+    static std::vector<float> resample(const std::vector<float>& input, int input_rate, int output_rate);
+
+private:
+    struct FilterBank {
+        int up = 1;
+        int down = 1;
+        size_t taps = 0;            // per phase
+        size_t center = 0;          // group delay in upsampled samples
+        std::vector<float> phases;  // [up, taps], each phase time-reversed
+    };
+
+    static std::shared_ptr<const FilterBank> getFilterBank(const Config& config, int up, int down);
+    static std::shared_ptr<FilterBank> designFilterBank(const Config& config, int up, int down);
+
+    Config config_;
+    int up_ = 1;
+    int down_ = 1;
+    std::shared_ptr<const FilterBank> bank_;
+
+    // Input history: the last taps-1 consumed samples followed by unconsumed ones
+    std::vector<float> history_;
+    size_t position_ = 0;  // history_ index of the newest sample the next output reads
+    int phase_ = 0;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+#include "asr_model.hpp"
+
+// Bounded LRU of recognition results keyed by an audio fingerprint, for traffic that repeats
+// the same clips (replayed prompts, test calls). The fingerprint hashes the PCM quantized to
+// 16 bits, so clips decoded from the same 16-bit source match even if their float conversion
+// differs in the last bits; anything else is a different clip. Results depend on the model
+// and decoding setup too: per-call settings (language, ITN) go into the key, the rest into a
+// model fingerprint that clears the cache when it changes. Thread-safe.
+class ResultCache {
+public:
+    struct Key {
+        uint64_t hash[2] = {0, 0};  // two independently seeded 64-bit hashes of the samples
+        size_t samples = 0;
+        std::string settings;
+
+        bool operator==(const Key& other) const {
+            return hash[0] == other.hash[0] && hash[1] == other.hash[1] && samples == other.samples &&
+                   settings == other.settings;
+        }
+    };
+
+    explicit ResultCache(size_t capacity) : capacity_(capacity) {}
+
+    static Key makeKey(const float* audio, size_t length, const std::string& settings);
+    // Same hash over LFR+CMVN feature values (count floats) quantized to 1/256; feature keys
+    // never match audio keys
+    static Key makeFeatureKey(const float* features, size_t count, const std::string& settings);
+
+    // Counts a hit or miss in Metrics; on a hit result receives a copy and the entry becomes
+    // the most recently used
+    bool lookup(const Key& key, ASRModel::Result& result);
+    void insert(const Key& key, const ASRModel::Result& result);
+
+    // Drops every entry if the fingerprint differs from the one the entries were made with
+    void setModelFingerprint(const std::string& fingerprint);
+    void clear();
+
+    size_t size() const;
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return static_cast<size_t>(key.hash[0] ^ std::hash<std::string>()(key.settings));
+        }
+    };
+    using Entry = std::pair<Key, ASRModel::Result>;
+
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    std::string model_fingerprint_;
+    std::list<Entry> entries_;  // most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+};
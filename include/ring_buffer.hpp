@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+
+// Wait-free single-producer/single-consumer ring buffer for trivially copyable samples.
+// Safe to write from a realtime audio callback: no locks, no allocation after construction.
+// Capacity is rounded up to a power of two; indices grow monotonically and are masked.
+template <typename T>
+class SpscRingBuffer {
+public:
+    explicit SpscRingBuffer(size_t min_capacity = 0) { resize(min_capacity); }
+
+    // Not thread-safe: only call while neither side is running
+    void resize(size_t min_capacity) {
+        size_t capacity = 1;
+        while (capacity < min_capacity) {
+            capacity <<= 1;
+        }
+        buffer_.assign(capacity, T());
+        mask_ = capacity - 1;
+        reset();
+    }
+
+    void reset() {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return buffer_.size(); }
+
+    // Producer: writes up to count items, returns how many fit
+    size_t write(const T* data, size_t count) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t n = std::min(count, buffer_.size() - (head - tail));
+
+        const size_t start = head & mask_;
+        const size_t first = std::min(n, buffer_.size() - start);
+        std::copy(data, data + first, buffer_.data() + start);
+        std::copy(data + first, data + n, buffer_.data());
+
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer: reads up to count items, returns how many were available
+    size_t read(T* data, size_t count) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        const size_t n = std::min(count, head - tail);
+
+        const size_t start = tail & mask_;
+        const size_t first = std::min(n, buffer_.size() - start);
+        std::copy(buffer_.data() + start, buffer_.data() + start + first, data);
+        std::copy(buffer_.data(), buffer_.data() + (n - first), data + first);
+
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // Items readable by the consumer
+    size_t available() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> buffer_;
+    size_t mask_ = 0;
+
+    // Producer and consumer indices on separate cache lines
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+// Fixed-capacity buffer keeping the most recent items; pushing past capacity overwrites
+// the oldest. Single-threaded; used for the pre-speech history.
+template <typename T>
+class CircularBuffer {
+public:
+    explicit CircularBuffer(size_t capacity = 0) { resize(capacity); }
+
+    void resize(size_t capacity) {
+        buffer_.assign(capacity, T());
+        clear();
+    }
+
+    void clear() {
+        start_ = 0;
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return buffer_.size(); }
+
+    void push(const T* data, size_t count) {
+        const size_t capacity = buffer_.size();
+        if (capacity == 0) {
+            return;
+        }
+        if (count >= capacity) {
+            std::copy(data + count - capacity, data + count, buffer_.data());
+            start_ = 0;
+            size_ = capacity;
+            return;
+        }
+
+        size_t end = (start_ + size_) % capacity;
+        size_t first = std::min(count, capacity - end);
+        std::copy(data, data + first, buffer_.data() + end);
+        std::copy(data + first, data + count, buffer_.data());
+
+        size_t total = size_ + count;
+        if (total > capacity) {
+            start_ = (start_ + total - capacity) % capacity;
+            size_ = capacity;
+        } else {
+            size_ = total;
+        }
+    }
+
+    // Copies the contents oldest-first into out (size() items)
+    void copyTo(T* out) const {
+        const size_t capacity = buffer_.size();
+        size_t first = std::min(size_, capacity - start_);
+        std::copy(buffer_.data() + start_, buffer_.data() + start_ + first, out);
+        std::copy(buffer_.data(), buffer_.data() + (size_ - first), out + first);
+    }
+
+private:
+    std::vector<T> buffer_;
+    size_t start_ = 0;
+    size_t size_ = 0;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Incremental SHA-256 (FIPS 180-4): feed data as it arrives, read the digest once at the end
+class Sha256 {
+public:
+    Sha256();
+
+    void reset();
+    void update(const void* data, size_t size);
+    // Lower-case hex digest; finalizes the hash, so call reset() before reusing it
+    std::string hexDigest();
+
+private:
+    void transform(const uint8_t* block);
+
+    uint32_t state_[8];
+    uint8_t buffer_[64];
+    size_t buffer_size_ = 0;
+    uint64_t total_bytes_ = 0;
+};
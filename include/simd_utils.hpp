@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+// Small vector kernels shared by the audio front-end and decoders.
+// Each kernel has NEON (aarch64), RVV (RISC-V Vector 1.0, enable with ASR_ENABLE_RVV)
+// and AVX2 (x86_64, picked at runtime) paths, with a scalar fallback.
+namespace simd {
+
+// power[i] = re^2 + im^2 for n interleaved (re, im) complex values
+void powerSpectrum(const float* complex_data, float* power, size_t n);
+
+// Sum of a[i] * b[i]
+float dotProduct(const float* a, const float* b, size_t n);
+
+// data[i] = max(data[i], min_value)
+void clampMin(float* data, size_t n, float min_value);
+
+// data[i] = ln(data[i]) for positive normal inputs (within 2 ulp of std::log); callers
+// floor the values with clampMin first
+void logInPlace(float* data, size_t n);
+
+// Index of the largest of n > 0 values (the first one on ties); its value goes to *max_value
+size_t argmax(const float* data, size_t n, float* max_value = nullptr);
+
+}  // namespace simd
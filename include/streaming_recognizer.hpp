@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "asr_model.hpp"
+#include "online_feature_extractor.hpp"
+
+// Pseudo-streaming recognition on top of the non-streaming SenseVoice encoder.
+// Audio is fed to the incremental front-end as it is captured; every chunk_frames new LFR
+// frames a background thread re-runs the encoder over the current segment (plus left
+// context) and reports a partial hypothesis. finish() flushes the front-end at endpoint
+// and reports the final result. With max_segment_frames set, long utterances are split
+// into committed segments so each re-decode stays bounded.
+class StreamingRecognizer {
+public:
+    struct Config {
+        size_t chunk_frames = 10;           // re-decode every 10 LFR frames (600ms)
+        size_t max_segment_frames = 0;      // 0 = re-decode the whole utterance each time
+        size_t left_context_frames = 10;    // context before a segment, not transcribed again
+    };
+
+    using ResultCallback = std::function<void(const std::string& text, bool is_final)>;
+
+    StreamingRecognizer(ASRModel& model, const Config& config);
+    ~StreamingRecognizer();
+
+    StreamingRecognizer(const StreamingRecognizer&) = delete;
+    StreamingRecognizer& operator=(const StreamingRecognizer&) = delete;
+
+    bool initialize();
+
+    // Starts a new utterance
+    void reset();
+
+    // Cheap enough for the capture thread: only feature extraction happens here
+    void acceptWaveform(const float* samples, size_t length);
+
+    // Endpoint: flushes the front-end, decodes the remainder and returns the final text
+    std::string finish();
+
+    void setResultCallback(ResultCallback callback) { result_callback_ = std::move(callback); }
+    std::string getPartialResult() const;
+
+    // Feature store of the current utterance plus the decode window, in bytes
+    size_t memoryBytes() const;
+
+private:
+    ASRModel& model_;
+    Config config_;
+    std::unique_ptr<OnlineFeatureExtractor> frontend_;
+    size_t feature_dim_ = 0;
+
+    // Guards the front-end and the decode state below
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+    bool running_ = false;
+    bool decode_pending_ = false;
+    bool decoding_ = false;
+    bool finishing_ = false;
+
+    size_t decoded_frames_ = 0;     // frames covered by the last partial
+    size_t segment_start_ = 0;      // first frame of the uncommitted segment
+    std::string committed_text_;
+    std::string partial_text_;
+
+    // Window copied out of the front-end so decoding runs without holding the lock (grow-only)
+    std::vector<float> window_buffer_;
+
+    ResultCallback result_callback_;
+
+    void workerLoop();
+
+    // Decodes frames [segment_start_ - context, end); caller holds lock, released while decoding
+    std::string decodeSegment(std::unique_lock<std::mutex>& lock, size_t end);
+
+    // Commits full segments once the uncommitted part exceeds max_segment_frames
+    void commitSegments(std::unique_lock<std::mutex>& lock, size_t total_frames);
+
+    static void appendText(std::string& text, const std::string& piece);
+};
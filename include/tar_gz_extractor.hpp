@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+#include <zlib.h>
+
+// Streaming .tar.gz unpacker. feed() takes the archive bytes in order, in pieces of any size
+// (e.g. straight from a download), inflates them and writes the entries below output_dir as
+// they complete, so extraction overlaps the transfer. Regular files and directories are
+// unpacked (ustar, GNU long names and pax paths); links and devices are skipped, and names
+// leaving output_dir are rejected.
+class TarGzExtractor {
+public:
+    explicit TarGzExtractor(const std::string& output_dir);
+    ~TarGzExtractor();
+
+    TarGzExtractor(const TarGzExtractor&) = delete;
+    TarGzExtractor& operator=(const TarGzExtractor&) = delete;
+
+    // False on corrupt input or a write error; see error()
+    bool feed(const uint8_t* data, size_t size);
+    // True once the gzip stream and the tar end marker (or its last entry) are complete
+    bool finish();
+
+    const std::vector<std::string>& files() const { return files_; }  // relative paths written
+    const std::string& error() const { return error_; }
+
+private:
+    enum class State { Header, Data, Skip, LongName, PaxHeader, End };
+
+    bool consumeTar(const uint8_t* data, size_t size);
+    bool parseHeader();
+    bool beginEntry(const std::string& name, char type, uint64_t size);
+    bool fail(const std::string& message);
+
+    std::string output_dir_;
+    z_stream stream_;
+    bool stream_ready_ = false;
+    bool stream_ended_ = false;
+    std::vector<uint8_t> inflated_;
+
+    State state_ = State::Header;
+    uint8_t header_[512];
+    size_t header_size_ = 0;
+    uint64_t remaining_ = 0;   // data bytes left in the current entry
+    uint64_t padding_ = 0;     // zero bytes after it, up to the next 512-byte block
+    std::string long_name_;    // from a preceding GNU 'L' or pax 'x' entry
+    std::string meta_;         // body of the 'L' / 'x' entry being read
+    std::ofstream file_;
+    int zero_blocks_ = 0;
+
+    std::vector<std::string> files_;
+    std::string error_;
+};
@@ -2,16 +2,29 @@
 
 #include <vector>
 #include <string>
-#include <unordered_map>
 #include <memory>
+#include <cstdint>
+#include <string_view>
 #include <onnxruntime_cxx_api.h>
 
+class MappedFile;
+
 class Tokenizer {
 public:
+    // How token ids become text. Table is the built-in detokenizer; OnnxDecoder runs the
+    // decoder model (token ids in, string tensor out) and is the only strategy that loads it.
+    enum class DecodeStrategy {
+        Table,
+        OnnxDecoder,
+    };
+
     struct Config {
         std::string vocab_file;
-        std::string decoder_model_path;
+        std::string vocab_cache_file;  // binary copy of vocab_file, mapped on later starts; empty disables
+        DecodeStrategy decode_strategy = DecodeStrategy::Table;
+        std::string decoder_model_path;  // used by OnnxDecoder only
         std::string ort_extensions_path = "";
+        bool strip_digits = true;  // drop digit runs and decimal scores from the text
     };
 
     Tokenizer(const Config& config);
@@ -21,24 +34,37 @@ public:
     void cleanup();
     
     std::string decode(const std::vector<int>& token_ids);
-    std::vector<int> encode(const std::string& text);
+    DecodeStrategy getDecodeStrategy() const { return config_.decode_strategy; }
+    std::vector<int> encode(const std::string& text);  // unknown pieces map to getUnkId()
     
     // Vocabulary operations
     std::string idToToken(int id) const;
+    std::string_view tokenView(int id) const;
     int tokenToId(const std::string& token) const;
     size_t getVocabSize() const { return vocab_size_; }
+    int getUnkId() const { return unk_token_id_; }
 
 private:
     Config config_;
     
     // ONNX decoder session
     std::unique_ptr<Ort::Session> decoder_session_;
-    std::unique_ptr<Ort::Env> env_;
     Ort::MemoryInfo memory_info_;
     
-    // Vocabulary
-    std::unordered_map<int, std::string> id_to_token_;
-    std::unordered_map<std::string, int> token_to_id_;
+    // Vocabulary as one id-indexed table: token id's bytes are
+    // token_blob_[token_offsets_[id], token_offsets_[id + 1]), with per-token flags and the ids
+    // sorted by bytes for lookups. The views point into vocab_image_ after parsing tokens.txt,
+    // or straight into the mapped cache file.
+    enum TokenFlags : uint8_t {
+        kTokenSkip = 1,       // <blank>, empty and <|...|> tokens produce no text
+        kTokenWordStart = 2,  // begins with the SentencePiece "▁" marker
+    };
+    std::vector<uint8_t> vocab_image_;
+    std::unique_ptr<MappedFile> vocab_mapping_;
+    const char* token_blob_ = nullptr;
+    const uint32_t* token_offsets_ = nullptr;
+    const uint32_t* sorted_ids_ = nullptr;
+    const uint8_t* token_flags_ = nullptr;
     size_t vocab_size_ = 0;
     
     // Special tokens
@@ -52,10 +78,16 @@ private:
     std::vector<const char*> output_names_;
     
     bool loadVocabulary();
+    bool parseVocabulary(uint64_t source_size, int64_t source_mtime);
+    bool mapVocabularyCache(uint64_t source_size, int64_t source_mtime);
+    void writeVocabularyCache() const;
+    void setVocabularyViews(const uint8_t* image);
+    int findToken(std::string_view token) const;  // -1 if absent
     bool initializeDecoder();
+    std::string decodeWithSession(const std::vector<int>& token_ids);
+    std::string decodeTable(const std::vector<int>& token_ids) const;
     
     // Text processing utilities
-    std::string postProcessText(const std::string& text);
+    std::string postProcessText(const std::string& text) const;
     std::vector<std::string> splitByDelimiters(const std::string& text);
-    std::string joinTokens(const std::vector<std::string>& tokens);
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <memory>
 #include <deque>
 #include <onnxruntime_cxx_api.h>
+#include "energy_gate.hpp"
 
 class VADDetector {
 public:
@@ -13,6 +14,12 @@ public:
         int window_size = 512; // 32ms at 16kHz
         int context_size = 64;
         size_t history_size = 10; // frames for smoothing
+        
+        // Cascade: EnergyGate rejects clear silence before the model runs
+        bool pre_gate = false;
+        EnergyGate::Config gate;
+        float gate_speech_threshold = 0.5f; // model probability that holds the gate open
+        int gate_replay_windows = 2;        // skipped windows run through the model on reopen
     };
 
     VADDetector(const Config& config);
@@ -24,21 +31,40 @@ public:
     
     float detectVAD(const std::vector<float>& audio);
     float detectVAD(const float* audio, size_t length);
+    
+    // Windows seen and windows the gate kept from the model, since construction
+    size_t getWindowsProcessed() const { return windows_processed_; }
+    size_t getWindowsGated() const { return windows_gated_; }
 
 private:
     Config config_;
     std::unique_ptr<Ort::Session> session_;
-    std::unique_ptr<Ort::Env> env_;
     Ort::MemoryInfo memory_info_;
     
-    // Model state
-    std::vector<float> state_h_;
-    std::vector<float> state_c_;
-    std::vector<float> context_;
+    // Model input [1, context + window]: the previous window's tail followed by the new window
+    std::vector<float> input_buffer_;
+    
+    // LSTM state (2, 1, 128), ping-ponged: each run reads one buffer and writes the other
+    std::vector<float> state_[2];
+    int current_state_ = 0;
+    int64_t sample_rate_value_ = 16000;
+    std::vector<float> prob_output_;
+    
+    // Tensors wrap the buffers above and stay bound across calls; none of them reallocates
+    std::unique_ptr<Ort::IoBinding> binding_;
+    Ort::Value state_tensors_[2];
     
     // History for smoothing
     std::deque<float> prob_history_;
     
+    // Pre-gate; the last skipped windows are kept so reopening can replay them
+    std::unique_ptr<EnergyGate> gate_;
+    std::vector<float> skipped_windows_;  // [gate_replay_windows, window_size] ring
+    size_t skipped_run_ = 0;              // consecutive windows skipped so far
+    float last_prob_ = 0.0f;              // unsmoothed, of the last window the model ran on
+    size_t windows_processed_ = 0;
+    size_t windows_gated_ = 0;
+    
     // Input/output tensor info
     std::vector<std::string> input_names_str_;
     std::vector<std::string> output_names_str_;
@@ -48,6 +74,7 @@ private:
     std::vector<std::vector<int64_t>> output_shapes_;
     
     bool initializeSession();
-    void resampleIfNeeded(const float* input, size_t input_length, 
-                         std::vector<float>& output);
+    void bindTensors();
+    float runModel(const float* audio, size_t length);
+    void resumeAfterGate();
 };
\ No newline at end of file
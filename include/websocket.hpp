@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Parsed HTTP/1.1 request head; header names are lower-cased
+struct HttpRequest {
+    std::string method;
+    std::string path;
+    std::map<std::string, std::string> query;  // percent-decoded
+    std::map<std::string, std::string> headers;
+
+    std::string header(const std::string& name) const;
+    std::string queryParam(const std::string& name, const std::string& fallback = "") const;
+    bool isWebSocketUpgrade() const;
+};
+
+// Minimal server side of RFC 6455 over an accepted TCP socket: reads the HTTP request head,
+// answers plain HTTP or completes the upgrade, then exchanges whole messages. Fragmented
+// messages are reassembled, pings are answered, and messages above max_message_bytes are
+// refused rather than buffered. Sends are serialized, so any thread may send; reads belong to
+// the thread that owns the connection. The socket is closed on destruction.
+class WebSocketConnection {
+public:
+    enum class Opcode : uint8_t {
+        Continuation = 0x0,
+        Text = 0x1,
+        Binary = 0x2,
+        Close = 0x8,
+        Ping = 0x9,
+        Pong = 0xA,
+    };
+
+    enum class ReadStatus {
+        Message,
+        Closed,   // close frame received or peer went away
+        TooBig,   // message over max_message_bytes; connection should be closed with 1009
+        Error,    // protocol violation or socket error
+    };
+
+    struct Message {
+        Opcode opcode = Opcode::Binary;
+        std::string payload;
+    };
+
+    WebSocketConnection(int fd, size_t max_message_bytes);
+    ~WebSocketConnection();
+
+    WebSocketConnection(const WebSocketConnection&) = delete;
+    WebSocketConnection& operator=(const WebSocketConnection&) = delete;
+
+    // Socket timeouts; a peer that stalls longer mid-frame or mid-send is dropped
+    void setTimeouts(int receive_ms, int send_ms);
+
+    bool readRequest(HttpRequest& request);
+    bool sendHttpResponse(int status, const std::string& reason, const std::string& content_type,
+                          const std::string& body);
+    bool acceptUpgrade(const HttpRequest& request);
+
+    // True once data is buffered or readable within timeout_ms
+    bool waitReadable(int timeout_ms);
+    ReadStatus readMessage(Message& message);
+
+    bool sendText(const std::string& text);
+    bool sendBinary(const void* data, size_t length);
+    void close(uint16_t code = 1000, const std::string& reason = "");
+
+    bool isOpen() const { return open_.load(); }
+
+private:
+    int fd_;
+    size_t max_message_bytes_;
+    std::atomic<bool> open_;
+    std::mutex send_mutex_;
+    std::string read_buffer_;  // bytes received past what has been parsed
+    size_t read_offset_ = 0;
+
+    bool readExact(void* data, size_t length);
+    bool sendAll(const char* data, size_t length);
+    bool sendFrame(Opcode opcode, const char* data, size_t length);
+};
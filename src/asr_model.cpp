@@ -1,14 +1,42 @@
 #include "asr_model.hpp"
 #include "audio_processor.hpp"
 #include "tokenizer.hpp"
+#include "online_feature_extractor.hpp"
+#include "ctc_decoder.hpp"
+#include "metrics.hpp"
+#include "result_cache.hpp"
 #include <iostream>
 #include <algorithm>
 #include <numeric>
 #include <chrono>
+#include <filesystem>
+#include <thread>
+#include <sstream>
+#include <cstdlib>
+
+// Holds one worker for the duration of a recognize call
+class ASRModel::WorkerLease {
+public:
+    explicit WorkerLease(ASRModel& model) : model_(model), worker_(model.acquireWorker()) {}
+    ~WorkerLease() { model_.releaseWorker(worker_); }
+    
+    WorkerLease(const WorkerLease&) = delete;
+    WorkerLease& operator=(const WorkerLease&) = delete;
+    
+    Worker& operator*() const { return *worker_; }
+    Worker* operator->() const { return worker_; }
+
+private:
+    ASRModel& model_;
+    Worker* worker_;
+};
 
 ASRModel::ASRModel(const Config& config)
     : config_(config), memory_info_(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)) {
     initializeLanguageMaps();
+    if (config_.result_cache_entries > 0) {
+        result_cache_ = std::make_unique<ResultCache>(config_.result_cache_entries);
+    }
 }
 
 ASRModel::~ASRModel() {
@@ -17,9 +45,7 @@ ASRModel::~ASRModel() {
 
 bool ASRModel::initialize() {
     try {
-        env_ = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "ASRModel");
-        
-        if (!initializeSession()) {
+        if (!initializeEnv()) {
             return false;
         }
         
@@ -27,26 +53,100 @@ bool ASRModel::initialize() {
             std::cerr << "Warning: Could not load config file, using defaults" << std::endl;
         }
         
-        // Initialize audio processor
-        AudioProcessor::Config audio_config;
-        audio_config.sample_rate = config_.sample_rate;
-        audio_config.cmvn_file = config_.config_path; // Assuming CMVN is in config
-        audio_processor_ = std::make_unique<AudioProcessor>(audio_config);
-        if (!audio_processor_->initialize()) {
-            std::cerr << "Failed to initialize audio processor" << std::endl;
-            return false;
+        // Audio processor settings shared by every worker and streaming front-end
+        audio_config_.sample_rate = config_.sample_rate;
+        audio_config_.cmvn_file = config_.config_path; // Assuming CMVN is in config
+        // Measured FFT plans are cached as wisdom next to the model, so only the first launch pays for planning
+        audio_config_.fft_measure = true;
+        audio_config_.fft_wisdom_file =
+            (std::filesystem::path(config_.model_path).parent_path() / "fftw_wisdom.dat").string();
+        feature_dim_ = audio_config_.n_mels * audio_config_.lfr_m;
+        
+        // One session plus private front-end scratch per worker
+        const size_t num_sessions = static_cast<size_t>(std::max(1, config_.num_sessions));
+        for (size_t i = 0; i < num_sessions; ++i) {
+            auto worker = std::make_unique<Worker>();
+            if (!initializeSession(i, *worker)) {
+                return false;
+            }
+            
+            worker->audio_processor = std::make_unique<AudioProcessor>(audio_config_);
+            if (!worker->audio_processor->initialize()) {
+                std::cerr << "Failed to initialize audio processor" << std::endl;
+                return false;
+            }
+            
+            // Grow the tensor buffers once up front instead of on the first utterances
+            size_t reserve_frames = static_cast<size_t>(std::max(0, config_.preallocate_frames));
+            worker->feature_buffer.reserve(reserve_frames * feature_dim_);
+            if (vocab_size_ > 0) {
+                worker->logits_buffer.reserve(reserve_frames * vocab_size_);
+            }
+            
+            workers_.push_back(std::move(worker));
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex_);
+            idle_workers_.clear();
+            for (auto& worker : workers_) {
+                idle_workers_.push_back(worker.get());
+            }
+        }
+        
+        if (num_sessions > 1) {
+            std::cout << "ASR model running " << num_sessions << " sessions" 
+                      << (config_.use_global_thread_pool ? " on a shared thread pool" : "") << std::endl;
         }
         
         // Initialize tokenizer
         Tokenizer::Config tokenizer_config;
         tokenizer_config.vocab_file = config_.vocab_path;
-        tokenizer_config.decoder_model_path = config_.decoder_path;
+        if (!config_.cache_dir.empty()) {
+            tokenizer_config.vocab_cache_file = (std::filesystem::path(config_.cache_dir) / "tokens.bin").string();
+        }
+        if (config_.use_onnx_decoder) {
+            tokenizer_config.decode_strategy = Tokenizer::DecodeStrategy::OnnxDecoder;
+            tokenizer_config.decoder_model_path = config_.decoder_path;
+        }
+        tokenizer_config.strip_digits = config_.strip_digits;
         tokenizer_ = std::make_unique<Tokenizer>(tokenizer_config);
         if (!tokenizer_->initialize()) {
             std::cerr << "Failed to initialize tokenizer" << std::endl;
             return false;
         }
         
+        // The decoder classifies the special tokens once, by vocabulary string
+        CTCDecoder::Config decoder_config;
+        decoder_config.blank_id = blank_id_;
+        decoder_config.num_threads = config_.decode_threads;
+        decoder_config.beam_size = config_.beam_size;
+        decoder_config.top_k = config_.beam_top_k;
+        decoder_config.hotword_weight = config_.hotword_weight;
+        decoder_config.token_spans = config_.token_timestamps;
+        ctc_decoder_ = std::make_unique<CTCDecoder>(decoder_config);
+        std::vector<std::string> vocabulary(tokenizer_->getVocabSize());
+        for (size_t id = 0; id < vocabulary.size(); ++id) {
+            vocabulary[id] = tokenizer_->idToToken(static_cast<int>(id));
+        }
+        ctc_decoder_->setVocabulary(vocabulary);
+        initializeHotwords();
+        
+        if (result_cache_) {
+            result_cache_->setModelFingerprint(modelFingerprint());
+        }
+        
+        if (config_.warmup) {
+            std::vector<size_t> frame_lengths = config_.warmup_frames;
+            if (frame_lengths.empty()) {
+                frame_lengths = config_.shape_buckets;
+            }
+            if (frame_lengths.empty()) {
+                frame_lengths = {50, 100, 200};
+            }
+            warmup(frame_lengths);
+        }
+        
         return true;
         
     } catch (const std::exception& e) {
@@ -55,45 +155,120 @@ bool ASRModel::initialize() {
     }
 }
 
-bool ASRModel::initializeSession() {
+bool ASRModel::initializeEnv() {
     try {
-        Ort::SessionOptions session_options;
-        session_options.SetIntraOpNumThreads(2);  // 增加线程数
+        // With the global pool, sessions borrow the Env's threads instead of spawning their
+        // own, so N concurrent sessions never run more than intra_op_threads compute threads
+        OrtRuntime::Config runtime_config;
+        runtime_config.use_global_thread_pool = config_.use_global_thread_pool;
+        runtime_config.intra_op_threads = config_.intra_op_threads;
+        runtime_config.inter_op_threads = config_.inter_op_threads;
+        runtime_config.allow_spinning = config_.allow_spinning;
+        runtime_config.arena_extend = config_.arena_extend;
+        runtime_config.arena_max_bytes = config_.arena_max_bytes;
+        if (!config_.thread_affinities.empty()) {
+            runtime_config.intra_op_affinity = config_.thread_affinities[0];
+        }
+        
+        runtime_ = &OrtRuntime::instance(runtime_config);
+        return true;
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to create ONNX Runtime environment: " << e.what() << std::endl;
+        return false;
+    }
+}
 
-        session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
-        session_options.SetExecutionMode(ExecutionMode::ORT_PARALLEL);  // 并行执行模式
+bool ASRModel::initializeSession(size_t index, Worker& worker) {
+    try {
+        Ort::SessionOptions session_options;
+        session_options.SetExecutionMode(config_.parallel_execution ? ExecutionMode::ORT_PARALLEL
+                                                                    : ExecutionMode::ORT_SEQUENTIAL);
         
-        session_ = std::make_unique<Ort::Session>(*env_, config_.model_path.c_str(), session_options);
+        runtime_->configureSession(session_options);
+        if (!config_.memory_pattern) {
+            session_options.DisableMemPattern();
+        }
+        if (!runtime_->hasGlobalThreadPool()) {
+            session_options.SetIntraOpNumThreads(std::max(1, config_.intra_op_threads));
+            session_options.SetInterOpNumThreads(std::max(1, config_.inter_op_threads));
+            session_options.AddConfigEntry("session.intra_op.allow_spinning", config_.allow_spinning ? "1" : "0");
+            session_options.AddConfigEntry("session.inter_op.allow_spinning", config_.allow_spinning ? "1" : "0");
+            if (!config_.thread_affinities.empty()) {
+                const std::string& affinity = config_.thread_affinities[index % config_.thread_affinities.size()];
+                if (!affinity.empty()) {
+                    session_options.AddConfigEntry("session.intra_op_thread_affinities", affinity.c_str());
+                }
+            }
+        }
+        
+        OrtRuntime::ProviderOptions provider_options;
+        provider_options.device_id = config_.device_id;
+        provider_options.xnnpack_threads = std::max(1, config_.intra_op_threads);
+        provider_options.int8 = config_.quantized;
+        provider_options.fp16 = config_.half_precision;
+        
+        // Sessions of the same model share prepacked weights through the runtime; the
+        // optimized graph comes from the runtime's model cache when one is set
+        OrtRuntime::Provider provider = OrtRuntime::Provider::CPU;
+        worker.session = runtime_->createSession(config_.model_path, session_options,
+                                                 GraphOptimizationLevel::ORT_ENABLE_ALL,
+                                                 config_.execution_providers, provider_options, &provider);
+        if (!worker.session) {
+            std::cerr << "Failed to create ASR session" << std::endl;
+            return false;
+        }
+        if (index == 0) {
+            provider_ = provider;
+            if (!config_.execution_providers.empty()) {
+                std::cout << "ASR model running on " << OrtRuntime::providerName(provider)
+                          << " execution provider" << std::endl;
+            }
+        }
+        worker.binding = std::make_unique<Ort::IoBinding>(*worker.session);
+        
+        // Every session loads the same model, so the tensor info is read once
+        if (index > 0) {
+            return true;
+        }
         
         // Get input/output info
         Ort::AllocatorWithDefaultOptions allocator;
+        Ort::Session* session = worker.session.get();
         
         // Input names and shapes
-        size_t num_input_nodes = session_->GetInputCount();
+        size_t num_input_nodes = session->GetInputCount();
         input_names_.reserve(num_input_nodes);
         input_shapes_.reserve(num_input_nodes);
         
         for (size_t i = 0; i < num_input_nodes; i++) {
-            auto input_name = session_->GetInputNameAllocated(i, allocator);
+            auto input_name = session->GetInputNameAllocated(i, allocator);
             input_names_.push_back(input_name.release());
             
-            auto input_shape = session_->GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
+            auto input_shape = session->GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
             input_shapes_.push_back(input_shape);
         }
         
         // Output names and shapes
-        size_t num_output_nodes = session_->GetOutputCount();
+        size_t num_output_nodes = session->GetOutputCount();
         output_names_.reserve(num_output_nodes);
         output_shapes_.reserve(num_output_nodes);
         
         for (size_t i = 0; i < num_output_nodes; i++) {
-            auto output_name = session_->GetOutputNameAllocated(i, allocator);
+            auto output_name = session->GetOutputNameAllocated(i, allocator);
             output_names_.push_back(output_name.release());
             
-            auto output_shape = session_->GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
+            auto output_shape = session->GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
             output_shapes_.push_back(output_shape);
         }
         
+        if (num_output_nodes > 1) {
+            out_lens_type_ = session->GetOutputTypeInfo(1).GetTensorTypeAndShapeInfo().GetElementType();
+        }
+        if (!output_shapes_.empty() && output_shapes_[0].size() == 3 && output_shapes_[0][2] > 0) {
+            vocab_size_ = static_cast<int>(output_shapes_[0][2]);
+        }
+        
         return true;
         
     } catch (const std::exception& e) {
@@ -102,11 +277,30 @@ bool ASRModel::initializeSession() {
     }
 }
 
+ASRModel::Worker* ASRModel::acquireWorker() {
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+    pool_cv_.wait(lock, [this] { return !idle_workers_.empty(); });
+    Worker* worker = idle_workers_.back();
+    idle_workers_.pop_back();
+    return worker;
+}
+
+void ASRModel::releaseWorker(Worker* worker) {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        idle_workers_.push_back(worker);
+    }
+    pool_cv_.notify_one();
+}
+
 void ASRModel::cleanup() {
-    session_.reset();
-    env_.reset();
-    audio_processor_.reset();
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        idle_workers_.clear();
+    }
+    workers_.clear();
     tokenizer_.reset();
+    ctc_decoder_.reset();
     
     for (auto name : input_names_) {
         delete[] name;
@@ -119,6 +313,29 @@ void ASRModel::cleanup() {
     output_names_.clear();
 }
 
+void ASRModel::initializeHotwords() {
+    if (config_.hotwords.empty()) {
+        return;
+    }
+    if (config_.beam_size <= 1) {
+        std::cerr << "Warning: hotwords need beam search (beam_size > 1), ignoring them" << std::endl;
+        return;
+    }
+    
+    // Words the vocabulary cannot spell would only ever match partially, so they are skipped
+    std::vector<std::vector<int>> sequences;
+    for (const auto& word : config_.hotwords) {
+        std::vector<int> tokens = tokenizer_->encode(word);
+        if (tokens.empty() || std::find(tokens.begin(), tokens.end(), tokenizer_->getUnkId()) != tokens.end()) {
+            std::cerr << "Warning: hotword not representable in the vocabulary: " << word << std::endl;
+            continue;
+        }
+        sequences.push_back(std::move(tokens));
+    }
+    ctc_decoder_->setHotwords(sequences);
+    std::cout << "Loaded " << ctc_decoder_->numHotwords() << " hotwords" << std::endl;
+}
+
 bool ASRModel::loadConfig() {
     // In a real implementation, you would parse YAML config file
     // For now, we'll use hardcoded values
@@ -143,153 +360,603 @@ std::string ASRModel::recognize(const std::vector<float>& audio) {
 }
 
 std::string ASRModel::recognize(const float* audio, size_t length) {
-    if (!session_ || !audio_processor_ || !tokenizer_) {
+    return recognizeDetailed(audio, length).text;
+}
+
+ASRModel::Result ASRModel::recognizeDetailed(const float* audio, size_t length) {
+    if (workers_.empty() || !tokenizer_) {
         std::cerr << "ASR model not properly initialized" << std::endl;
-        return "";
+        return Result();
+    }
+    
+    // Looked up before taking a worker, so repeated clips never queue behind inference
+    ResultCache::Key cache_key;
+    if (result_cache_) {
+        cache_key = ResultCache::makeKey(audio, length, cacheSettings(config_.language));
+        Result cached;
+        if (result_cache_->lookup(cache_key, cached)) {
+            return cached;
+        }
     }
     
     try {
-        auto start_time = std::chrono::high_resolution_clock::now();
-        
-        // Extract features
-        auto feature_start = std::chrono::high_resolution_clock::now();
-        std::vector<float> audio_vec(audio, audio + length);
-        auto features = audio_processor_->extractFeatures(audio_vec);
-        auto feature_end = std::chrono::high_resolution_clock::now();
-        auto feature_time = std::chrono::duration<double>(feature_end - feature_start).count();
+        WorkerLease worker(*this);
+        auto start_time = std::chrono::steady_clock::now();
+        StageTimes times;
         
-        // Flatten features for ONNX input
-        auto flatten_start = std::chrono::high_resolution_clock::now();
-        std::vector<float> flattened_features;
-        size_t feature_dim = features.empty() ? 0 : features[0].size();
-        size_t sequence_length = features.size();
-        
-        flattened_features.reserve(sequence_length * feature_dim);
-        for (const auto& frame : features) {
-            flattened_features.insert(flattened_features.end(), frame.begin(), frame.end());
+        // Extract features straight into the buffer backing the input tensor
+        size_t sequence_length = 0;
+        size_t padded_length = 0;
+        {
+            ScopedTimer timer(Metrics::Stage::Feature, &times.feature);
+            size_t feature_dim = static_cast<size_t>(feature_dim_);
+            sequence_length = worker->audio_processor->getNumLFRFrames(length);
+            padded_length = getPaddedFrames(sequence_length);
+            if (worker->feature_buffer.size() < padded_length * feature_dim) {
+                worker->feature_buffer.resize(padded_length * feature_dim);
+            }
+            sequence_length = worker->audio_processor->extractFeatures(audio, length, worker->feature_buffer.data(),
+                                                                       sequence_length);
+            std::fill(worker->feature_buffer.begin() + sequence_length * feature_dim,
+                      worker->feature_buffer.begin() + padded_length * feature_dim, 0.0f);
+        }
+        if (sequence_length == 0) {
+            return Result();  // too short to produce a single frame
         }
-        auto flatten_end = std::chrono::high_resolution_clock::now();
-        auto flatten_time = std::chrono::duration<double>(flatten_end - flatten_start).count();
-        
-        // Prepare input tensors
-        std::vector<int64_t> feature_shape = {config_.batch_size, static_cast<int64_t>(sequence_length), static_cast<int64_t>(feature_dim)};
-        std::vector<int64_t> length_shape = {config_.batch_size};
-        std::vector<int64_t> language_shape = {config_.batch_size};
-        std::vector<int64_t> textnorm_shape = {config_.batch_size};
-        
-        std::vector<int32_t> feat_length = {static_cast<int32_t>(sequence_length)};
-        std::vector<int32_t> language_id = {getLanguageId(config_.language)};
-        std::vector<int32_t> textnorm_id = {getTextnormId(config_.use_itn)};
-        
-        std::vector<Ort::Value> input_tensors;
-        input_tensors.push_back(Ort::Value::CreateTensor<float>(
-            memory_info_, flattened_features.data(), flattened_features.size(), 
-            feature_shape.data(), feature_shape.size()));
-        input_tensors.push_back(Ort::Value::CreateTensor<int32_t>(
-            memory_info_, feat_length.data(), feat_length.size(), 
-            length_shape.data(), length_shape.size()));
-        input_tensors.push_back(Ort::Value::CreateTensor<int32_t>(
-            memory_info_, language_id.data(), language_id.size(), 
-            language_shape.data(), language_shape.size()));
-        input_tensors.push_back(Ort::Value::CreateTensor<int32_t>(
-            memory_info_, textnorm_id.data(), textnorm_id.size(), 
-            textnorm_shape.data(), textnorm_shape.size()));
-        
-        // Run inference
-        auto inference_start = std::chrono::high_resolution_clock::now();
-        auto output_tensors = session_->Run(Ort::RunOptions{nullptr},
-                                          input_names_.data(), input_tensors.data(), input_tensors.size(),
-                                          output_names_.data(), output_names_.size());
-        auto inference_end = std::chrono::high_resolution_clock::now();
-        auto inference_time = std::chrono::duration<double>(inference_end - inference_start).count();
-        
-        // Get logits and decode
-        auto decode_start = std::chrono::high_resolution_clock::now();
-        float* logits_data = output_tensors[0].GetTensorMutableData<float>();
-        auto logits_shape = output_tensors[0].GetTensorTypeAndShapeInfo().GetShape();
-        
-        int seq_len = static_cast<int>(logits_shape[1]);
-        int vocab_size = static_cast<int>(logits_shape[2]);
-        
-        std::vector<float> logits_vec(logits_data, logits_data + seq_len * vocab_size);
-        auto token_ids = decodeCTC(logits_vec, seq_len);
         
-        // Decode tokens to text
-        std::string result = tokenizer_->decode(token_ids);
-        result = postProcess(token_ids);
-        auto decode_end = std::chrono::high_resolution_clock::now();
-        auto decode_time = std::chrono::duration<double>(decode_end - decode_start).count();
+        Result result = inferAndDecode(*worker, worker->feature_buffer.data(), sequence_length, padded_length, 0,
+                                       times);
         
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration<double>(end_time - start_time).count();
+        double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
         double audio_duration = static_cast<double>(length) / config_.sample_rate;
-        double rtf = duration / audio_duration;
-        
-        std::cout << "=== Performance Breakdown ===" << std::endl;
-        std::cout << "Feature extraction: " << feature_time << "s (" << (feature_time/duration*100) << "%)" << std::endl;
-        std::cout << "Data flattening: " << flatten_time << "s (" << (flatten_time/duration*100) << "%)" << std::endl;
-        std::cout << "ONNX inference: " << inference_time << "s (" << (inference_time/duration*100) << "%)" << std::endl;
-        std::cout << "Token decoding: " << decode_time << "s (" << (decode_time/duration*100) << "%)" << std::endl;
-        std::cout << "Total time: " << duration << "s, Audio duration: " << audio_duration 
-                  << "s, RTF: " << rtf << std::endl;
+        Metrics::instance().addRecognition(audio_duration, duration);
+        if (config_.print_performance) {
+            printPerformance(times, duration, audio_duration);
+        }
         
+        if (result_cache_) {
+            result_cache_->insert(cache_key, result);
+        }
         return result;
         
+    } catch (const std::exception& e) {
+        std::cerr << "ASR inference error: " << e.what() << std::endl;
+        return Result();
+    }
+}
+
+std::string ASRModel::recognizeFeatures(const float* features, size_t num_frames, size_t skip_frames) {
+    if (workers_.empty() || !tokenizer_) {
+        std::cerr << "ASR model not properly initialized" << std::endl;
+        return "";
+    }
+    
+    if (num_frames == 0) {
+        return "";
+    }
+    
+    try {
+        return decodeFeatures(features, num_frames, skip_frames).text;
     } catch (const std::exception& e) {
         std::cerr << "ASR inference error: " << e.what() << std::endl;
         return "";
     }
 }
 
-std::vector<std::string> ASRModel::recognizeBatch(const std::vector<std::vector<float>>& audio_batch) {
-    std::vector<std::string> results;
-    results.reserve(audio_batch.size());
+ASRModel::Result ASRModel::recognizeFeaturesDetailed(const float* features, size_t num_frames, size_t skip_frames) {
+    if (workers_.empty() || !tokenizer_) {
+        std::cerr << "ASR model not properly initialized" << std::endl;
+        return Result();
+    }
+    
+    if (num_frames == 0) {
+        return Result();
+    }
+    
+    ResultCache::Key cache_key;
+    if (result_cache_) {
+        cache_key = ResultCache::makeFeatureKey(features, num_frames * static_cast<size_t>(feature_dim_),
+                                                cacheSettings(config_.language) + "|skip=" +
+                                                    std::to_string(skip_frames));
+        Result cached;
+        if (result_cache_->lookup(cache_key, cached)) {
+            return cached;
+        }
+    }
+    
+    try {
+        Result result = decodeFeatures(features, num_frames, skip_frames);
+        if (result_cache_) {
+            result_cache_->insert(cache_key, result);
+        }
+        return result;
+    } catch (const std::exception& e) {
+        std::cerr << "ASR inference error: " << e.what() << std::endl;
+        return Result();
+    }
+}
+
+ASRModel::Result ASRModel::decodeFeatures(const float* features, size_t num_frames, size_t skip_frames) {
+    WorkerLease worker(*this);
+    auto start_time = std::chrono::steady_clock::now();
+    StageTimes times;
+    
+    // ORT takes a mutable pointer but never writes to session inputs. A bucketed
+    // length needs zero rows after the caller's frames, so those inputs are copied.
+    float* input = const_cast<float*>(features);
+    size_t padded_frames = getPaddedFrames(num_frames);
+    if (padded_frames > num_frames) {
+        size_t feature_dim = static_cast<size_t>(feature_dim_);
+        if (worker->feature_buffer.size() < padded_frames * feature_dim) {
+            worker->feature_buffer.resize(padded_frames * feature_dim);
+        }
+        std::copy(features, features + num_frames * feature_dim, worker->feature_buffer.begin());
+        std::fill(worker->feature_buffer.begin() + num_frames * feature_dim,
+                  worker->feature_buffer.begin() + padded_frames * feature_dim, 0.0f);
+        input = worker->feature_buffer.data();
+    }
+    Result result = inferAndDecode(*worker, input, num_frames, padded_frames, skip_frames, times);
+    
+    // Streaming windows overlap, so they stay out of the RTF counters; the stage
+    // histograms still see every window
+    double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    double audio_duration = static_cast<double>(num_frames) * audio_config_.lfr_n * audio_config_.frame_shift
+                            / audio_config_.sample_rate;
+    if (config_.print_performance) {
+        printPerformance(times, duration, audio_duration);
+    }
+    
+    return result;
+}
+
+std::unique_ptr<OnlineFeatureExtractor> ASRModel::createStreamingFrontend() const {
+    if (workers_.empty()) {
+        return nullptr;
+    }
+    
+    auto frontend = std::make_unique<OnlineFeatureExtractor>(audio_config_);
+    if (!frontend->initialize()) {
+        return nullptr;
+    }
+    return frontend;
+}
+
+ASRModel::Result ASRModel::inferAndDecode(Worker& worker, float* features, size_t sequence_length,
+                                          size_t padded_length, size_t skip_frames, StageTimes& times) {
+    size_t feature_dim = static_cast<size_t>(feature_dim_);
+    
+    worker.lengths.assign(1, static_cast<int32_t>(sequence_length));
+    worker.language_ids.assign(1, getLanguageId(config_.language));
+    worker.textnorm_ids.assign(1, getTextnormId(config_.use_itn));
+    
+    // Run inference
+    std::vector<Ort::Value> output_tensors;
+    {
+        ScopedTimer timer(Metrics::Stage::Inference, &times.inference);
+        output_tensors = runInference(worker, features, 1, static_cast<int>(padded_length),
+                                      static_cast<int>(feature_dim));
+    }
+    
+    // Decode straight from the output tensor memory
+    const float* logits_data = output_tensors[0].GetTensorMutableData<float>();
+    auto logits_shape = output_tensors[0].GetTensorTypeAndShapeInfo().GetShape();
+    
+    int seq_len = static_cast<int>(logits_shape[1]);
+    int vocab_size = static_cast<int>(logits_shape[2]);
+    
+    int valid_frames = validOutputFrames(output_tensors, 0, static_cast<int>(sequence_length),
+                                         static_cast<int>(padded_length));
+    // Output frames are the input frames shifted by the encoder's prepended query frames
+    int start_frame = skip_frames > 0 ? static_cast<int>(skip_frames) + (seq_len - static_cast<int>(padded_length)) : 0;
+    CTCDecoder::Result decoded;
+    {
+        ScopedTimer timer(Metrics::Stage::CTC, &times.ctc);
+        decoded = ctc_decoder_->decode(logits_data, valid_frames, vocab_size, start_frame);
+    }
+    
+    // Decode tokens to text
+    ScopedTimer timer(Metrics::Stage::Detokenize, &times.detokenize);
+    return makeResult(decoded, seq_len - static_cast<int>(padded_length));
+}
+
+ASRModel::Result ASRModel::makeResult(CTCDecoder::Result& decoded, int frame_offset) {
+    Result result;
+    result.text = tokenizer_->decode(decoded.tokens);
+    result.language = std::move(decoded.language);
+    result.emotion = std::move(decoded.emotion);
+    result.event = std::move(decoded.event);
+    result.itn = decoded.itn;
     
-    for (const auto& audio : audio_batch) {
-        results.push_back(recognize(audio));
+    // Output frame f is input LFR frame f - frame_offset, and each LFR frame advances lfr_n hops
+    if (!decoded.spans.empty()) {
+        static const std::string kWordBoundary = "\xe2\x96\x81";  // ▁
+        const double frame_seconds = static_cast<double>(audio_config_.lfr_n) * audio_config_.frame_shift
+                                     / audio_config_.sample_rate;
+        result.tokens.reserve(decoded.tokens.size());
+        for (size_t i = 0; i < decoded.tokens.size() && i < decoded.spans.size(); ++i) {
+            const CTCDecoder::TokenSpan& span = decoded.spans[i];
+            Token token;
+            std::string_view piece = tokenizer_->tokenView(decoded.tokens[i]);
+            token.word_start = piece.compare(0, kWordBoundary.size(), kWordBoundary) == 0;
+            if (token.word_start) {
+                piece.remove_prefix(kWordBoundary.size());
+            }
+            token.text = std::string(piece);
+            token.start = std::max(0, span.start_frame - frame_offset) * frame_seconds;
+            token.end = std::max(0, span.end_frame - frame_offset) * frame_seconds;
+            token.confidence = span.confidence;
+            result.tokens.push_back(std::move(token));
+        }
     }
     
+    return result;
+}
+
+void ASRModel::printPerformance(const StageTimes& times, double duration, double audio_duration) {
+    double rtf = duration / audio_duration;
+    
+    std::cout << "=== Performance Breakdown ===" << std::endl;
+    std::cout << "Feature extraction: " << times.feature << "s (" << (times.feature/duration*100) << "%)" << std::endl;
+    std::cout << "ONNX inference: " << times.inference << "s (" << (times.inference/duration*100) << "%)" << std::endl;
+    std::cout << "CTC decoding: " << times.ctc << "s (" << (times.ctc/duration*100) << "%)" << std::endl;
+    std::cout << "Detokenize: " << times.detokenize << "s (" << (times.detokenize/duration*100) << "%)" << std::endl;
+    std::cout << "Total time: " << duration << "s, Audio duration: " << audio_duration 
+              << "s, RTF: " << rtf << std::endl;
+}
+
+std::vector<std::string> ASRModel::recognizeBatch(const std::vector<std::vector<float>>& audio_batch,
+                                                  const std::vector<std::string>& languages) {
+    std::vector<Result> detailed = recognizeBatchDetailed(audio_batch, languages);
+    std::vector<std::string> results(detailed.size());
+    for (size_t i = 0; i < detailed.size(); ++i) {
+        results[i] = std::move(detailed[i].text);
+    }
     return results;
 }
 
-std::vector<int> ASRModel::decodeCTC(const std::vector<float>& logits, int sequence_length) {
-    std::vector<int> tokens;
-    int vocab_size = logits.size() / sequence_length;
+std::vector<ASRModel::Result> ASRModel::recognizeBatchDetailed(const std::vector<std::vector<float>>& audio_batch,
+                                                               const std::vector<std::string>& languages) {
+    std::vector<Result> results(audio_batch.size());
+    if (audio_batch.empty()) {
+        return results;
+    }
     
-    int prev_token = -1;
-    for (int t = 0; t < sequence_length; ++t) {
-        // Find max probability token at time step t
-        int max_token = 0;
-        float max_prob = logits[t * vocab_size];
-        
-        for (int v = 1; v < vocab_size; ++v) {
-            if (logits[t * vocab_size + v] > max_prob) {
-                max_prob = logits[t * vocab_size + v];
-                max_token = v;
+    if (workers_.empty() || !tokenizer_) {
+        std::cerr << "ASR model not properly initialized" << std::endl;
+        return results;
+    }
+    
+    if (!languages.empty() && languages.size() != audio_batch.size()) {
+        std::cerr << "Language list size does not match batch size" << std::endl;
+        return results;
+    }
+    
+    // Clips still to run, in batch order; cache hits are filled in here and dropped
+    std::vector<size_t> pending;
+    std::vector<ResultCache::Key> cache_keys;
+    pending.reserve(audio_batch.size());
+    if (result_cache_) {
+        cache_keys.resize(audio_batch.size());
+    }
+    for (size_t i = 0; i < audio_batch.size(); ++i) {
+        if (result_cache_) {
+            const std::string& language = languages.empty() ? config_.language : languages[i];
+            cache_keys[i] = ResultCache::makeKey(audio_batch[i].data(), audio_batch[i].size(), cacheSettings(language));
+            if (result_cache_->lookup(cache_keys[i], results[i])) {
+                continue;
             }
         }
+        pending.push_back(i);
+    }
+    if (pending.empty()) {
+        return results;
+    }
+    
+    const size_t max_batch = static_cast<size_t>(std::max(1, config_.batch_size));
+    WorkerLease worker(*this);
+    AudioProcessor& audio_processor = *worker->audio_processor;
+    std::vector<float>& feature_buffer = worker->feature_buffer;
+    
+    for (size_t begin = 0; begin < pending.size(); begin += max_batch) {
+        size_t end = std::min(pending.size(), begin + max_batch);
         
-        // CTC decoding: skip blank tokens and repeated tokens
-        if (max_token != blank_id_ && max_token != prev_token) {
-            tokens.push_back(max_token);
+        try {
+            auto start_time = std::chrono::steady_clock::now();
+            
+            // Size the padded [N, T_max, D] tensor from the clip lengths before extracting
+            const int batch = static_cast<int>(end - begin);
+            size_t max_frames = 0;
+            size_t feature_dim = static_cast<size_t>(feature_dim_);
+            double audio_duration = 0.0;
+            
+            for (size_t i = begin; i < end; ++i) {
+                const auto& audio = audio_batch[pending[i]];
+                max_frames = std::max(max_frames, audio_processor.getNumLFRFrames(audio.size()));
+                audio_duration += static_cast<double>(audio.size()) / config_.sample_rate;
+            }
+            
+            if (max_frames == 0) {
+                continue;  // every clip too short to produce a frame
+            }
+            max_frames = getPaddedFrames(max_frames);
+            
+            // Each utterance writes its features directly into its row; padding stays zero
+            size_t padded_size = static_cast<size_t>(batch) * max_frames * feature_dim;
+            if (feature_buffer.size() < padded_size) {
+                feature_buffer.resize(padded_size);
+            }
+            std::fill(feature_buffer.begin(), feature_buffer.begin() + padded_size, 0.0f);
+            
+            std::vector<int32_t>& feat_lengths = worker->lengths;
+            feat_lengths.assign(batch, 0);
+            worker->language_ids.assign(batch, 0);
+            worker->textnorm_ids.assign(batch, getTextnormId(config_.use_itn));
+            
+            {
+                ScopedTimer timer(Metrics::Stage::Feature);
+                for (int b = 0; b < batch; ++b) {
+                    const size_t index = pending[begin + b];
+                    const auto& audio = audio_batch[index];
+                    float* row = feature_buffer.data() + static_cast<size_t>(b) * max_frames * feature_dim;
+                    feat_lengths[b] = static_cast<int32_t>(
+                        audio_processor.extractFeatures(audio.data(), audio.size(), row, max_frames));
+                    worker->language_ids[b] = getLanguageId(languages.empty() ? config_.language : languages[index]);
+                }
+            }
+            
+            double inference_time = 0.0;
+            std::vector<Ort::Value> output_tensors;
+            {
+                ScopedTimer timer(Metrics::Stage::Inference, &inference_time);
+                output_tensors = runInference(*worker, feature_buffer.data(), batch, static_cast<int>(max_frames),
+                                              static_cast<int>(feature_dim));
+            }
+            
+            // CTC-decode each row over its valid frames only
+            const float* logits_data = output_tensors[0].GetTensorMutableData<float>();
+            auto logits_shape = output_tensors[0].GetTensorTypeAndShapeInfo().GetShape();
+            int out_frames = static_cast<int>(logits_shape[1]);
+            int vocab_size = static_cast<int>(logits_shape[2]);
+            
+            for (int b = 0; b < batch; ++b) {
+                if (feat_lengths[b] == 0) {
+                    continue;
+                }
+                const float* row_logits = logits_data + static_cast<size_t>(b) * out_frames * vocab_size;
+                int valid_frames = validOutputFrames(output_tensors, b, feat_lengths[b], static_cast<int>(max_frames));
+                CTCDecoder::Result decoded;
+                {
+                    ScopedTimer timer(Metrics::Stage::CTC);
+                    decoded = ctc_decoder_->decode(row_logits, valid_frames, vocab_size);
+                }
+                const size_t index = pending[begin + b];
+                {
+                    ScopedTimer timer(Metrics::Stage::Detokenize);
+                    results[index] = makeResult(decoded, out_frames - static_cast<int>(max_frames));
+                }
+                if (result_cache_) {
+                    result_cache_->insert(cache_keys[index], results[index]);
+                }
+            }
+            
+            auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+            Metrics::instance().addRecognition(audio_duration, duration, static_cast<uint64_t>(batch));
+            
+            if (config_.print_performance) {
+                std::cout << "=== Batch Performance ===" << std::endl;
+                std::cout << "Batch size: " << batch << ", padded frames: " << max_frames << std::endl;
+                std::cout << "ONNX inference: " << inference_time << "s (" << (inference_time/duration*100) << "%)" << std::endl;
+                std::cout << "Total time: " << duration << "s, Audio duration: " << audio_duration
+                          << "s, RTF: " << duration / audio_duration << std::endl;
+            }
+            
+        } catch (const std::exception& e) {
+            std::cerr << "ASR batch inference error: " << e.what() << std::endl;
+        }
+    }
+    
+    return results;
+}
+
+size_t ASRModel::getFeatureFrames(size_t num_samples) const {
+    return workers_.empty() ? 0 : workers_.front()->audio_processor->getNumLFRFrames(num_samples);
+}
+
+size_t ASRModel::getPaddedFrames(size_t frames) const {
+    for (size_t bucket : config_.shape_buckets) {
+        if (bucket >= frames) {
+            return bucket;
+        }
+    }
+    return frames;
+}
+
+std::vector<size_t> ASRModel::parseShapeBuckets(const std::string& list) {
+    std::vector<size_t> buckets;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        long frames = std::atol(item.c_str());
+        if (frames > 0) {
+            buckets.push_back(static_cast<size_t>(frames));
+        }
+    }
+    std::sort(buckets.begin(), buckets.end());
+    buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+    return buckets;
+}
+
+void ASRModel::warmup(const std::vector<size_t>& frame_lengths) {
+    if (workers_.empty() || frame_lengths.empty()) {
+        return;
+    }
+    
+    auto start_time = std::chrono::steady_clock::now();
+    auto warm = [&](Worker* worker) {
+        try {
+            for (size_t frames : frame_lengths) {
+                warmupRun(*worker, 1, getPaddedFrames(std::max<size_t>(1, frames)));
+            }
+            // A full batch sizes the arena for recognizeBatch / the batch scheduler
+            if (config_.batch_size > 1) {
+                warmupRun(*worker, config_.batch_size, getPaddedFrames(std::max<size_t>(1, frame_lengths.front())));
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: ASR warmup failed: " << e.what() << std::endl;
+        }
+    };
+    
+    // Every session has its own arena use and kernel state, so each one is warmed
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < workers_.size(); ++i) {
+        threads.emplace_back(warm, workers_[i].get());
+    }
+    warm(workers_.front().get());
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    std::cout << "ASR warmup: " << workers_.size() << " session(s), " << frame_lengths.size()
+              << " length(s) in " << duration << "s" << std::endl;
+}
+
+void ASRModel::warmupRun(Worker& worker, int batch, size_t frames) {
+    size_t feature_count = static_cast<size_t>(batch) * frames * static_cast<size_t>(feature_dim_);
+    if (worker.feature_buffer.size() < feature_count) {
+        worker.feature_buffer.resize(feature_count);
+    }
+    std::fill(worker.feature_buffer.begin(), worker.feature_buffer.begin() + feature_count, 0.0f);
+    
+    worker.lengths.assign(batch, static_cast<int32_t>(frames));
+    worker.language_ids.assign(batch, getLanguageId(config_.language));
+    worker.textnorm_ids.assign(batch, getTextnormId(config_.use_itn));
+    runInference(worker, worker.feature_buffer.data(), batch, static_cast<int>(frames), feature_dim_);
+}
+
+std::vector<Ort::Value> ASRModel::runInference(Worker& worker, float* features, int batch, int frames, int feature_dim) {
+    const int64_t feature_shape[] = {batch, frames, feature_dim};
+    const int64_t batch_shape[] = {batch};
+    size_t feature_count = static_cast<size_t>(batch) * frames * feature_dim;
+    
+    // Tensors only wrap the worker's buffers; binding them copies nothing
+    Ort::IoBinding& binding = *worker.binding;
+    binding.ClearBoundInputs();
+    binding.BindInput(input_names_[0], Ort::Value::CreateTensor<float>(
+        memory_info_, features, feature_count, feature_shape, 3));
+    binding.BindInput(input_names_[1], Ort::Value::CreateTensor<int32_t>(
+        memory_info_, worker.lengths.data(), worker.lengths.size(), batch_shape, 1));
+    binding.BindInput(input_names_[2], Ort::Value::CreateTensor<int32_t>(
+        memory_info_, worker.language_ids.data(), worker.language_ids.size(), batch_shape, 1));
+    binding.BindInput(input_names_[3], Ort::Value::CreateTensor<int32_t>(
+        memory_info_, worker.textnorm_ids.data(), worker.textnorm_ids.size(), batch_shape, 1));
+    
+    bindOutputs(worker, batch, frames);
+    worker.session->Run(Ort::RunOptions{nullptr}, binding);
+    std::vector<Ort::Value> outputs = binding.GetOutputValues();
+    
+    // First run: record the logits layout so later runs write into preallocated memory
+    if (output_frame_offset_ < 0) {
+        auto logits_shape = outputs[0].GetTensorTypeAndShapeInfo().GetShape();
+        vocab_size_ = static_cast<int>(logits_shape[2]);
+        output_frame_offset_ = static_cast<int>(logits_shape[1]) - frames;
+    }
+    
+    return outputs;
+}
+
+void ASRModel::bindOutputs(Worker& worker, int batch, int frames) {
+    Ort::IoBinding& binding = *worker.binding;
+    binding.ClearBoundOutputs();
+    
+    const int offset = output_frame_offset_;
+    const int vocab_size = vocab_size_;
+    if (offset < 0 || vocab_size <= 0) {
+        // Layout not known yet: let ORT allocate this once
+        for (const char* name : output_names_) {
+            binding.BindOutput(name, memory_info_);
         }
-        prev_token = max_token;
+        return;
     }
     
-    return tokens;
+    const int64_t logits_shape[] = {batch, frames + offset, vocab_size};
+    size_t logits_count = static_cast<size_t>(batch) * (frames + offset) * vocab_size;
+    if (worker.logits_buffer.size() < logits_count) {
+        worker.logits_buffer.resize(logits_count);
+    }
+    binding.BindOutput(output_names_[0], Ort::Value::CreateTensor<float>(
+        memory_info_, worker.logits_buffer.data(), logits_count, logits_shape, 3));
+    
+    const int64_t batch_shape[] = {batch};
+    for (size_t i = 1; i < output_names_.size(); ++i) {
+        if (i == 1 && out_lens_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32) {
+            worker.out_lens32.resize(batch);
+            binding.BindOutput(output_names_[i], Ort::Value::CreateTensor<int32_t>(
+                memory_info_, worker.out_lens32.data(), worker.out_lens32.size(), batch_shape, 1));
+        } else if (i == 1 && out_lens_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64) {
+            worker.out_lens64.resize(batch);
+            binding.BindOutput(output_names_[i], Ort::Value::CreateTensor<int64_t>(
+                memory_info_, worker.out_lens64.data(), worker.out_lens64.size(), batch_shape, 1));
+        } else {
+            binding.BindOutput(output_names_[i], memory_info_);
+        }
+    }
+}
+
+int ASRModel::validOutputFrames(const std::vector<Ort::Value>& outputs, size_t row, int input_frames, int padded_frames) {
+    int out_frames = static_cast<int>(outputs[0].GetTensorTypeAndShapeInfo().GetShape()[1]);
+    
+    // Prefer the model's encoder_out_lens output when it is exported
+    if (outputs.size() > 1) {
+        auto lens_info = outputs[1].GetTensorTypeAndShapeInfo();
+        if (lens_info.GetElementCount() > row) {
+            int64_t len = 0;
+            if (lens_info.GetElementType() == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32) {
+                len = outputs[1].GetTensorData<int32_t>()[row];
+            } else if (lens_info.GetElementType() == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64) {
+                len = outputs[1].GetTensorData<int64_t>()[row];
+            }
+            if (len > 0) {
+                return static_cast<int>(std::min<int64_t>(len, out_frames));
+            }
+        }
+    }
+    
+    // Otherwise the encoder keeps the input length plus its prepended query frames
+    return std::min(out_frames, input_frames + (out_frames - padded_frames));
+}
+
+std::string ASRModel::modelFingerprint() const {
+    std::ostringstream fingerprint;
+    fingerprint << config_.model_path;
+    std::error_code ec;
+    auto size = std::filesystem::file_size(config_.model_path, ec);
+    if (!ec) {
+        fingerprint << "|" << size;
+    }
+    auto mtime = std::filesystem::last_write_time(config_.model_path, ec);
+    if (!ec) {
+        fingerprint << "|" << mtime.time_since_epoch().count();
+    }
+    fingerprint << "|" << OrtRuntime::providerName(provider_) << "|beam=" << config_.beam_size << "/"
+                << config_.beam_top_k << "|hotwords=" << ctc_decoder_->numHotwords() << "/" << config_.hotword_weight
+                << "|digits=" << config_.strip_digits << "|onnx_decoder=" << config_.use_onnx_decoder
+                << "|timestamps=" << config_.token_timestamps;
+    for (const auto& word : config_.hotwords) {
+        fingerprint << "|" << word;
+    }
+    return fingerprint.str();
 }
 
-std::string ASRModel::postProcess(const std::vector<int>& token_ids) {
-    // This would typically involve rich transcription post-processing
-    // For now, just return the decoded text
-    return tokenizer_->decode(token_ids);
+std::string ASRModel::cacheSettings(const std::string& language) const {
+    return language + (config_.use_itn ? "|itn" : "|noitn");
 }
 
-int ASRModel::getLanguageId(const std::string& language) {
+int ASRModel::getLanguageId(const std::string& language) const {
     auto it = language_dict_.find(language);
-    return it != language_dict_.end() ? it->second : language_dict_["auto"];
+    return it != language_dict_.end() ? it->second : language_dict_.at("auto");
 }
 
-int ASRModel::getTextnormId(bool use_itn) {
-    return use_itn ? textnorm_dict_["withitn"] : textnorm_dict_["woitn"];
+int ASRModel::getTextnormId(bool use_itn) const {
+    return use_itn ? textnorm_dict_.at("withitn") : textnorm_dict_.at("woitn");
 }
@@ -0,0 +1,612 @@
+#include "asr_server.hpp"
+#include "websocket.hpp"
+#include "asr_model.hpp"
+#include "batch_scheduler.hpp"
+#include "multi_stream_vad.hpp"
+#include "streaming_recognizer.hpp"
+#include "resampler.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+std::string jsonEscape(const std::string& text) {
+    std::string out;
+    out.reserve(text.size() + 2);
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buffer[8];
+                    snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    out += buffer;
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    return out;
+}
+
+std::string errorMessage(const std::string& message) {
+    return "{\"type\":\"error\",\"message\":\"" + jsonEscape(message) + "\"}";
+}
+
+}  // namespace
+
+struct ASRServer::Session {
+    std::shared_ptr<WebSocketConnection> connection;
+    int stream_id = -1;
+    std::string language;
+    std::unique_ptr<Resampler> resampler;       // client rate -> VAD/model rate
+    std::unique_ptr<StreamingRecognizer> streaming;
+
+    // Filled by the VAD thread and the scheduler's callbacks
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::pair<size_t, float>> vad_results;  // (window index, probability)
+    size_t finals_in_flight = 0;
+    size_t final_samples_in_flight = 0;
+
+    // Connection thread only. pending holds audio from sample pending_start on, so the VAD
+    // windows still to be decided plus the pre-speech audio before them.
+    std::vector<float> pending;
+    size_t pending_start = 0;
+    size_t samples_pushed = 0;
+    size_t next_window = 0;
+    std::vector<float> pcm_buffer;
+    std::vector<float> resampled_buffer;
+
+    bool in_speech = false;
+    std::vector<float> segment;
+    size_t segment_start = 0;   // first sample of the segment, pre-speech included
+    size_t speech_start = 0;    // first sample of the trigger window
+    size_t segment_floor = 0;   // end of the last segment; pre-speech never reaches back past it
+    size_t silence_samples = 0;
+    std::atomic<int> segment_index{0};
+};
+
+ASRServer::ASRServer(ASRModel& model, BatchScheduler& scheduler, MultiStreamVAD& vad, const Config& config)
+    : model_(model), scheduler_(scheduler), vad_(vad), config_(config), running_(false),
+      active_sessions_(0), sessions_total_(0), sessions_rejected_(0), backpressure_pauses_(0),
+      bytes_received_(0) {
+}
+
+ASRServer::~ASRServer() {
+    stop();
+}
+
+bool ASRServer::start() {
+    if (running_.load()) {
+        return true;
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        std::cerr << "Failed to create socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(config_.port));
+    if (inet_pton(AF_INET, config_.host.c_str(), &address.sin_addr) != 1) {
+        std::cerr << "Invalid listen address: " << config_.host << std::endl;
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(listen_fd_, 64) < 0) {
+        std::cerr << "Failed to listen on " << config_.host << ":" << config_.port << ": "
+                  << strerror(errno) << std::endl;
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        sessions_.assign(config_.max_sessions, nullptr);
+    }
+    vad_.setResultCallback([this](int stream_id, float probability, size_t window_index) {
+        onVadResult(stream_id, probability, window_index);
+    });
+
+    running_ = true;
+    vad_thread_ = std::thread(&ASRServer::vadLoop, this);
+    accept_thread_ = std::thread(&ASRServer::acceptLoop, this);
+    std::cout << "ASR server listening on " << config_.host << ":" << config_.port << std::endl;
+    return true;
+}
+
+void ASRServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    if (accept_thread_.joinable()) {
+        accept_thread_.join();
+    }
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+    }
+
+    // Connection threads notice running_ within one poll period and close their sessions
+    {
+        std::unique_lock<std::mutex> lock(sessions_mutex_);
+        sessions_cv_.wait(lock, [this] { return connections_ == 0; });
+    }
+
+    notifyVad();
+    if (vad_thread_.joinable()) {
+        vad_thread_.join();
+    }
+    vad_.setResultCallback(nullptr);
+}
+
+void ASRServer::acceptLoop() {
+    while (running_.load()) {
+        struct pollfd pfd = {listen_fd_, POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0) {
+            continue;
+        }
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex_);
+            ++connections_;
+        }
+        std::thread([this, fd] {
+            // A failing connection must only end itself, never the process
+            try {
+                handleConnection(fd);
+            } catch (const std::exception& e) {
+                std::cerr << "Connection failed: " << e.what() << std::endl;
+            } catch (...) {
+                std::cerr << "Connection failed" << std::endl;
+            }
+            std::lock_guard<std::mutex> lock(sessions_mutex_);
+            --connections_;
+            sessions_cv_.notify_all();
+        }).detach();
+    }
+}
+
+void ASRServer::vadLoop() {
+    while (running_.load()) {
+        if (vad_.process() > 0) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(vad_mutex_);
+        vad_cv_.wait_for(lock, std::chrono::milliseconds(10), [this] { return vad_pending_ || !running_.load(); });
+        vad_pending_ = false;
+    }
+}
+
+void ASRServer::notifyVad() {
+    {
+        std::lock_guard<std::mutex> lock(vad_mutex_);
+        vad_pending_ = true;
+    }
+    vad_cv_.notify_one();
+}
+
+void ASRServer::handleConnection(int fd) {
+    auto connection = std::make_shared<WebSocketConnection>(fd, config_.max_message_bytes);
+    connection->setTimeouts(config_.socket_timeout_ms, config_.socket_timeout_ms);
+
+    HttpRequest request;
+    if (!connection->readRequest(request)) {
+        return;
+    }
+
+    if (!request.isWebSocketUpgrade()) {
+        if (request.method == "GET" && request.path == "/metrics") {
+            connection->sendHttpResponse(200, "OK", "text/plain; version=0.0.4", metricsText());
+        } else if (request.method == "GET" && request.path == "/healthz") {
+            connection->sendHttpResponse(200, "OK", "text/plain", "ok\n");
+        } else {
+            connection->sendHttpResponse(404, "Not Found", "text/plain", "not found\n");
+        }
+        return;
+    }
+
+    int sample_rate = std::atoi(request.queryParam("sample_rate", "16000").c_str());
+    if (sample_rate < 8000 || sample_rate > 192000) {
+        connection->sendHttpResponse(400, "Bad Request", "text/plain", "unsupported sample_rate\n");
+        return;
+    }
+
+    auto session = openSession(connection, sample_rate, request.queryParam("language"));
+    if (!session) {
+        sessions_rejected_++;
+        connection->sendHttpResponse(503, "Service Unavailable", "text/plain", "too many sessions\n");
+        return;
+    }
+
+    if (connection->acceptUpgrade(request)) {
+        connection->sendText("{\"type\":\"ready\",\"session\":" + std::to_string(session->stream_id) + "}");
+        try {
+            runSession(session);
+        } catch (const std::exception& e) {
+            std::cerr << "Session " << session->stream_id << " failed: " << e.what() << std::endl;
+            connection->close(1011, "internal error");
+        } catch (...) {
+            std::cerr << "Session " << session->stream_id << " failed" << std::endl;
+            connection->close(1011, "internal error");
+        }
+    }
+    closeSession(session);
+}
+
+std::shared_ptr<ASRServer::Session> ASRServer::openSession(const std::shared_ptr<WebSocketConnection>& connection,
+                                                           int sample_rate, const std::string& language) {
+    if (active_sessions_.load() >= config_.max_sessions) {
+        return nullptr;
+    }
+    int stream_id = vad_.addStream();
+    if (stream_id < 0) {
+        return nullptr;
+    }
+    if (static_cast<size_t>(stream_id) >= config_.max_sessions) {
+        vad_.removeStream(stream_id);
+        return nullptr;
+    }
+
+    auto session = std::make_shared<Session>();
+    session->connection = connection;
+    session->stream_id = stream_id;
+    session->language = language;
+    session->resampler = std::make_unique<Resampler>(sample_rate, vad_.getSampleRate());
+
+    if (config_.partial_results) {
+        StreamingRecognizer::Config streaming_config;
+        streaming_config.chunk_frames = config_.partial_chunk_frames;
+        session->streaming = std::make_unique<StreamingRecognizer>(model_, streaming_config);
+        if (!session->streaming->initialize()) {
+            session->streaming.reset();
+        } else {
+            // The session outlives its recognizer, and reset() waits out a callback in flight
+            Session* raw = session.get();
+            session->streaming->setResultCallback([raw](const std::string& text, bool is_final) {
+                if (is_final || text.empty()) {
+                    return;
+                }
+                raw->connection->sendText("{\"type\":\"partial\",\"segment\":" +
+                                          std::to_string(raw->segment_index.load()) +
+                                          ",\"text\":\"" + jsonEscape(text) + "\"}");
+            });
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        sessions_[stream_id] = session;
+    }
+    active_sessions_++;
+    sessions_total_++;
+    return session;
+}
+
+void ASRServer::closeSession(const std::shared_ptr<Session>& session) {
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        sessions_[session->stream_id] = nullptr;
+    }
+    vad_.removeStream(session->stream_id);
+    session->connection->close(1000);
+    if (session->streaming) {
+        session->streaming->reset();
+    }
+    active_sessions_--;
+}
+
+void ASRServer::onVadResult(int stream_id, float probability, size_t window_index) {
+    std::shared_ptr<Session> session;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        if (stream_id >= 0 && static_cast<size_t>(stream_id) < sessions_.size()) {
+            session = sessions_[stream_id];
+        }
+    }
+    if (!session) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        session->vad_results.emplace_back(window_index, probability);
+    }
+    session->cv.notify_all();
+}
+
+void ASRServer::runSession(const std::shared_ptr<Session>& session) {
+    WebSocketConnection& connection = *session->connection;
+    WebSocketConnection::Message message;
+    auto stalled_since = std::chrono::steady_clock::now();
+    bool stalled = false;
+
+    while (running_.load() && connection.isOpen()) {
+        processVadResults(session);
+
+        if (shouldPause(*session)) {
+            auto now = std::chrono::steady_clock::now();
+            if (!stalled) {
+                stalled = true;
+                stalled_since = now;
+                backpressure_pauses_++;
+            } else if (std::chrono::duration<double>(now - stalled_since).count() > config_.max_stall_seconds) {
+                connection.sendText(errorMessage("session stalled"));
+                connection.close(1011, "stalled");
+                return;
+            }
+            std::unique_lock<std::mutex> lock(session->mutex);
+            session->cv.wait_for(lock, std::chrono::milliseconds(10));
+            continue;
+        }
+        stalled = false;
+
+        if (!connection.waitReadable(10)) {
+            continue;
+        }
+
+        auto status = connection.readMessage(message);
+        if (status == WebSocketConnection::ReadStatus::TooBig) {
+            connection.sendText(errorMessage("message too large"));
+            connection.close(1009, "message too large");
+            return;
+        }
+        if (status != WebSocketConnection::ReadStatus::Message) {
+            return;
+        }
+
+        if (message.opcode == WebSocketConnection::Opcode::Binary) {
+            acceptAudio(session, message.payload);
+        } else if (message.payload.find("\"end\"") != std::string::npos) {
+            if (flushSession(session)) {
+                connection.sendText("{\"type\":\"end\"}");
+            }
+            connection.close(1000);
+            return;
+        } else {
+            connection.sendText(errorMessage("unknown command"));
+        }
+    }
+}
+
+void ASRServer::acceptAudio(const std::shared_ptr<Session>& session, const std::string& pcm) {
+    bytes_received_ += pcm.size();
+    const size_t count = pcm.size() / 2;
+    if (count == 0) {
+        return;
+    }
+
+    // s16le; byte order is spelled out so big-endian hosts read it the same
+    session->pcm_buffer.resize(count);
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(pcm.data());
+    for (size_t i = 0; i < count; ++i) {
+        int16_t sample = static_cast<int16_t>(bytes[2 * i] | (bytes[2 * i + 1] << 8));
+        session->pcm_buffer[i] = sample / 32768.0f;
+    }
+
+    session->resampled_buffer.clear();
+    session->resampler->process(session->pcm_buffer.data(), count, session->resampled_buffer);
+    if (session->resampled_buffer.empty()) {
+        return;
+    }
+
+    session->pending.insert(session->pending.end(), session->resampled_buffer.begin(),
+                            session->resampled_buffer.end());
+    session->samples_pushed += session->resampled_buffer.size();
+    vad_.pushAudio(session->stream_id, session->resampled_buffer);
+    notifyVad();
+}
+
+void ASRServer::processVadResults(const std::shared_ptr<Session>& session) {
+    std::deque<std::pair<size_t, float>> results;
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        results.swap(session->vad_results);
+    }
+    for (const auto& result : results) {
+        processWindow(session, result.first, result.second);
+    }
+}
+
+void ASRServer::processWindow(const std::shared_ptr<Session>& session, size_t window_index, float probability) {
+    // A result for a window we are not waiting for belongs to the slot's previous owner
+    if (window_index != session->next_window) {
+        return;
+    }
+    session->next_window++;
+
+    const size_t window = static_cast<size_t>(vad_.getWindowSize());
+    const double rate = vad_.getSampleRate();
+    const size_t pre_samples = static_cast<size_t>(config_.pre_speech_seconds * rate);
+    const size_t begin = window_index * window;
+    const size_t end = begin + window;
+    const float* samples = session->pending.data() + (begin - session->pending_start);
+
+    if (!session->in_speech) {
+        if (probability >= config_.trigger_threshold) {
+            size_t start = std::max({session->pending_start, session->segment_floor,
+                                     begin > pre_samples ? begin - pre_samples : size_t(0)});
+            const float* first = session->pending.data() + (start - session->pending_start);
+            session->segment.assign(first, samples + window);
+            session->segment_start = start;
+            session->speech_start = begin;
+            session->silence_samples = 0;
+            session->in_speech = true;
+            if (session->streaming) {
+                session->streaming->acceptWaveform(session->segment.data(), session->segment.size());
+            }
+        }
+    } else {
+        session->segment.insert(session->segment.end(), samples, samples + window);
+        if (session->streaming) {
+            session->streaming->acceptWaveform(samples, window);
+        }
+        if (probability >= config_.trigger_threshold) {
+            session->silence_samples = 0;
+        } else if (probability < config_.stop_threshold) {
+            session->silence_samples += window;
+        }
+
+        if (session->silence_samples >= static_cast<size_t>(config_.min_silence_seconds * rate) ||
+            session->segment.size() >= static_cast<size_t>(config_.max_segment_seconds * rate)) {
+            endSegment(session);
+        }
+    }
+
+    // Keep the pre-speech audio the next trigger may reach back into; trim in larger steps
+    size_t keep_from = end > pre_samples ? end - pre_samples : 0;
+    if (keep_from > session->pending_start + 8 * window) {
+        session->pending.erase(session->pending.begin(),
+                               session->pending.begin() + (keep_from - session->pending_start));
+        session->pending_start = keep_from;
+    }
+}
+
+void ASRServer::endSegment(const std::shared_ptr<Session>& session) {
+    const double rate = vad_.getSampleRate();
+    const size_t segment_end = session->segment_start + session->segment.size();
+    std::vector<float> audio = std::move(session->segment);
+    session->segment.clear();
+    session->in_speech = false;
+    session->segment_floor = segment_end;
+
+    // Trailing silence beyond the pre-speech margin carries no speech; drop it
+    const size_t pad = static_cast<size_t>(config_.pre_speech_seconds * rate);
+    if (session->silence_samples > pad) {
+        audio.resize(audio.size() - (session->silence_samples - pad));
+    }
+    session->silence_samples = 0;
+
+    // Stop partials for this segment before its final is queued
+    if (session->streaming) {
+        session->streaming->reset();
+    }
+    const int index = session->segment_index.fetch_add(1);
+
+    const double start = session->segment_start / rate;
+    const double end = (session->segment_start + audio.size()) / rate;
+    const size_t samples = audio.size();
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        session->finals_in_flight++;
+        session->final_samples_in_flight += samples;
+    }
+
+    scheduler_.submit(std::move(audio), [session, index, start, end, samples](const std::string& text) {
+        std::ostringstream out;
+        out << "{\"type\":\"final\",\"segment\":" << index << ",\"start\":" << start << ",\"end\":" << end
+            << ",\"text\":\"" << jsonEscape(text) << "\"}";
+        session->connection->sendText(out.str());
+        {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            session->finals_in_flight--;
+            session->final_samples_in_flight -= samples;
+        }
+        session->cv.notify_all();
+    }, session->language);
+}
+
+bool ASRServer::flushSession(const std::shared_ptr<Session>& session) {
+    // Push the resampler's delay line and zero-pad to a whole window so the tail is decided
+    session->resampled_buffer.clear();
+    session->resampler->flush(session->resampled_buffer);
+    const size_t window = static_cast<size_t>(vad_.getWindowSize());
+    size_t total = session->samples_pushed + session->resampled_buffer.size();
+    session->resampled_buffer.resize(session->resampled_buffer.size() + (window - total % window) % window, 0.0f);
+    if (!session->resampled_buffer.empty()) {
+        session->pending.insert(session->pending.end(), session->resampled_buffer.begin(),
+                                session->resampled_buffer.end());
+        session->samples_pushed += session->resampled_buffer.size();
+        vad_.pushAudio(session->stream_id, session->resampled_buffer);
+        notifyVad();
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(config_.max_stall_seconds);
+    while (session->next_window * window < session->samples_pushed) {
+        if (!running_.load() || std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        {
+            std::unique_lock<std::mutex> lock(session->mutex);
+            session->cv.wait_for(lock, std::chrono::milliseconds(10), [&] { return !session->vad_results.empty(); });
+        }
+        processVadResults(session);
+    }
+    if (session->in_speech) {
+        endSegment(session);
+    }
+
+    std::unique_lock<std::mutex> lock(session->mutex);
+    return session->cv.wait_until(lock, deadline, [&] { return session->finals_in_flight == 0; });
+}
+
+size_t ASRServer::sessionMemory(const Session& session) const {
+    size_t samples = session.pending.size() + session.segment.size() + session.final_samples_in_flight;
+    // The partial front-end's features add about 58% of the segment's sample bytes on top
+    size_t streaming = session.streaming ? session.streaming->memoryBytes() : 0;
+    return samples * sizeof(float) + streaming;
+}
+
+bool ASRServer::shouldPause(const Session& session) const {
+    const size_t window = static_cast<size_t>(vad_.getWindowSize());
+    const size_t backlog = session.samples_pushed - std::min(session.samples_pushed, session.next_window * window);
+    if (backlog > static_cast<size_t>(config_.max_backlog_seconds * vad_.getSampleRate())) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(session.mutex);
+    return session.finals_in_flight >= config_.max_pending_finals ||
+           sessionMemory(session) > config_.max_session_memory_bytes;
+}
+
+std::string ASRServer::metricsText() const {
+    std::ostringstream out;
+    out << Metrics::instance().prometheusText()
+        << "# HELP sensevoice_server_active_sessions Streaming sessions currently open.\n"
+        << "# TYPE sensevoice_server_active_sessions gauge\n"
+        << "sensevoice_server_active_sessions " << active_sessions_.load() << "\n"
+        << "# HELP sensevoice_server_sessions_total Streaming sessions accepted.\n"
+        << "# TYPE sensevoice_server_sessions_total counter\n"
+        << "sensevoice_server_sessions_total " << sessions_total_.load() << "\n"
+        << "# HELP sensevoice_server_sessions_rejected_total Upgrades refused at max_sessions.\n"
+        << "# TYPE sensevoice_server_sessions_rejected_total counter\n"
+        << "sensevoice_server_sessions_rejected_total " << sessions_rejected_.load() << "\n"
+        << "# HELP sensevoice_server_backpressure_pauses_total Times a session stopped reading its socket.\n"
+        << "# TYPE sensevoice_server_backpressure_pauses_total counter\n"
+        << "sensevoice_server_backpressure_pauses_total " << backpressure_pauses_.load() << "\n"
+        << "# HELP sensevoice_server_received_bytes_total PCM bytes received.\n"
+        << "# TYPE sensevoice_server_received_bytes_total counter\n"
+        << "sensevoice_server_received_bytes_total " << bytes_received_.load() << "\n"
+        << "# HELP sensevoice_server_pending_finals Segments waiting in the batch scheduler.\n"
+        << "# TYPE sensevoice_server_pending_finals gauge\n"
+        << "sensevoice_server_pending_finals " << scheduler_.pendingRequests() << "\n";
+    return out.str();
+}
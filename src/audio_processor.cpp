@@ -1,25 +1,71 @@
 #include "audio_processor.hpp"
+#include "simd_utils.hpp"
 #include <iostream>
 #include <fstream>
 #include <cmath>
 #include <algorithm>
 #include <numeric>
+#include <mutex>
+#include <set>
+#include <string>
+#include <cstdio>
 #include <fftw3.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+namespace {
+// The FFTW planner (and wisdom) is not thread-safe; execution of an existing plan is
+std::mutex& fftwPlannerMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+// Wisdom files already merged into the process-wide wisdom; guarded by the planner mutex
+std::set<std::string>& importedWisdomFiles() {
+    static std::set<std::string> files;
+    return files;
+}
+
+// Writes through a temp file and a rename so concurrent processes never read a torn file
+void saveWisdom(const std::string& path, const std::string& wisdom) {
+    static std::mutex write_mutex;
+    std::lock_guard<std::mutex> lock(write_mutex);
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        out << wisdom;
+        if (!out) {
+            std::cerr << "Failed to write FFTW wisdom: " << temp_path << std::endl;
+            std::remove(temp_path.c_str());
+            return;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to replace FFTW wisdom: " << path << std::endl;
+        std::remove(temp_path.c_str());
+    }
+}
+}
+
 AudioProcessor::AudioProcessor(const Config& config) : config_(config) {
+    config_.fft_batch_frames = std::max(1, config_.fft_batch_frames);
 }
 
 AudioProcessor::~AudioProcessor() {
+    destroyFFT();
 }
 
 bool AudioProcessor::initialize() {
     initializeMelFilterbank();
     initializeWindow();
     
+    if (!initializeFFT()) {
+        std::cerr << "Failed to create FFT plans" << std::endl;
+        return false;
+    }
+    
     if (!config_.cmvn_file.empty()) {
         loadCMVN(config_.cmvn_file);
     }
@@ -32,7 +78,8 @@ void AudioProcessor::initializeMelFilterbank() {
     int num_filters = config_.n_mels;
     int fft_size = config_.n_fft / 2 + 1;
     
-    mel_filterbank_.resize(num_filters);
+    mel_spans_.resize(num_filters);
+    mel_weights_.clear();
     
     // Mel scale conversion
     auto hz_to_mel = [](float hz) {
@@ -65,9 +112,10 @@ void AudioProcessor::initializeMelFilterbank() {
         bin_points[i] = std::min(bin_points[i], fft_size - 1);
     }
     
-    // Create triangular filters
+    // Create triangular filters, keeping only the non-zero bins of each
+    std::vector<float> filter(fft_size);
     for (int i = 0; i < num_filters; ++i) {
-        mel_filterbank_[i].resize(fft_size, 0.0f);
+        std::fill(filter.begin(), filter.end(), 0.0f);
         
         int start = bin_points[i];
         int center = bin_points[i + 1];
@@ -76,16 +124,118 @@ void AudioProcessor::initializeMelFilterbank() {
         // Left side of triangle
         for (int j = start; j < center; ++j) {
             if (center != start) {
-                mel_filterbank_[i][j] = static_cast<float>(j - start) / (center - start);
+                filter[j] = static_cast<float>(j - start) / (center - start);
             }
         }
         
         // Right side of triangle
         for (int j = center; j < end; ++j) {
             if (end != center) {
-                mel_filterbank_[i][j] = static_cast<float>(end - j) / (end - center);
+                filter[j] = static_cast<float>(end - j) / (end - center);
+            }
+        }
+        
+        int first = 0;
+        int last = fft_size - 1;
+        while (first < fft_size && filter[first] == 0.0f) ++first;
+        while (last >= first && filter[last] == 0.0f) --last;
+        
+        MelSpan& span = mel_spans_[i];
+        span.start_bin = std::min(first, fft_size - 1);
+        span.num_bins = std::max(0, last - first + 1);
+        span.weight_offset = mel_weights_.size();
+        mel_weights_.insert(mel_weights_.end(), filter.begin() + span.start_bin,
+                            filter.begin() + span.start_bin + span.num_bins);
+    }
+}
+
+bool AudioProcessor::initializeFFT() {
+    destroyFFT();
+    
+    const int n = config_.n_fft;
+    const int bins = n / 2 + 1;
+    const int batch = config_.fft_batch_frames;
+    
+    std::string new_wisdom;
+    {
+        std::lock_guard<std::mutex> lock(fftwPlannerMutex());
+        
+        fft_in_ = fftwf_alloc_real(static_cast<size_t>(batch) * n);
+        fft_out_ = reinterpret_cast<float*>(fftwf_alloc_complex(static_cast<size_t>(batch) * bins));
+        if (!fft_in_ || !fft_out_) {
+            return false;
+        }
+        
+        bool has_wisdom_file = !config_.fft_wisdom_file.empty();
+        if (has_wisdom_file && importedWisdomFiles().insert(config_.fft_wisdom_file).second) {
+            fftwf_import_wisdom_from_filename(config_.fft_wisdom_file.c_str());
+        }
+        // ESTIMATE plans produce no wisdom
+        bool use_wisdom = has_wisdom_file && config_.fft_measure;
+        
+        // MEASURE overwrites the buffers while planning, so plan before any data is written
+        unsigned flags = config_.fft_measure ? FFTW_MEASURE : FFTW_ESTIMATE;
+        auto* out = reinterpret_cast<fftwf_complex*>(fft_out_);
+        auto plan = [&](unsigned plan_flags) {
+            fft_plan_ = fftwf_plan_dft_r2c_1d(n, fft_in_, out, plan_flags);
+            fft_batch_plan_ = fftwf_plan_many_dft_r2c(1, &n, batch,
+                                                      fft_in_, nullptr, 1, n,
+                                                      out, nullptr, 1, bins, plan_flags);
+        };
+        
+        // Plans fully covered by existing wisdom add nothing worth saving
+        bool planned_from_wisdom = false;
+        if (use_wisdom) {
+            plan(flags | FFTW_WISDOM_ONLY);
+            planned_from_wisdom = fft_plan_ && fft_batch_plan_;
+            if (!planned_from_wisdom) {
+                destroyPlans();
             }
         }
+        if (!planned_from_wisdom) {
+            plan(flags);
+            if (use_wisdom && fft_plan_ && fft_batch_plan_) {
+                char* wisdom = fftwf_export_wisdom_to_string();
+                if (wisdom) {
+                    new_wisdom = wisdom;
+                    fftwf_free(wisdom);
+                }
+            }
+        }
+    }
+    if (!new_wisdom.empty()) {
+        saveWisdom(config_.fft_wisdom_file, new_wisdom);
+    }
+    
+    // Frame tails beyond frame_length stay zero from here on
+    std::fill(fft_in_, fft_in_ + static_cast<size_t>(batch) * n, 0.0f);
+    power_buffer_.assign(static_cast<size_t>(batch) * bins, 0.0f);
+    
+    return fft_plan_ && fft_batch_plan_;
+}
+
+void AudioProcessor::destroyPlans() {
+    if (fft_plan_) {
+        fftwf_destroy_plan(fft_plan_);
+        fft_plan_ = nullptr;
+    }
+    if (fft_batch_plan_) {
+        fftwf_destroy_plan(fft_batch_plan_);
+        fft_batch_plan_ = nullptr;
+    }
+}
+
+void AudioProcessor::destroyFFT() {
+    std::lock_guard<std::mutex> lock(fftwPlannerMutex());
+    
+    destroyPlans();
+    if (fft_in_) {
+        fftwf_free(fft_in_);
+        fft_in_ = nullptr;
+    }
+    if (fft_out_) {
+        fftwf_free(fft_out_);
+        fft_out_ = nullptr;
     }
 }
 
@@ -106,6 +256,10 @@ void AudioProcessor::loadCMVN(const std::string& cmvn_file) {
     // For now, we'll initialize with dummy values
     cmvn_mean_.assign(config_.n_mels, 0.0f);
     cmvn_var_.assign(config_.n_mels, 1.0f);
+    cmvn_inv_std_.resize(cmvn_var_.size());
+    for (size_t i = 0; i < cmvn_var_.size(); ++i) {
+        cmvn_inv_std_[i] = 1.0f / std::sqrt(cmvn_var_[i]);
+    }
     cmvn_loaded_ = true;
     
     std::cout << "CMVN loaded (dummy implementation)" << std::endl;
@@ -116,189 +270,202 @@ std::vector<std::vector<float>> AudioProcessor::extractFeatures(const std::vecto
 }
 
 std::vector<std::vector<float>> AudioProcessor::extractFeatures(const float* audio, size_t length) {
-    // Preprocess audio
-    std::vector<float> preprocessed_audio(audio, audio + length);
-    preprocessed_audio = preprocess(preprocessed_audio);
+    size_t num_frames = getNumLFRFrames(length);
+    size_t feature_dim = getFeatureDim();
+    
+    std::vector<float> flat(num_frames * feature_dim);
+    num_frames = extractFeatures(audio, length, flat.data(), num_frames);
+    
+    std::vector<std::vector<float>> features(num_frames);
+    for (size_t i = 0; i < num_frames; ++i) {
+        features[i].assign(flat.begin() + i * feature_dim, flat.begin() + (i + 1) * feature_dim);
+    }
     
-    // Extract fbank features
-    auto fbank_features = computeFbank(preprocessed_audio);
+    return features;
+}
+
+size_t AudioProcessor::extractFeatures(const float* audio, size_t length, float* output, size_t max_frames) {
+    size_t num_fbank_frames = getNumFbankFrames(length);
+    size_t num_frames = getNumLFRFrames(length);
+    if (num_frames == 0 || num_frames > max_frames) {
+        return 0;
+    }
     
-    // Apply LFR (Low Frame Rate) if needed
-    fbank_features = applyLFR(fbank_features);
+    // Preemphasis -> fbank -> LFR -> CMVN, all through reused contiguous buffers
+    if (signal_buffer_.size() < length) {
+        signal_buffer_.resize(length);
+    }
+    preemphasize(audio, length, signal_buffer_.data());
     
-    // Apply CMVN
-    if (cmvn_loaded_) {
-        applyCMVN(fbank_features);
+    if (fbank_buffer_.size() < num_fbank_frames * config_.n_mels) {
+        fbank_buffer_.resize(num_fbank_frames * config_.n_mels);
     }
+    computeFbankInto(signal_buffer_.data(), length, fbank_buffer_.data());
     
-    return fbank_features;
+    applyLFRInto(fbank_buffer_.data(), num_fbank_frames, output);
+    applyCMVNInto(output, num_frames);
+    
+    return num_frames;
 }
 
 std::vector<float> AudioProcessor::preprocess(const std::vector<float>& audio) {
-    std::vector<float> result = audio;
+    std::vector<float> result(audio.size());
+    preemphasize(audio.data(), audio.size(), result.data());
+    return result;
+}
+
+void AudioProcessor::preemphasize(const float* audio, size_t length, float* output) {
+    if (length == 0) {
+        return;
+    }
     
-    // Apply preemphasis
+    // Apply preemphasis (output may alias audio)
     if (config_.preemphasis > 0.0f) {
-        for (size_t i = result.size() - 1; i > 0; --i) {
-            result[i] = result[i] - config_.preemphasis * result[i - 1];
+        for (size_t i = length - 1; i > 0; --i) {
+            output[i] = audio[i] - config_.preemphasis * audio[i - 1];
         }
+        output[0] = audio[0];
+    } else if (output != audio) {
+        std::copy(audio, audio + length, output);
     }
-    
-    return result;
 }
 
 std::vector<std::vector<float>> AudioProcessor::computeFbank(const std::vector<float>& audio) {
-    // Frame the signal
-    auto frames = frameSignal(audio);
-    
-    std::vector<std::vector<float>> fbank_features;
-    fbank_features.reserve(frames.size());
-    
-    for (const auto& frame : frames) {
-        // Apply window and pad to FFT size
-        std::vector<float> windowed_frame(config_.n_fft, 0.0f);
-        size_t copy_len = std::min(frame.size(), window_.size());
-        for (size_t i = 0; i < copy_len; ++i) {
-            windowed_frame[i] = frame[i] * window_[i];
-        }
-        
-        // Compute FFT
-        auto fft_result = fft(windowed_frame);
-        
-        // Compute power spectrum
-        auto power_spectrum = computePowerSpectrum(fft_result);
-        
-        // Apply mel filterbank
-        auto mel_features = applyMelFilterbank(power_spectrum);
-        
-        // Convert to log scale
-        for (float& val : mel_features) {
-            val = std::log(std::max(val, 1e-10f));
-        }
-        
-        fbank_features.push_back(mel_features);
+    size_t num_frames = getNumFbankFrames(audio.size());
+    std::vector<float> flat(num_frames * config_.n_mels);
+    computeFbankInto(audio.data(), audio.size(), flat.data());
+    
+    std::vector<std::vector<float>> fbank_features(num_frames);
+    for (size_t i = 0; i < num_frames; ++i) {
+        fbank_features[i].assign(flat.begin() + i * config_.n_mels, flat.begin() + (i + 1) * config_.n_mels);
     }
     
     return fbank_features;
 }
 
-std::vector<std::vector<float>> AudioProcessor::frameSignal(const std::vector<float>& signal) {
-    std::vector<std::vector<float>> frames;
-    
-    int num_frames = static_cast<int>((signal.size() - config_.frame_length) / config_.frame_shift) + 1;
-    frames.reserve(num_frames);
-    
-    for (int i = 0; i < num_frames; ++i) {
-        int start = i * config_.frame_shift;
-        int end = start + config_.frame_length;
-        
-        std::vector<float> frame;
-        if (end <= static_cast<int>(signal.size())) {
-            frame.assign(signal.begin() + start, signal.begin() + end);
-        } else {
-            frame.assign(signal.begin() + start, signal.end());
-            frame.resize(config_.frame_length, 0.0f); // Zero pad
+size_t AudioProcessor::computeFbankInto(const float* signal, size_t length, float* output) {
+    // Frames are read in place from the signal; only full frames are produced
+    size_t num_frames = getNumFbankFrames(length);
+    const size_t n = config_.n_fft;
+    const size_t batch = config_.fft_batch_frames;
+    const auto* spectra = reinterpret_cast<const std::complex<float>*>(fft_out_);
+    
+    // Full blocks go through the many-frame plan in one execution
+    size_t frame = 0;
+    for (; frame + batch <= num_frames; frame += batch) {
+        for (size_t k = 0; k < batch; ++k) {
+            windowFrame(signal + (frame + k) * config_.frame_shift, fft_in_ + k * n);
         }
-        
-        frames.push_back(frame);
+        fftwf_execute(fft_batch_plan_);
+        spectraToLogMel(spectra, batch, output + frame * config_.n_mels);
+    }
+    
+    // Remaining frames use the single-frame plan
+    for (; frame < num_frames; ++frame) {
+        computeFbankFrame(signal + frame * config_.frame_shift, output + frame * config_.n_mels);
     }
     
-    return frames;
+    return num_frames;
 }
 
-std::vector<std::complex<float>> AudioProcessor::fft(const std::vector<float>& signal) {
-    // Use FFTW for highly optimized FFT computation
-    int N = signal.size();
-    
-    // Allocate FFTW arrays
-    float* in = fftwf_alloc_real(N);
-    fftwf_complex* out = fftwf_alloc_complex(N);
-    
-    // Copy input data
-    for (int i = 0; i < N; ++i) {
-        in[i] = signal[i];
+void AudioProcessor::computeFbankFrame(const float* frame, float* mel_features) {
+    windowFrame(frame, fft_in_);
+    fftwf_execute(fft_plan_);
+    spectraToLogMel(reinterpret_cast<const std::complex<float>*>(fft_out_), 1, mel_features);
+}
+
+void AudioProcessor::windowFrame(const float* frame, float* fft_input) {
+    // Apply window; the zero padding up to n_fft is never overwritten
+    size_t copy_len = std::min(static_cast<size_t>(config_.frame_length), window_.size());
+    for (size_t i = 0; i < copy_len; ++i) {
+        fft_input[i] = frame[i] * window_[i];
     }
-    
-    // Create plan and execute
-    fftwf_plan plan = fftwf_plan_dft_r2c_1d(N, in, out, FFTW_ESTIMATE);
-    fftwf_execute(plan);
-    
-    // Convert to std::complex format
-    std::vector<std::complex<float>> result(N/2 + 1);
-    for (int i = 0; i < N/2 + 1; ++i) {
-        result[i] = std::complex<float>(out[i][0], out[i][1]);
+}
+
+void AudioProcessor::spectraToLogMel(const std::complex<float>* spectra, size_t num_frames, float* mel_features) {
+    // Power spectrum, sparse mel and log floor run over the whole block of frames at once
+    computePowerSpectrum(spectra, power_buffer_.data(), num_frames);
+    applyMelFilterbank(power_buffer_.data(), mel_features, num_frames);
+    
+    size_t count = num_frames * config_.n_mels;
+    simd::clampMin(mel_features, count, 1e-10f);
+    simd::logInPlace(mel_features, count);
+}
+
+void AudioProcessor::computePowerSpectrum(const std::complex<float>* fft_result, float* power_spectrum,
+                                          size_t num_frames) {
+    // Spectra of consecutive frames are contiguous, so the whole block is one pass
+    size_t count = num_frames * (config_.n_fft / 2 + 1);
+    simd::powerSpectrum(reinterpret_cast<const float*>(fft_result), power_spectrum, count);
+}
+
+void AudioProcessor::applyMelFilterbank(const float* power_spectrum, float* mel_features, size_t num_frames) {
+    const size_t fft_bins = config_.n_fft / 2 + 1;
+    
+    for (size_t t = 0; t < num_frames; ++t) {
+        const float* power = power_spectrum + t * fft_bins;
+        float* mel = mel_features + t * config_.n_mels;
+        for (int i = 0; i < config_.n_mels; ++i) {
+            const MelSpan& span = mel_spans_[i];
+            mel[i] = simd::dotProduct(power + span.start_bin, mel_weights_.data() + span.weight_offset, span.num_bins);
+        }
     }
-    
-    // Cleanup
-    fftwf_destroy_plan(plan);
-    fftwf_free(in);
-    fftwf_free(out);
-    
-    return result;
 }
 
-std::vector<float> AudioProcessor::computePowerSpectrum(const std::vector<std::complex<float>>& fft_result) {
-    std::vector<float> power_spectrum;
-    power_spectrum.reserve(fft_result.size());
+std::vector<std::vector<float>> AudioProcessor::applyLFR(const std::vector<std::vector<float>>& features) {
+    if (features.empty()) {
+        return features;
+    }
     
-    for (const auto& val : fft_result) {
-        float magnitude = std::abs(val);
-        power_spectrum.push_back(magnitude * magnitude);
+    size_t num_frames = features.size();
+    size_t dim = features[0].size();
+    std::vector<float> flat(num_frames * dim);
+    for (size_t i = 0; i < num_frames; ++i) {
+        std::copy(features[i].begin(), features[i].end(), flat.begin() + i * dim);
     }
     
-    return power_spectrum;
-}
-
-std::vector<float> AudioProcessor::applyMelFilterbank(const std::vector<float>& power_spectrum) {
-    std::vector<float> mel_features(config_.n_mels, 0.0f);
+    size_t lfr_frames = (num_frames + config_.lfr_n - 1) / config_.lfr_n;
+    size_t lfr_dim = dim * config_.lfr_m;
+    std::vector<float> lfr_flat(lfr_frames * lfr_dim);
     
-    for (int i = 0; i < config_.n_mels; ++i) {
-        for (size_t j = 0; j < power_spectrum.size() && j < mel_filterbank_[i].size(); ++j) {
-            mel_features[i] += power_spectrum[j] * mel_filterbank_[i][j];
+    // applyLFRInto works on n_mels wide rows, so stack here for arbitrary widths
+    for (size_t i = 0; i < lfr_frames; ++i) {
+        for (int j = 0; j < config_.lfr_m; ++j) {
+            size_t frame_idx = std::min(i * config_.lfr_n + j, num_frames - 1);
+            std::copy(flat.begin() + frame_idx * dim, flat.begin() + (frame_idx + 1) * dim,
+                      lfr_flat.begin() + i * lfr_dim + j * dim);
         }
     }
     
-    return mel_features;
+    std::vector<std::vector<float>> lfr_features(lfr_frames);
+    for (size_t i = 0; i < lfr_frames; ++i) {
+        lfr_features[i].assign(lfr_flat.begin() + i * lfr_dim, lfr_flat.begin() + (i + 1) * lfr_dim);
+    }
+    
+    return lfr_features;
 }
 
-std::vector<std::vector<float>> AudioProcessor::applyLFR(const std::vector<std::vector<float>>& features) {
+void AudioProcessor::applyLFRInto(const float* fbank, size_t num_frames, float* output) {
     // LFR (Low Frame Rate) implementation
     // Based on config: lfr_m=7, lfr_n=6
     // Concatenate lfr_m consecutive frames, then downsample by lfr_n
-    const int lfr_m = 7;  // number of frames to concatenate
-    const int lfr_n = 6;  // downsample rate
+    const int lfr_m = config_.lfr_m;  // number of frames to concatenate
+    const int lfr_n = config_.lfr_n;  // downsample rate
+    const size_t dim = config_.n_mels;
     
-    if (features.empty()) {
-        return features;
+    if (num_frames == 0) {
+        return;
     }
     
-    std::vector<std::vector<float>> lfr_features;
-    int feature_dim = features[0].size();
-    
-    // Process frames with LFR
-    for (size_t i = 0; i < features.size(); i += lfr_n) {
-        std::vector<float> lfr_frame;
-        lfr_frame.reserve(feature_dim * lfr_m);
-        
-        // Concatenate lfr_m frames
+    float* out = output;
+    for (size_t i = 0; i < num_frames; i += lfr_n) {
         for (int j = 0; j < lfr_m; ++j) {
-            size_t frame_idx = i + j;
-            if (frame_idx < features.size()) {
-                // Use existing frame
-                lfr_frame.insert(lfr_frame.end(), 
-                               features[frame_idx].begin(), features[frame_idx].end());
-            } else {
-                // Pad with last frame if not enough frames
-                size_t last_idx = features.size() - 1;
-                lfr_frame.insert(lfr_frame.end(), 
-                               features[last_idx].begin(), features[last_idx].end());
-            }
+            // Pad with last frame if not enough frames
+            size_t frame_idx = std::min(i + j, num_frames - 1);
+            std::copy(fbank + frame_idx * dim, fbank + (frame_idx + 1) * dim, out);
+            out += dim;
         }
-        
-        lfr_features.push_back(lfr_frame);
     }
-    
-    return lfr_features;
 }
 
 void AudioProcessor::applyCMVN(std::vector<std::vector<float>>& features) {
@@ -309,7 +476,35 @@ void AudioProcessor::applyCMVN(std::vector<std::vector<float>>& features) {
     // Apply CMVN normalization
     for (auto& frame : features) {
         for (size_t i = 0; i < frame.size() && i < cmvn_mean_.size(); ++i) {
-            frame[i] = (frame[i] - cmvn_mean_[i]) / std::sqrt(cmvn_var_[i]);
+            frame[i] = (frame[i] - cmvn_mean_[i]) * cmvn_inv_std_[i];
         }
     }
+}
+
+void AudioProcessor::applyCMVNInto(float* features, size_t num_frames) {
+    if (!cmvn_loaded_) {
+        return;
+    }
+    
+    const size_t dim = getFeatureDim();
+    const size_t cmvn_dim = std::min(cmvn_mean_.size(), dim);
+    
+    for (size_t t = 0; t < num_frames; ++t) {
+        float* frame = features + t * dim;
+        for (size_t i = 0; i < cmvn_dim; ++i) {
+            frame[i] = (frame[i] - cmvn_mean_[i]) * cmvn_inv_std_[i];
+        }
+    }
+}
+
+size_t AudioProcessor::getNumFbankFrames(size_t num_samples) const {
+    if (num_samples < static_cast<size_t>(config_.frame_length)) {
+        return 0;
+    }
+    return (num_samples - config_.frame_length) / config_.frame_shift + 1;
+}
+
+size_t AudioProcessor::getNumLFRFrames(size_t num_samples) const {
+    size_t fbank_frames = getNumFbankFrames(num_samples);
+    return (fbank_frames + config_.lfr_n - 1) / config_.lfr_n;
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "audio_recorder.hpp"
 #include "vad_detector.hpp"
+#include "resampler.hpp"
+#include "metrics.hpp"
 #include <iostream>
 #include <chrono>
 #include <algorithm>
@@ -8,12 +10,14 @@
 
 AudioRecorder::AudioRecorder()
     : config_(Config{}), stream_(nullptr), is_recording_(false), 
-      speech_detected_(false), should_stop_(false), vad_detector_(nullptr) {
+      speech_detected_(false), should_stop_(false), processing_running_(false),
+      overflow_samples_(0), last_callback_ns_(0), continuous_(false), vad_detector_(nullptr) {
 }
 
 AudioRecorder::AudioRecorder(const Config& config)
     : config_(config), stream_(nullptr), is_recording_(false), 
-      speech_detected_(false), should_stop_(false), vad_detector_(nullptr) {
+      speech_detected_(false), should_stop_(false), processing_running_(false),
+      overflow_samples_(0), last_callback_ns_(0), continuous_(false), vad_detector_(nullptr) {
 }
 
 AudioRecorder::~AudioRecorder() {
@@ -74,6 +78,18 @@ bool AudioRecorder::initialize() {
         std::cerr << "Failed to open stream: " << Pa_GetErrorText(err) << std::endl;
         return false;
     }
+    
+    // All capture-path memory is sized here; nothing allocates while the stream runs
+    const size_t buffer_samples = static_cast<size_t>(config_.frames_per_buffer) * config_.channels;
+    capture_ring_.resize(static_cast<size_t>(config_.ring_buffer_seconds * config_.sample_rate * config_.channels));
+    frame_buffer_.resize(buffer_samples);
+    pre_speech_buffer_.resize(buffer_samples * std::max(0, config_.pre_speech_frames));
+    
+    // Silero VAD runs at 16kHz; other capture rates go through a streaming resampler
+    if (config_.sample_rate != 16000) {
+        vad_resampler_ = std::make_unique<Resampler>(config_.sample_rate, 16000);
+        resampled_chunk_.reserve(buffer_samples);
+    }
 
     return true;
 }
@@ -82,6 +98,9 @@ void AudioRecorder::cleanup() {
     if (is_recording_.load()) {
         stopRecording();
     }
+    if (continuous_.load()) {
+        stopContinuous();
+    }
 
     if (stream_) {
         Pa_CloseStream(stream_);
@@ -99,47 +118,91 @@ int AudioRecorder::audioCallback(const void* input_buffer, void* output_buffer,
     AudioRecorder* recorder = static_cast<AudioRecorder*>(user_data);
     const float* input = static_cast<const float*>(input_buffer);
     
+    // Realtime context: copy into the lock-free ring, nothing else. Waking a condition variable
+    // can enter the kernel, so the processing thread polls the ring instead.
     if (input) {
-        recorder->processAudioFrame(input, frames_per_buffer);
+        size_t count = frames_per_buffer * recorder->config_.channels;
+        size_t written = recorder->capture_ring_.write(input, count);
+        if (written < count) {
+            recorder->overflow_samples_.fetch_add(count - written, std::memory_order_relaxed);
+        }
+        recorder->last_callback_ns_.store(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count(),
+            std::memory_order_relaxed);
     }
     
     return recorder->should_stop_.load() ? paComplete : paContinue;
 }
 
+void AudioRecorder::startProcessing() {
+    capture_ring_.reset();
+    processing_running_.store(true);
+    processing_thread_ = std::thread(&AudioRecorder::processingThread, this);
+}
+
+void AudioRecorder::stopProcessing() {
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        processing_running_.store(false);
+    }
+    data_cv_.notify_all();
+    if (processing_thread_.joinable()) {
+        processing_thread_.join();
+    }
+}
+
+void AudioRecorder::processingThread() {
+    const size_t buffer_samples = frame_buffer_.size();
+    // The callback never notifies, so the ring is checked once per buffer period; only
+    // stopProcessing() signals the condition variable
+    const auto max_wait = std::chrono::milliseconds(
+        std::max(1, 1000 * config_.frames_per_buffer / std::max(1, config_.sample_rate)));
+    
+    while (processing_running_.load()) {
+        if (capture_ring_.available() < buffer_samples) {
+            std::unique_lock<std::mutex> lock(data_mutex_);
+            data_cv_.wait_for(lock, max_wait, [this, buffer_samples] {
+                return !processing_running_.load() || capture_ring_.available() >= buffer_samples;
+            });
+            continue;
+        }
+        
+        capture_ring_.read(frame_buffer_.data(), buffer_samples);
+        
+        // Once the endpoint is reached further audio belongs to no utterance
+        if (!should_stop_.load()) {
+            processAudioFrame(frame_buffer_.data(), config_.frames_per_buffer);
+        }
+    }
+}
+
 void AudioRecorder::processAudioFrame(const float* input, unsigned long frame_count) {
     std::lock_guard<std::mutex> lock(buffer_mutex_);
     
-    // Convert to vector for easier processing
-    std::vector<float> frame(input, input + frame_count * config_.channels);
-    
-    // Add to pre-speech buffer (circular buffer)
-    if (pre_speech_buffer_.size() > config_.frames_per_buffer * 10) {
-        pre_speech_buffer_.erase(pre_speech_buffer_.begin(), 
-                                pre_speech_buffer_.begin() + config_.frames_per_buffer);
-    }
-    pre_speech_buffer_.insert(pre_speech_buffer_.end(), frame.begin(), frame.end());
+    const size_t frame_size = frame_count * config_.channels;
     
     // Choose VAD method based on configuration
     bool is_speech = false;
     
     if (useEnergyVAD()) {
         // Energy-based VAD
-        float energy_prob = computeEnergyVAD(frame.data(), frame.size());
+        float energy_prob = computeEnergyVAD(input, frame_size);
         is_speech = energy_prob > config_.trigger_threshold;
     } else if (useSileroVAD() && vad_detector_) {
         // Silero VAD
-        float silero_prob = computeSileroVAD(frame);
+        float silero_prob = computeSileroVAD(frame_buffer_);
         is_speech = silero_prob > config_.trigger_threshold;
         
     } else {
         // Fallback to energy VAD if Silero not available
-        float energy_prob = computeEnergyVAD(frame.data(), frame.size());
+        float energy_prob = computeEnergyVAD(input, frame_size);
         is_speech = energy_prob > config_.trigger_threshold;
     }
     
     // Call external VAD callback if available
     if (vad_callback_) {
-        vad_callback_(frame);
+        vad_callback_(frame_buffer_);
     }
     
     auto now = std::chrono::steady_clock::now();
@@ -148,15 +211,27 @@ void AudioRecorder::processAudioFrame(const float* input, unsigned long frame_co
         last_speech_time_ = now;
         if (!speech_detected_.load()) {
             speech_detected_.store(true);
+            if (continuous_.load()) {
+                recording_start_time_ = now;
+            }
             std::cout << "▶ Speech detected, starting recording..." << std::endl;
-            // Add pre-speech buffer to main buffer
-            audio_buffer_.insert(audio_buffer_.end(), 
-                               pre_speech_buffer_.begin(), pre_speech_buffer_.end());
+            // Add pre-speech history (the frames before this one) to main buffer
+            size_t offset = audio_buffer_.size();
+            audio_buffer_.resize(offset + pre_speech_buffer_.size());
+            pre_speech_buffer_.copyTo(audio_buffer_.data() + offset);
+            if (speech_callback_ && pre_speech_buffer_.size() > 0) {
+                speech_callback_(audio_buffer_.data() + offset, pre_speech_buffer_.size());
+            }
         }
     }
     
-    if (speech_detected_.load()) {
-        audio_buffer_.insert(audio_buffer_.end(), frame.begin(), frame.end());
+    if (!speech_detected_.load()) {
+        pre_speech_buffer_.push(input, frame_size);
+    } else {
+        audio_buffer_.insert(audio_buffer_.end(), input, input + frame_size);
+        if (speech_callback_) {
+            speech_callback_(input, frame_size);
+        }
         
         // Check stopping conditions
         auto silence_duration = std::chrono::duration<double>(now - last_speech_time_).count();
@@ -164,26 +239,57 @@ void AudioRecorder::processAudioFrame(const float* input, unsigned long frame_co
         
         if (silence_duration > config_.silence_duration) {
             std::cout << "⏹ Silence detected, stopping recording" << std::endl;
-            should_stop_.store(true);
+            finishSegment();
         } else if (total_duration > config_.max_record_time) {
             std::cout << "⏹ Max recording time reached, stopping recording" << std::endl;
-            should_stop_.store(true);
+            finishSegment();
         }
     }
 }
 
-std::vector<float> AudioRecorder::recordAudio() {
-    if (!stream_) {
-        std::cerr << "Stream not initialized" << std::endl;
-        return {};
+void AudioRecorder::finishSegment() {
+    // The endpointing buffer was delivered by the callback the ring backlog ago
+    {
+        auto last_callback = std::chrono::steady_clock::time_point(
+            std::chrono::nanoseconds(last_callback_ns_.load(std::memory_order_relaxed)));
+        double backlog = static_cast<double>(capture_ring_.available()) /
+                         (static_cast<double>(config_.sample_rate) * std::max(1, config_.channels));
+        double latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - last_callback).count() + backlog;
+        Metrics::instance().record(Metrics::Stage::Endpoint, latency);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(segment_mutex_);
+        if (!continuous_.load()) {
+            should_stop_.store(true);
+        } else {
+            if (segments_.size() >= std::max<size_t>(config_.max_queued_segments, 1)) {
+                std::cerr << "Warning: recognizer is behind, dropping oldest queued segment" << std::endl;
+                segments_.pop_front();
+            }
+            segments_.push_back(std::move(audio_buffer_));
+            
+            // Keep listening for the next utterance
+            audio_buffer_ = std::vector<float>();
+            audio_buffer_.reserve(static_cast<size_t>((config_.max_record_time + 1.0) * config_.sample_rate * config_.channels));
+            pre_speech_buffer_.clear();
+            speech_detected_.store(false);
+        }
     }
+    segment_cv_.notify_all();
+}
 
-    // Reset state
+void AudioRecorder::resetCaptureState() {
     audio_buffer_.clear();
+    audio_buffer_.reserve(static_cast<size_t>((config_.max_record_time + 1.0) * config_.sample_rate * config_.channels));
     pre_speech_buffer_.clear();
     vad_buffer_.clear(); // Clear VAD buffer for new recording
+    if (vad_resampler_) {
+        vad_resampler_->reset();
+    }
     speech_detected_.store(false);
     should_stop_.store(false);
+    overflow_samples_.store(0);
     recording_start_time_ = std::chrono::steady_clock::now();
     last_speech_time_ = recording_start_time_;
     
@@ -191,17 +297,100 @@ std::vector<float> AudioRecorder::recordAudio() {
     if (vad_detector_) {
         vad_detector_->reset();
     }
+}
+
+bool AudioRecorder::startContinuous() {
+    if (!stream_) {
+        std::cerr << "Stream not initialized" << std::endl;
+        return false;
+    }
+    if (continuous_.load() || is_recording_.load()) {
+        return false;
+    }
+    
+    resetCaptureState();
+    {
+        std::lock_guard<std::mutex> lock(segment_mutex_);
+        segments_.clear();
+        continuous_.store(true);
+    }
+    
+    startProcessing();
+    PaError err = Pa_StartStream(stream_);
+    if (err != paNoError) {
+        std::cerr << "Failed to start stream: " << Pa_GetErrorText(err) << std::endl;
+        stopProcessing();
+        continuous_.store(false);
+        return false;
+    }
+    return true;
+}
+
+void AudioRecorder::stopContinuous() {
+    if (!continuous_.load()) {
+        return;
+    }
+    
+    should_stop_.store(true);
+    PaError err = Pa_StopStream(stream_);
+    if (err != paNoError) {
+        std::cerr << "Failed to stop stream: " << Pa_GetErrorText(err) << std::endl;
+    }
+    stopProcessing();
+    
+    // Wake consumers; queued segments can still be drained
+    {
+        std::lock_guard<std::mutex> lock(segment_mutex_);
+        continuous_.store(false);
+    }
+    segment_cv_.notify_all();
+}
+
+bool AudioRecorder::waitForSegment(std::vector<float>& segment) {
+    std::unique_lock<std::mutex> lock(segment_mutex_);
+    segment_cv_.wait(lock, [this] { return !segments_.empty() || !continuous_.load(); });
+    if (segments_.empty()) {
+        return false;
+    }
+    segment = std::move(segments_.front());
+    segments_.pop_front();
+    return true;
+}
+
+size_t AudioRecorder::queuedSegments() {
+    std::lock_guard<std::mutex> lock(segment_mutex_);
+    return segments_.size();
+}
+
+std::vector<float> AudioRecorder::recordAudio() {
+    if (!stream_) {
+        std::cerr << "Stream not initialized" << std::endl;
+        return {};
+    }
+
+    if (continuous_.load()) {
+        std::cerr << "Recorder is in continuous mode" << std::endl;
+        return {};
+    }
+
+    // Reset state
+    resetCaptureState();
 
+    // Start the consumer before the producer
+    startProcessing();
+    
     // Start stream
     PaError err = Pa_StartStream(stream_);
     if (err != paNoError) {
         std::cerr << "Failed to start stream: " << Pa_GetErrorText(err) << std::endl;
+        stopProcessing();
         return {};
     }
 
-    // Wait for recording to complete
-    while (!should_stop_.load()) {
-        Pa_Sleep(100); // Sleep 100ms
+    // Wait for the endpoint; the processing thread notifies as soon as it is reached
+    {
+        std::unique_lock<std::mutex> lock(segment_mutex_);
+        segment_cv_.wait(lock, [this] { return should_stop_.load(); });
     }
 
     // Stop stream
@@ -209,6 +398,12 @@ std::vector<float> AudioRecorder::recordAudio() {
     if (err != paNoError) {
         std::cerr << "Failed to stop stream: " << Pa_GetErrorText(err) << std::endl;
     }
+    stopProcessing();
+    
+    size_t overflow = overflow_samples_.exchange(0);
+    if (overflow > 0) {
+        std::cerr << "Warning: dropped " << overflow << " samples, processing fell behind capture" << std::endl;
+    }
 
     std::lock_guard<std::mutex> lock(buffer_mutex_);
     return audio_buffer_;
@@ -228,7 +423,11 @@ void AudioRecorder::stopRecording() {
         return;
     }
 
-    should_stop_.store(true);
+    {
+        std::lock_guard<std::mutex> lock(segment_mutex_);
+        should_stop_.store(true);
+    }
+    segment_cv_.notify_all();
     is_recording_.store(false);
     
     if (recording_thread_.joinable()) {
@@ -284,45 +483,24 @@ float AudioRecorder::computeSileroVAD(const std::vector<float>& audio_chunk) {
     static const size_t VAD_WINDOW_SIZE = 512; // 32ms at 16kHz
     
     // Resample audio_chunk to 16kHz if needed
-    std::vector<float> resampled_chunk;
-    if (config_.sample_rate != 16000) {
-        // Simple decimation for 48kHz -> 16kHz (3:1 ratio)
-        if (config_.sample_rate == 48000) {
-            resampled_chunk.reserve(audio_chunk.size() / 3);
-            for (size_t i = 0; i < audio_chunk.size(); i += 3) {
-                resampled_chunk.push_back(audio_chunk[i]);
-            }
-        } else {
-            // For other sample rates, use simple linear interpolation
-            double ratio = static_cast<double>(config_.sample_rate) / 16000.0;
-            size_t new_size = static_cast<size_t>(audio_chunk.size() / ratio);
-            resampled_chunk.reserve(new_size);
-            for (size_t i = 0; i < new_size; ++i) {
-                size_t src_idx = static_cast<size_t>(i * ratio);
-                if (src_idx < audio_chunk.size()) {
-                    resampled_chunk.push_back(audio_chunk[src_idx]);
-                }
-            }
-        }
+    if (vad_resampler_) {
+        resampled_chunk_.clear();
+        vad_resampler_->process(audio_chunk.data(), audio_chunk.size(), resampled_chunk_);
+        vad_buffer_.insert(vad_buffer_.end(), resampled_chunk_.begin(), resampled_chunk_.end());
     } else {
-        resampled_chunk = audio_chunk;
+        vad_buffer_.insert(vad_buffer_.end(), audio_chunk.begin(), audio_chunk.end());
     }
     
-    // Add resampled chunk to buffer
-    vad_buffer_.insert(vad_buffer_.end(), resampled_chunk.begin(), resampled_chunk.end());
-    
     // Process when we have enough data
     if (vad_buffer_.size() >= VAD_WINDOW_SIZE) {
-        // Use the latest VAD_WINDOW_SIZE samples
-        std::vector<float> vad_input(vad_buffer_.end() - VAD_WINDOW_SIZE, vad_buffer_.end());
-        
         // Keep only recent data in buffer (sliding window)
         if (vad_buffer_.size() > VAD_WINDOW_SIZE * 2) {
             vad_buffer_.erase(vad_buffer_.begin(), vad_buffer_.end() - VAD_WINDOW_SIZE);
         }
         
-        // Use Silero VAD detector
-        float prob = vad_detector_->detectVAD(vad_input);
+        // Use Silero VAD detector on the latest VAD_WINDOW_SIZE samples
+        float prob = vad_detector_->detectVAD(vad_buffer_.data() + vad_buffer_.size() - VAD_WINDOW_SIZE,
+                                              VAD_WINDOW_SIZE);
         return prob;
     }
     
@@ -0,0 +1,235 @@
+#include "batch_scheduler.hpp"
+#include "asr_model.hpp"
+#include <iostream>
+#include <algorithm>
+
+BatchScheduler::BatchScheduler(ASRModel& model, const Config& config)
+    : model_(model), config_(config), running_(false) {
+    config_.max_batch_size = std::max(1, config_.max_batch_size);
+    config_.bucket_width_frames = std::max<size_t>(1, config_.bucket_width_frames);
+    config_.num_workers = std::max(1, config_.num_workers);
+}
+
+BatchScheduler::~BatchScheduler() {
+    stop();
+}
+
+bool BatchScheduler::start() {
+    if (running_.load()) {
+        return true;
+    }
+
+    running_.store(true);
+    for (int i = 0; i < config_.num_workers; ++i) {
+        worker_threads_.emplace_back(&BatchScheduler::workerLoop, this);
+    }
+    return true;
+}
+
+void BatchScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (!running_.load()) {
+            return;
+        }
+        running_.store(false);
+    }
+    queue_cv_.notify_all();
+
+    for (auto& thread : worker_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    worker_threads_.clear();
+}
+
+std::future<std::string> BatchScheduler::submit(std::vector<float> audio, const std::string& language) {
+    Request request;
+    request.audio = std::move(audio);
+    request.language = language;
+    auto future = request.promise.get_future();
+    enqueue(std::move(request));
+    return future;
+}
+
+void BatchScheduler::submit(std::vector<float> audio, ResultCallback callback, const std::string& language) {
+    Request request;
+    request.audio = std::move(audio);
+    request.language = language;
+    request.callback = std::move(callback);
+    enqueue(std::move(request));
+}
+
+size_t BatchScheduler::pendingRequests() {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return pending_;
+}
+
+void BatchScheduler::enqueue(Request request) {
+    request.frames = model_.getFeatureFrames(request.audio.size());
+    request.deadline = Clock::now() + std::chrono::milliseconds(config_.max_wait_ms);
+
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    if (!running_.load()) {
+        lock.unlock();
+        std::cerr << "Batch scheduler not running, dropping request" << std::endl;
+        complete(request, "");
+        return;
+    }
+    buckets_[request.frames / config_.bucket_width_frames].push_back(std::move(request));
+    pending_++;
+    lock.unlock();
+    queue_cv_.notify_one();
+}
+
+bool BatchScheduler::bucketReady(const std::deque<Request>& bucket, Clock::time_point now) const {
+    if (bucket.empty()) {
+        return false;
+    }
+
+    if (bucket.size() >= static_cast<size_t>(config_.max_batch_size) || bucket.front().deadline <= now) {
+        return true;
+    }
+
+    size_t max_frames = 0;
+    for (const auto& request : bucket) {
+        max_frames = std::max(max_frames, request.frames);
+    }
+    return bucket.size() * max_frames >= config_.max_padded_frames;
+}
+
+std::vector<BatchScheduler::Request> BatchScheduler::takeBatch(std::deque<Request>& bucket) {
+    std::vector<Request> batch;
+    size_t max_frames = 0;
+
+    while (!bucket.empty() && batch.size() < static_cast<size_t>(config_.max_batch_size)) {
+        size_t frames = std::max(max_frames, bucket.front().frames);
+        if (!batch.empty() && (batch.size() + 1) * frames > config_.max_padded_frames) {
+            break;
+        }
+        max_frames = frames;
+        batch.push_back(std::move(bucket.front()));
+        bucket.pop_front();
+    }
+
+    pending_ -= batch.size();
+    return batch;
+}
+
+void BatchScheduler::workerLoop() {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+
+    while (true) {
+        queue_cv_.wait(lock, [this] { return pending_ > 0 || !running_.load(); });
+        if (pending_ == 0) {
+            break;  // stopped and drained
+        }
+
+        // Pick the ready bucket whose oldest request is due first; on shutdown everything is ready
+        auto now = Clock::now();
+        bool draining = !running_.load();
+        auto ready = buckets_.end();
+        auto earliest_deadline = Clock::time_point::max();
+
+        for (auto it = buckets_.begin(); it != buckets_.end(); ++it) {
+            if (it->second.empty()) {
+                continue;
+            }
+            const auto& deadline = it->second.front().deadline;
+            earliest_deadline = std::min(earliest_deadline, deadline);
+            if ((draining || bucketReady(it->second, now)) &&
+                (ready == buckets_.end() || deadline < ready->second.front().deadline)) {
+                ready = it;
+            }
+        }
+
+        if (ready == buckets_.end()) {
+            queue_cv_.wait_until(lock, earliest_deadline);
+            continue;
+        }
+
+        auto batch = takeBatch(ready->second);
+        if (ready->second.empty()) {
+            buckets_.erase(ready);
+        }
+
+        // Requests left behind may already be ready for another worker
+        bool more = pending_ > 0;
+        lock.unlock();
+        if (more) {
+            queue_cv_.notify_one();
+        }
+        runBatch(batch);
+        lock.lock();
+    }
+}
+
+void BatchScheduler::runBatch(std::vector<Request>& batch) {
+    std::vector<std::vector<float>> audio_batch;
+    std::vector<std::string> languages;
+    audio_batch.reserve(batch.size());
+    languages.reserve(batch.size());
+
+    bool has_language = false;
+    for (auto& request : batch) {
+        audio_batch.push_back(std::move(request.audio));
+        languages.push_back(request.language);
+        has_language = has_language || !request.language.empty();
+    }
+
+    std::vector<std::string> results;
+    try {
+        if (has_language) {
+            // recognizeBatch looks languages up by name, so fill in the default for the rest
+            for (auto& language : languages) {
+                if (language.empty()) {
+                    language = model_.getLanguage();
+                }
+            }
+            results = model_.recognizeBatch(audio_batch, languages);
+        } else {
+            results = model_.recognizeBatch(audio_batch);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Batch recognition failed: " << e.what() << std::endl;
+        std::exception_ptr error = std::current_exception();
+        for (auto& request : batch) {
+            fail(request, error);
+        }
+        return;
+    } catch (...) {
+        std::cerr << "Batch recognition failed" << std::endl;
+        std::exception_ptr error = std::current_exception();
+        for (auto& request : batch) {
+            fail(request, error);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        complete(batch[i], i < results.size() ? results[i] : "");
+    }
+}
+
+void BatchScheduler::complete(Request& request, const std::string& text) {
+    if (!request.callback) {
+        request.promise.set_value(text);
+        return;
+    }
+    try {
+        request.callback(text);
+    } catch (const std::exception& e) {
+        std::cerr << "Batch scheduler result callback failed: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "Batch scheduler result callback failed" << std::endl;
+    }
+}
+
+void BatchScheduler::fail(Request& request, std::exception_ptr error) {
+    if (request.callback) {
+        complete(request, "");
+    } else {
+        request.promise.set_exception(error);
+    }
+}
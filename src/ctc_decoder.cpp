@@ -0,0 +1,507 @@
+#include "ctc_decoder.hpp"
+#include "simd_utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+
+namespace {
+
+constexpr float kNegInf = -std::numeric_limits<float>::infinity();
+
+// log(exp(a) + exp(b))
+inline float logAdd(float a, float b) {
+    if (a == kNegInf) return b;
+    if (b == kNegInf) return a;
+    return std::max(a, b) + std::log1p(std::exp(-std::fabs(a - b)));
+}
+
+// log(sum(exp(frame[v])))
+float logSumExp(const float* frame, int vocab_size) {
+    float max_logit;
+    simd::argmax(frame, vocab_size, &max_logit);
+    float sum = 0.0f;
+    for (int v = 0; v < vocab_size; ++v) {
+        sum += std::exp(frame[v] - max_logit);
+    }
+    return max_logit + std::log(sum);
+}
+
+}  // namespace
+
+// Per-thread search memory, reused across decode() calls so steady-state decoding does not
+// allocate. Prefixes live in an arena as a tree (parent links plus sibling-linked children),
+// so two hypotheses with the same prefix are the same node and merge by index.
+struct CTCDecoder::BeamScratch {
+    struct Prefix {
+        int parent;
+        int token;
+        int frame;          // frame the token was first emitted on
+        int first_child;
+        int next_sibling;
+        int hot_state;      // hotword trie node reached by this prefix
+        float bonus;        // hotword score of completed and in-progress matches
+        float partial;      // the in-progress match's share of bonus, withdrawn on mismatch
+    };
+    struct Hyp {
+        int prefix;
+        float p_blank;      // log prob of the prefix ending in blank
+        float p_token;      // log prob of the prefix ending in its last token
+        float score;
+    };
+
+    std::vector<Prefix> prefixes;
+    std::vector<Hyp> beam;
+    std::vector<Hyp> candidates;
+    std::vector<int> candidate_of;  // prefix -> index in candidates this frame, or -1
+    std::vector<int> top_ids;
+    std::vector<float> top_logits;
+
+    void reset() {
+        prefixes.clear();
+        prefixes.push_back({-1, -1, -1, -1, -1, 0, 0.0f, 0.0f});
+        candidate_of.assign(1, -1);
+        beam.clear();
+        beam.push_back({0, 0.0f, kNegInf, 0.0f});
+    }
+
+    int candidate(int prefix) {
+        if (candidate_of[prefix] < 0) {
+            candidate_of[prefix] = static_cast<int>(candidates.size());
+            candidates.push_back({prefix, kNegInf, kNegInf, 0.0f});
+        }
+        return candidate_of[prefix];
+    }
+};
+
+// Worker threads for the split argmax, started once. Concurrent decode() calls share them:
+// each queues its ranges, runs the first itself and then helps with queued ranges (its own
+// or another call's) until its last one is done, so no call waits on an idle pool.
+class CTCDecoder::ArgmaxPool {
+public:
+    explicit ArgmaxPool(int num_threads) {
+        for (int i = 0; i < num_threads; ++i) {
+            threads_.emplace_back(&ArgmaxPool::workerLoop, this);
+        }
+    }
+
+    ~ArgmaxPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        work_cv_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    // Runs task(0) .. task(count - 1) and returns once all have finished
+    void run(int count, const std::function<void(int)>& task) {
+        int remaining = count - 1;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (int i = 1; i < count; ++i) {
+                queue_.push_back({&task, i, &remaining});
+            }
+        }
+        work_cv_.notify_all();
+        task(0);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (remaining > 0) {
+            if (queue_.empty()) {
+                done_cv_.wait(lock);
+                continue;
+            }
+            execute(lock);
+        }
+    }
+
+private:
+    struct Job {
+        const std::function<void(int)>* task;
+        int index;
+        int* remaining;  // guarded by mutex_
+    };
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    std::deque<Job> queue_;
+    bool stop_ = false;
+
+    // Pops and runs the front job; lock is held on entry and exit
+    void execute(std::unique_lock<std::mutex>& lock) {
+        Job job = queue_.front();
+        queue_.pop_front();
+        lock.unlock();
+        (*job.task)(job.index);
+        lock.lock();
+        if (--*job.remaining == 0) {
+            done_cv_.notify_all();
+        }
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            work_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;  // stopped
+            }
+            execute(lock);
+        }
+    }
+};
+
+CTCDecoder::CTCDecoder(const Config& config) : config_(config) {
+    hotword_trie_.emplace_back();
+    if (config_.num_threads > 1) {
+        argmax_pool_ = std::make_unique<ArgmaxPool>(config_.num_threads - 1);
+    }
+}
+
+CTCDecoder::~CTCDecoder() = default;
+
+void CTCDecoder::setVocabulary(const std::vector<std::string>& tokens) {
+    static const std::unordered_map<std::string, TokenKind> kTags = {
+        {"zh", TokenKind::Language}, {"en", TokenKind::Language}, {"yue", TokenKind::Language},
+        {"ja", TokenKind::Language}, {"ko", TokenKind::Language}, {"nospeech", TokenKind::Language},
+        {"HAPPY", TokenKind::Emotion}, {"SAD", TokenKind::Emotion}, {"ANGRY", TokenKind::Emotion},
+        {"NEUTRAL", TokenKind::Emotion}, {"FEARFUL", TokenKind::Emotion}, {"DISGUSTED", TokenKind::Emotion},
+        {"SURPRISED", TokenKind::Emotion}, {"EMO_UNKNOWN", TokenKind::Emotion},
+        {"Speech", TokenKind::Event}, {"BGM", TokenKind::Event}, {"Laughter", TokenKind::Event},
+        {"Applause", TokenKind::Event}, {"Cry", TokenKind::Event}, {"Sneeze", TokenKind::Event},
+        {"Breath", TokenKind::Event}, {"Cough", TokenKind::Event}, {"Sing", TokenKind::Event},
+        {"Speech_Noise", TokenKind::Event}, {"Event_UNK", TokenKind::Event},
+        {"withitn", TokenKind::TextNorm}, {"woitn", TokenKind::TextNorm},
+    };
+
+    kinds_.assign(tokens.size(), TokenKind::Text);
+    names_.assign(tokens.size(), std::string());
+    for (size_t id = 0; id < tokens.size(); ++id) {
+        const std::string& token = tokens[id];
+        if (token.size() < 4 || token.compare(0, 2, "<|") != 0 || token.compare(token.size() - 2, 2, "|>") != 0) {
+            continue;
+        }
+        std::string tag = token.substr(2, token.size() - 4);
+        auto it = kTags.find(tag);
+        kinds_[id] = it != kTags.end() ? it->second : TokenKind::Special;
+        names_[id] = std::move(tag);
+    }
+}
+
+void CTCDecoder::setHotwords(const std::vector<std::vector<int>>& hotwords) {
+    hotword_trie_.assign(1, HotwordNode());
+    num_hotwords_ = 0;
+    for (const auto& word : hotwords) {
+        if (word.empty()) {
+            continue;
+        }
+        int node = 0;
+        for (int token : word) {
+            int child = hotwordChild(node, token);
+            if (child < 0) {
+                child = static_cast<int>(hotword_trie_.size());
+                HotwordNode entry;
+                entry.token = token;
+                entry.next_sibling = hotword_trie_[node].first_child;
+                hotword_trie_.push_back(entry);
+                hotword_trie_[node].first_child = child;
+            }
+            node = child;
+        }
+        if (!hotword_trie_[node].terminal) {
+            hotword_trie_[node].terminal = true;
+            num_hotwords_++;
+        }
+    }
+    
+    // Breadth-first, so every failure target is complete before its dependants
+    std::deque<int> queue;
+    for (int child = hotword_trie_[0].first_child; child >= 0; child = hotword_trie_[child].next_sibling) {
+        hotword_trie_[child].depth = 1;
+        hotword_trie_[child].output_depth = hotword_trie_[child].terminal ? 1 : 0;
+        queue.push_back(child);
+    }
+    while (!queue.empty()) {
+        int node = queue.front();
+        queue.pop_front();
+        for (int child = hotword_trie_[node].first_child; child >= 0; child = hotword_trie_[child].next_sibling) {
+            HotwordNode& entry = hotword_trie_[child];
+            entry.depth = hotword_trie_[node].depth + 1;
+            entry.fail = hotwordNext(hotword_trie_[node].fail, entry.token);
+            entry.output_depth = entry.terminal ? entry.depth : hotword_trie_[entry.fail].output_depth;
+            queue.push_back(child);
+        }
+    }
+}
+
+int CTCDecoder::hotwordChild(int node, int token) const {
+    for (int child = hotword_trie_[node].first_child; child >= 0; child = hotword_trie_[child].next_sibling) {
+        if (hotword_trie_[child].token == token) {
+            return child;
+        }
+    }
+    return -1;
+}
+
+int CTCDecoder::hotwordNext(int node, int token) const {
+    for (;;) {
+        int child = hotwordChild(node, token);
+        if (child >= 0) {
+            return child;
+        }
+        if (node == 0) {
+            return 0;
+        }
+        node = hotword_trie_[node].fail;
+    }
+}
+
+void CTCDecoder::argmaxFrames(const float* logits, int begin, int end, int vocab_size, int* best) const {
+    for (int t = begin; t < end; ++t) {
+        best[t] = static_cast<int>(simd::argmax(logits + static_cast<size_t>(t) * vocab_size, vocab_size));
+    }
+}
+
+void CTCDecoder::greedySearch(const float* logits, int num_frames, int vocab_size, std::vector<Emission>& out) const {
+    // Frames are independent, so long inputs split the argmax into contiguous ranges
+    std::vector<int> best(num_frames);
+    const size_t min_frames = std::max<size_t>(config_.min_frames_per_thread, 1);
+    const int num_threads = static_cast<int>(std::min<size_t>(std::max(config_.num_threads, 1),
+                                                              static_cast<size_t>(num_frames) / min_frames));
+    if (num_threads > 1 && argmax_pool_) {
+        const int per_thread = (num_frames + num_threads - 1) / num_threads;
+        argmax_pool_->run(num_threads, [&](int i) {
+            int begin = i * per_thread;
+            argmaxFrames(logits, begin, std::min(num_frames, begin + per_thread), vocab_size, best.data());
+        });
+    } else {
+        argmaxFrames(logits, 0, num_frames, vocab_size, best.data());
+    }
+
+    // Collapse repeats and drop blanks; a repeat extends the token's span
+    int prev_token = -1;
+    for (int t = 0; t < num_frames; ++t) {
+        int token = best[t];
+        if (token != config_.blank_id) {
+            if (token != prev_token) {
+                out.push_back({token, t, t + 1});
+            } else {
+                out.back().end = t + 1;
+            }
+        }
+        prev_token = token;
+    }
+}
+
+void CTCDecoder::beamSearch(const float* logits, int num_frames, int vocab_size, std::vector<Emission>& out) const {
+    thread_local BeamScratch scratch;
+    scratch.reset();
+
+    const size_t beam_size = static_cast<size_t>(std::max(config_.beam_size, 1));
+    const size_t top_k = static_cast<size_t>(std::max(1, std::min(config_.top_k, vocab_size - 1)));
+    const float log_blank_skip = config_.blank_skip_probability > 0.0f && config_.blank_skip_probability < 1.0f
+                                     ? std::log(config_.blank_skip_probability) : 0.0f;
+    const bool biased = num_hotwords_ > 0;
+    const int blank = config_.blank_id;
+    scratch.top_ids.resize(top_k);
+    scratch.top_logits.resize(top_k);
+
+    auto extend = [&](int parent, int token, int frame) {
+        for (int c = scratch.prefixes[parent].first_child; c >= 0; c = scratch.prefixes[c].next_sibling) {
+            if (scratch.prefixes[c].token == token) {
+                return c;
+            }
+        }
+        BeamScratch::Prefix prefix = scratch.prefixes[parent];
+        prefix.parent = parent;
+        prefix.token = token;
+        prefix.frame = frame;
+        prefix.first_child = -1;
+        prefix.next_sibling = scratch.prefixes[parent].first_child;
+
+        // Hotword state: follow the trie and its failure links. Only the last depth tokens
+        // are still part of a match, so the bonus of uncredited tokens that fell off the
+        // front is withdrawn. Reaching a hotword (or one ending as a suffix) credits the
+        // newest uncredited tokens for good. Tags do not interrupt a match.
+        if (biased && kind(token) == TokenKind::Text) {
+            prefix.hot_state = hotwordNext(prefix.hot_state, token);
+            const HotwordNode& next = hotword_trie_[prefix.hot_state];
+            float partial = std::min(prefix.partial + config_.hotword_weight,
+                                     config_.hotword_weight * static_cast<float>(next.depth));
+            prefix.bonus += partial - prefix.partial;
+            prefix.partial = partial;
+            if (next.output_depth > 0) {
+                prefix.partial -= std::min(prefix.partial,
+                                           config_.hotword_weight * static_cast<float>(next.output_depth));
+            }
+        }
+
+        int index = static_cast<int>(scratch.prefixes.size());
+        scratch.prefixes[parent].first_child = index;
+        scratch.prefixes.push_back(prefix);
+        scratch.candidate_of.push_back(-1);
+        return index;
+    };
+
+    for (int t = 0; t < num_frames; ++t) {
+        const float* frame = logits + static_cast<size_t>(t) * vocab_size;
+        const float log_norm = logSumExp(frame, vocab_size);
+        const float lp_blank = frame[blank] - log_norm;
+
+        // Near-certain blank: no hypothesis would keep a token here, only fold into blank
+        if (log_blank_skip < 0.0f && lp_blank >= log_blank_skip) {
+            for (auto& hyp : scratch.beam) {
+                hyp.p_blank = logAdd(hyp.p_blank, hyp.p_token) + lp_blank;
+                hyp.p_token = kNegInf;
+            }
+            continue;
+        }
+
+        // Top-k non-blank tokens by logit, kept sorted in a small insertion array
+        size_t count = 0;
+        for (int v = 0; v < vocab_size; ++v) {
+            float x = frame[v];
+            if (v == blank || (count == top_k && x <= scratch.top_logits[top_k - 1])) {
+                continue;
+            }
+            size_t pos = count < top_k ? count++ : top_k - 1;
+            while (pos > 0 && scratch.top_logits[pos - 1] < x) {
+                scratch.top_logits[pos] = scratch.top_logits[pos - 1];
+                scratch.top_ids[pos] = scratch.top_ids[pos - 1];
+                pos--;
+            }
+            scratch.top_logits[pos] = x;
+            scratch.top_ids[pos] = v;
+        }
+
+        scratch.candidates.clear();
+        for (const auto& hyp : scratch.beam) {
+            const float total = logAdd(hyp.p_blank, hyp.p_token);
+            const int last = scratch.prefixes[hyp.prefix].token;
+
+            int same = scratch.candidate(hyp.prefix);
+            scratch.candidates[same].p_blank = logAdd(scratch.candidates[same].p_blank, total + lp_blank);
+
+            for (size_t i = 0; i < count; ++i) {
+                const int token = scratch.top_ids[i];
+                const float lp = scratch.top_logits[i] - log_norm;
+                int next = scratch.candidate(extend(hyp.prefix, token, t));
+                if (token == last) {
+                    // A repeat collapses unless separated by blank
+                    same = scratch.candidate_of[hyp.prefix];
+                    scratch.candidates[same].p_token = logAdd(scratch.candidates[same].p_token, hyp.p_token + lp);
+                    scratch.candidates[next].p_token = logAdd(scratch.candidates[next].p_token, hyp.p_blank + lp);
+                } else {
+                    scratch.candidates[next].p_token = logAdd(scratch.candidates[next].p_token, total + lp);
+                }
+            }
+        }
+
+        for (auto& hyp : scratch.candidates) {
+            hyp.score = logAdd(hyp.p_blank, hyp.p_token) + scratch.prefixes[hyp.prefix].bonus;
+            scratch.candidate_of[hyp.prefix] = -1;
+        }
+        size_t keep = std::min(beam_size, scratch.candidates.size());
+        std::partial_sort(scratch.candidates.begin(), scratch.candidates.begin() + keep, scratch.candidates.end(),
+                          [](const BeamScratch::Hyp& a, const BeamScratch::Hyp& b) { return a.score > b.score; });
+        scratch.beam.assign(scratch.candidates.begin(), scratch.candidates.begin() + keep);
+    }
+
+    // Best final hypothesis; unfinished hotword matches do not count
+    int best = 0;
+    float best_score = kNegInf;
+    for (const auto& hyp : scratch.beam) {
+        const auto& prefix = scratch.prefixes[hyp.prefix];
+        float score = logAdd(hyp.p_blank, hyp.p_token) + prefix.bonus - prefix.partial;
+        if (score > best_score) {
+            best_score = score;
+            best = hyp.prefix;
+        }
+    }
+
+    size_t first = out.size();
+    for (int node = best; node > 0; node = scratch.prefixes[node].parent) {
+        out.push_back({scratch.prefixes[node].token, scratch.prefixes[node].frame, scratch.prefixes[node].frame + 1});
+    }
+    std::reverse(out.begin() + first, out.end());
+}
+
+CTCDecoder::TokenSpan CTCDecoder::tokenSpan(const float* logits, int vocab_size, const Emission& emission,
+                                            int limit) const {
+    TokenSpan span;
+    span.start_frame = emission.frame;
+    span.end_frame = emission.end;
+    while (span.end_frame < limit) {
+        const float* frame = logits + static_cast<size_t>(span.end_frame) * vocab_size;
+        if (static_cast<int>(simd::argmax(frame, vocab_size)) != emission.token) {
+            break;
+        }
+        span.end_frame++;
+    }
+
+    float sum = 0.0f;
+    for (int t = span.start_frame; t < span.end_frame; ++t) {
+        const float* frame = logits + static_cast<size_t>(t) * vocab_size;
+        sum += std::exp(frame[emission.token] - logSumExp(frame, vocab_size));
+    }
+    span.confidence = sum / static_cast<float>(span.end_frame - span.start_frame);
+    return span;
+}
+
+CTCDecoder::Result CTCDecoder::decode(const float* logits, int num_frames, int vocab_size, int start_frame) const {
+    Result result;
+    if (num_frames <= 0 || vocab_size <= 0) {
+        return result;
+    }
+
+    std::vector<Emission> emissions;
+    const bool beam = config_.beam_size > 1 && vocab_size > 1;
+    if (beam) {
+        beamSearch(logits, num_frames, vocab_size, emissions);
+    } else {
+        greedySearch(logits, num_frames, vocab_size, emissions);
+    }
+
+    // Route special tokens to their fields (first one wins); text before start_frame is dropped
+    for (size_t i = 0; i < emissions.size(); ++i) {
+        const Emission& emission = emissions[i];
+        const int token = emission.token;
+        switch (kind(token)) {
+            case TokenKind::Text:
+                if (emission.frame >= start_frame) {
+                    result.tokens.push_back(token);
+                    if (config_.token_spans) {
+                        // Beam emissions only know their first frame; they may extend up to the next token
+                        int limit = !beam ? emission.end : i + 1 < emissions.size() ? emissions[i + 1].frame : num_frames;
+                        result.spans.push_back(tokenSpan(logits, vocab_size, emission, limit));
+                    }
+                }
+                break;
+            case TokenKind::Language:
+                if (result.language.empty()) result.language = names_[token];
+                break;
+            case TokenKind::Emotion:
+                if (result.emotion.empty()) result.emotion = names_[token];
+                break;
+            case TokenKind::Event:
+                if (result.event.empty()) result.event = names_[token];
+                break;
+            case TokenKind::TextNorm:
+                result.itn = names_[token] == "withitn";
+                break;
+            case TokenKind::Special:
+                break;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,58 @@
+#include "energy_gate.hpp"
+#include "simd_utils.hpp"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+EnergyGate::EnergyGate(const Config& config) : config_(config) {
+    reset();
+}
+
+void EnergyGate::reset() {
+    initialized_ = false;
+    floor_db_ = config_.min_floor_db;
+    level_db_ = config_.min_floor_db;
+    zcr_ = 0.0f;
+    hangover_ = 0;
+}
+
+bool EnergyGate::process(const float* samples, size_t length, bool speech_hint) {
+    if (length < 2) {
+        return true;
+    }
+
+    const float energy = simd::dotProduct(samples, samples, length);
+    const float lag1 = simd::dotProduct(samples, samples + 1, length - 1);
+    level_db_ = 10.0f * std::log10(energy / length + 1e-12f);
+    const float r1 = energy > 0.0f ? std::max(-1.0f, std::min(1.0f, lag1 / energy)) : 1.0f;
+    zcr_ = static_cast<float>(std::acos(r1) / M_PI);
+
+    if (!initialized_) {
+        floor_db_ = std::max(level_db_, config_.min_floor_db);
+        initialized_ = true;
+    }
+
+    const float margin = zcr_ >= config_.fricative_zcr ? config_.fricative_margin_db : config_.margin_db;
+    const bool loud = level_db_ > floor_db_ + margin;
+
+    // Track the floor from below; while the model hears speech it must not creep upwards
+    if (level_db_ < floor_db_) {
+        floor_db_ += config_.floor_fall * (level_db_ - floor_db_);
+    } else if (!speech_hint) {
+        floor_db_ += std::min(config_.floor_rise_db, level_db_ - floor_db_);
+    }
+    floor_db_ = std::max(floor_db_, config_.min_floor_db);
+
+    if (loud || speech_hint) {
+        hangover_ = config_.hangover_windows;
+        return true;
+    }
+    if (hangover_ > 0) {
+        --hangover_;
+        return true;
+    }
+    return false;
+}
@@ -7,11 +7,20 @@
 #include <iomanip>
 #include <vector>
 #include <algorithm>
+#include <functional>
 
 #include "audio_recorder.hpp"
 #include "vad_detector.hpp"
 #include "asr_model.hpp"
 #include "model_downloader.hpp"
+#include "batch_scheduler.hpp"
+#include "online_feature_extractor.hpp"
+#include "streaming_recognizer.hpp"
+#include "offline_transcriber.hpp"
+#include "resampler.hpp"
+#include "ort_runtime.hpp"
+#include "metrics.hpp"
+#include <fstream>
 
 class ASRDemo {
 public:
@@ -24,6 +33,26 @@ public:
         double trigger_threshold;
         double stop_threshold;
         std::string vad_type;
+        bool use_scheduler;
+        bool partial_results;
+        bool continuous;
+        std::string input_path;    // non-empty: transcribe files instead of the microphone
+        std::string output_path;   // empty: stdout
+        int num_threads;           // parallel sessions in file mode
+        int beam_size;             // CTC prefix beam search width; 1 = greedy
+        std::string hotwords_path; // one hotword per line, biases the beam search
+        bool startup_cache;        // reuse the binary vocabulary and optimized models
+        bool map_models;           // create sessions from mmapped model files
+        std::string providers;     // execution provider preference list, e.g. "cuda,cpu"
+        std::string precision;     // ASR model variant: auto, int8, fp32 or fp16
+        bool warmup;               // run the ASR sessions over representative lengths at startup
+        std::vector<size_t> shape_buckets;  // LFR frame counts inputs are padded up to
+        size_t arena_max_mb;       // cap on the shared ORT arena; 0 = unbounded
+        OrtRuntime::ArenaExtend arena_extend;
+        bool print_performance;    // per-utterance stage breakdown on stdout
+        bool timestamps;           // per-token times and confidence in file-mode output
+        size_t result_cache;       // recognition results kept for repeated clips; 0 = off
+        std::string metrics_path;  // Prometheus text written here on exit
         
         RecorderParams() :
             sample_rate(16000),
@@ -33,10 +62,27 @@ public:
             max_record_time(5.0),
             trigger_threshold(0.6),
             stop_threshold(0.35),
-            vad_type("energy") {}
+            vad_type("energy"),
+            use_scheduler(false),
+            partial_results(false),
+            continuous(false),
+            num_threads(2),
+            beam_size(1),
+            startup_cache(true),
+            map_models(false),
+            providers("auto"),
+            precision("auto"),
+            warmup(true),
+            arena_max_mb(0),
+            arena_extend(OrtRuntime::ArenaExtend::PowerOfTwo),
+            print_performance(false),
+            timestamps(false),
+            result_cache(0) {}
     };
 
-    ASRDemo(const RecorderParams& params = RecorderParams()) : recorder_params_(params) {}
+    // File-mode transcripts without --output go to transcripts; everything else to std::cout
+    ASRDemo(const RecorderParams& params = RecorderParams(), std::ostream& transcripts = std::cout)
+        : recorder_params_(params), transcripts_(transcripts) {}
     ~ASRDemo() = default;
 
     bool initialize() {
@@ -49,34 +95,75 @@ public:
             return false;
         }
         
-        // Initialize VAD detector if using Silero VAD
-        if (recorder_params_.vad_type == "silero") {
+        // Optimized graphs and the binary vocabulary are derived once and reused by later launches
+        if (recorder_params_.startup_cache) {
+            OrtRuntime::setModelCacheDir(downloader.getStartupCacheDir());
+        }
+        OrtRuntime::setModelMapping(recorder_params_.map_models);
+        
+        // The arena is process-wide, so the runtime is created with it before the VAD opens a session
+        OrtRuntime::Config runtime_config;
+        runtime_config.arena_extend = recorder_params_.arena_extend;
+        runtime_config.arena_max_bytes = recorder_params_.arena_max_mb << 20;
+        OrtRuntime::instance(runtime_config);
+        
+        // Initialize VAD detector if using Silero VAD, alone or behind the energy gate
+        if (recorder_params_.vad_type == "silero" || recorder_params_.vad_type == "cascade") {
             VADDetector::Config vad_config;
             vad_config.model_path = downloader.getModelPath(ModelDownloader::VAD_MODEL_NAME);
             vad_config.sample_rate = 16000;
             vad_config.window_size = 512;  // Silero VAD expects 512 samples (32ms at 16kHz)
             vad_config.context_size = 64;   // Additional context for model
+            vad_config.pre_gate = recorder_params_.vad_type == "cascade";
+            vad_config.gate_speech_threshold = static_cast<float>(recorder_params_.stop_threshold);
             
             vad_detector_ = std::make_unique<VADDetector>(vad_config);
             if (!vad_detector_->initialize()) {
                 std::cerr << "Failed to initialize Silero VAD detector" << std::endl;
                 return false;
             }
-            std::cout << "Using Silero VAD for voice activity detection" << std::endl;
+            std::cout << (vad_config.pre_gate ? "Using energy-gated Silero VAD for voice activity detection"
+                                              : "Using Silero VAD for voice activity detection") << std::endl;
         } else {
             std::cout << "Using energy-based VAD for voice activity detection" << std::endl;
         }
         
         // Initialize ASR model
         ASRModel::Config asr_config;
-        asr_config.model_path = downloader.getModelPath(ModelDownloader::ASR_MODEL_QUANT_NAME);
+        asr_config.execution_providers = OrtRuntime::parseProviders(recorder_params_.providers);
+        std::string precision;
+        asr_config.model_path = downloader.getAsrModelPath(
+            recorder_params_.precision,
+            OrtRuntime::isGpuProvider(OrtRuntime::firstAvailableProvider(asr_config.execution_providers)),
+            &precision);
         asr_config.config_path = downloader.getModelPath(ModelDownloader::CONFIG_NAME);
         asr_config.vocab_path = downloader.getModelPath(ModelDownloader::VOCAB_NAME);
         asr_config.decoder_path = downloader.getModelPath(ModelDownloader::DECODER_NAME);
+        if (recorder_params_.startup_cache) {
+            asr_config.cache_dir = downloader.getStartupCacheDir();
+        }
         asr_config.sample_rate = 16000;
         asr_config.language = "zh";
         asr_config.use_itn = true;
-        asr_config.quantized = true;
+        asr_config.quantized = precision == "int8";
+        asr_config.half_precision = precision == "fp16";
+        if (offline()) {
+            asr_config.num_sessions = std::max(1, recorder_params_.num_threads);
+        }
+        asr_config.beam_size = recorder_params_.beam_size;
+        asr_config.print_performance = recorder_params_.print_performance;
+        asr_config.token_timestamps = recorder_params_.timestamps;
+        asr_config.result_cache_entries = recorder_params_.result_cache;
+        asr_config.warmup = recorder_params_.warmup;
+        asr_config.shape_buckets = recorder_params_.shape_buckets;
+        asr_config.arena_extend = runtime_config.arena_extend;
+        asr_config.arena_max_bytes = runtime_config.arena_max_bytes;
+        if (!recorder_params_.hotwords_path.empty()) {
+            asr_config.hotwords = loadHotwords(recorder_params_.hotwords_path);
+            if (asr_config.beam_size <= 1) {
+                asr_config.beam_size = 4;  // biasing only works through the beam search
+            }
+        }
         
         asr_model_ = std::make_unique<ASRModel>(asr_config);
         if (!asr_model_->initialize()) {
@@ -84,6 +171,29 @@ public:
             return false;
         }
         
+        // File mode needs neither the recorder nor the incremental paths
+        if (offline()) {
+            OfflineTranscriber::Config offline_config;
+            offline_config.vad_model_path = downloader.getModelPath(ModelDownloader::VAD_MODEL_NAME);
+            offline_config.trigger_threshold = recorder_params_.trigger_threshold;
+            offline_config.stop_threshold = recorder_params_.stop_threshold;
+            offline_config.num_threads = recorder_params_.num_threads;
+            offline_transcriber_ = std::make_unique<OfflineTranscriber>(*asr_model_, offline_config);
+            if (!offline_transcriber_->initialize()) {
+                return false;
+            }
+            std::cout << "ASR Demo initialized successfully!" << std::endl;
+            return true;
+        }
+        
+        // Route recognition through the length-bucketing batch scheduler if requested
+        if (recorder_params_.use_scheduler) {
+            BatchScheduler::Config scheduler_config;
+            scheduler_ = std::make_unique<BatchScheduler>(*asr_model_, scheduler_config);
+            scheduler_->start();
+            std::cout << "Using batch scheduler for recognition" << std::endl;
+        }
+        
         // Initialize audio recorder
         AudioRecorder::Config recorder_config;
         recorder_config.sample_rate = recorder_params_.sample_rate;
@@ -102,8 +212,47 @@ public:
             return false;
         }
         
+        // Incremental paths consume 16kHz speech; other capture rates are resampled on the way in
+        if (recorder_params_.sample_rate != 16000) {
+            capture_resampler_ = std::make_unique<Resampler>(recorder_params_.sample_rate, 16000);
+        }
+        
+        // Partial results: re-decode the growing utterance while the user is still speaking
+        // Both incremental paths follow one utterance at a time, so continuous mode skips them
+        const bool incremental = !scheduler_ && !recorder_params_.continuous;
+        if (recorder_params_.partial_results && incremental) {
+            StreamingRecognizer::Config streaming_config;
+            auto recognizer = std::make_unique<StreamingRecognizer>(*asr_model_, streaming_config);
+            if (recognizer->initialize()) {
+                recognizer->setResultCallback([](const std::string& text, bool is_final) {
+                    if (!is_final) {
+                        std::cout << "Partial result: " << text << std::endl;
+                    }
+                });
+                StreamingRecognizer* target = recognizer.get();
+                setSpeechSink([target](const float* samples, size_t length) {
+                    target->acceptWaveform(samples, length);
+                });
+                streaming_recognizer_ = std::move(recognizer);
+                std::cout << "Partial results enabled" << std::endl;
+            }
+        }
+        
+        // Compute features while recording: the streaming front-end consumes speech as it is
+        // captured, so only inference remains after the endpoint
+        if (incremental && !streaming_recognizer_) {
+            streaming_frontend_ = asr_model_->createStreamingFrontend();
+            if (streaming_frontend_) {
+                OnlineFeatureExtractor* frontend = streaming_frontend_.get();
+                setSpeechSink([frontend](const float* samples, size_t length) {
+                    frontend->acceptWaveform(samples, length);
+                });
+                std::cout << "Streaming feature extraction enabled" << std::endl;
+            }
+        }
+        
         // Set up VAD callback if using Silero VAD
-        if (recorder_params_.vad_type == "silero" && vad_detector_) {
+        if (vad_detector_) {
             audio_recorder_->setVADDetector(vad_detector_.get());
         }
         
@@ -112,6 +261,15 @@ public:
     }
     
     void run() {
+        if (offline()) {
+            runOffline();
+            return;
+        }
+        if (recorder_params_.continuous) {
+            runContinuous();
+            return;
+        }
+        
         std::cout << "\n=== ASR Demo Started ===" << std::endl;
         std::cout << "Press Enter to start recording, or 'q' to quit" << std::endl;
         
@@ -131,12 +289,138 @@ public:
     }
 
 private:
+    static std::vector<std::string> loadHotwords(const std::string& path) {
+        std::vector<std::string> hotwords;
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            std::cerr << "Cannot open hotwords file: " << path << std::endl;
+            return hotwords;
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            line.erase(0, line.find_first_not_of(" \t\r"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (!line.empty() && line[0] != '#') {
+                hotwords.push_back(line);
+            }
+        }
+        return hotwords;
+    }
+    
+    using SpeechSink = std::function<void(const float*, size_t)>;
+    
+    // Routes captured speech to an incremental consumer, at 16kHz
+    void setSpeechSink(SpeechSink sink) {
+        speech_sink_ = std::move(sink);
+        audio_recorder_->setSpeechCallback([this](const float* samples, size_t length) {
+            if (!capture_resampler_) {
+                speech_sink_(samples, length);
+                return;
+            }
+            sink_buffer_.clear();
+            capture_resampler_->process(samples, length, sink_buffer_);
+            speech_sink_(sink_buffer_.data(), sink_buffer_.size());
+        });
+    }
+    
+    // Hands the resampler's held-back tail to the sink once the recording has stopped
+    void flushSpeechSink() {
+        if (capture_resampler_ && speech_sink_) {
+            sink_buffer_.clear();
+            capture_resampler_->flush(sink_buffer_);
+            speech_sink_(sink_buffer_.data(), sink_buffer_.size());
+        }
+    }
+    
+    static std::string describeTags(const ASRModel::Result& result) {
+        std::string tags;
+        auto append = [&tags](const char* name, const std::string& value) {
+            if (!value.empty()) {
+                tags += (tags.empty() ? "" : ", ") + std::string(name) + "=" + value;
+            }
+        };
+        append("language", result.language);
+        append("emotion", result.emotion);
+        append("event", result.event);
+        return tags;
+    }
+    
+    bool offline() const { return !recorder_params_.input_path.empty(); }
+    
+    // File mode: one audio file or a list of them, timestamped segments to stdout or --output
+    void runOffline() {
+        std::vector<std::string> inputs = OfflineTranscriber::expandInputs(recorder_params_.input_path);
+        
+        std::ofstream file;
+        if (!recorder_params_.output_path.empty()) {
+            file.open(recorder_params_.output_path);
+            if (!file.is_open()) {
+                std::cerr << "Cannot open output file: " << recorder_params_.output_path << std::endl;
+                return;
+            }
+        }
+        std::ostream& out = file.is_open() ? static_cast<std::ostream&>(file) : transcripts_;
+        
+        size_t failed = 0;
+        for (const auto& path : inputs) {
+            std::vector<OfflineTranscriber::Segment> segments;
+            if (!offline_transcriber_->transcribeFile(path, segments)) {
+                failed++;
+                continue;
+            }
+            OfflineTranscriber::writeSegments(out, path, segments);
+        }
+        
+        std::cerr << "Transcribed " << inputs.size() - failed << "/" << inputs.size() << " files" << std::endl;
+    }
+    
+    // Always listening: capture keeps segmenting speech while a worker recognizes queued segments
+    void runContinuous() {
+        std::cout << "\n=== ASR Demo Started (continuous listening) ===" << std::endl;
+        std::cout << "Speak at any time; type 'q' and press Enter to quit" << std::endl;
+        
+        if (!audio_recorder_->startContinuous()) {
+            std::cerr << "Failed to start continuous capture" << std::endl;
+            return;
+        }
+        
+        std::thread recognition_thread([this] {
+            std::vector<float> segment;
+            while (audio_recorder_->waitForSegment(segment)) {
+                recognizeAudio(segment);
+            }
+        });
+        
+        std::string input;
+        while (std::getline(std::cin, input)) {
+            if (input == "q" || input == "quit" || input == "exit") {
+                break;
+            }
+        }
+        
+        // Segments already queued are still recognized before the worker exits
+        audio_recorder_->stopContinuous();
+        recognition_thread.join();
+        
+        std::cout << "Demo finished." << std::endl;
+    }
+    
     void recordAndRecognize() {
         std::cout << "\nStarting recording..." << std::endl;
         std::cout << "Speak now! (max " << recorder_params_.max_record_time 
                   << " seconds, or silence for " << recorder_params_.silence_duration 
                   << " second to stop)" << std::endl;
         
+        if (streaming_frontend_) {
+            streaming_frontend_->reset();
+        }
+        if (streaming_recognizer_) {
+            streaming_recognizer_->reset();
+        }
+        if (capture_resampler_) {
+            capture_resampler_->reset();
+        }
+        
         // Record audio
         auto start_time = std::chrono::high_resolution_clock::now();
         std::vector<float> audio = audio_recorder_->recordAudio();
@@ -151,12 +435,16 @@ private:
         std::cout << "Recording completed (" << recording_duration << "s, " 
                   << audio.size() << " samples at " << recorder_params_.sample_rate << "Hz)" << std::endl;
         
+        recognizeAudio(audio);
+    }
+    
+    void recognizeAudio(const std::vector<float>& audio) {
         // Resample if necessary
         std::vector<float> resampled_audio;
         if (recorder_params_.sample_rate != 16000) {
             std::cout << "Resampling from " << recorder_params_.sample_rate << "Hz to 16000Hz..." << std::endl;
             auto resample_start = std::chrono::high_resolution_clock::now();
-            resampled_audio = resampleAudio(audio, recorder_params_.sample_rate, 16000);
+            resampled_audio = Resampler::resample(audio, recorder_params_.sample_rate, 16000);
             auto resample_end = std::chrono::high_resolution_clock::now();
             auto resample_time = std::chrono::duration<double>(resample_end - resample_start).count();
             std::cout << "Resampled to " << resampled_audio.size() << " samples in " 
@@ -168,9 +456,32 @@ private:
         // Recognize speech
         std::cout << "Processing audio..." << std::endl;
         
-        start_time = std::chrono::high_resolution_clock::now();
-        std::string result = asr_model_->recognize(resampled_audio);
-        end_time = std::chrono::high_resolution_clock::now();
+        auto start_time = std::chrono::high_resolution_clock::now();
+        std::string result;
+        std::string tags;
+        if (scheduler_) {
+            try {
+                result = scheduler_->submit(resampled_audio).get();
+            } catch (const std::exception& e) {
+                std::cerr << "ASR inference error: " << e.what() << std::endl;
+            }
+        } else if (streaming_recognizer_) {
+            flushSpeechSink();
+            result = streaming_recognizer_->finish();
+        } else if (streaming_frontend_) {
+            // Stream is stopped, so the capture callback no longer touches the front-end
+            flushSpeechSink();
+            streaming_frontend_->inputFinished();
+            ASRModel::Result detailed = asr_model_->recognizeFeaturesDetailed(streaming_frontend_->frames(),
+                                                                              streaming_frontend_->numFramesReady());
+            result = detailed.text;
+            tags = describeTags(detailed);
+        } else {
+            ASRModel::Result detailed = asr_model_->recognizeDetailed(resampled_audio.data(), resampled_audio.size());
+            result = detailed.text;
+            tags = describeTags(detailed);
+        }
+        auto end_time = std::chrono::high_resolution_clock::now();
         
         auto processing_duration = std::chrono::duration<double>(end_time - start_time).count();
         
@@ -178,6 +489,9 @@ private:
             std::cout << "No speech recognized" << std::endl;
         } else {
             std::cout << "Recognition result: " << result << std::endl;
+            if (!tags.empty()) {
+                std::cout << "Tags: " << tags << std::endl;
+            }
             std::cout << "Processing time: " << processing_duration << "s" << std::endl;
             
             double audio_duration = static_cast<double>(resampled_audio.size()) / 16000.0;
@@ -186,42 +500,18 @@ private:
         }
     }
     
-    // Fast decimation resampling (for common ratios like 48k->16k)
-    std::vector<float> resampleAudio(const std::vector<float>& input, int from_rate, int to_rate) {
-        if (from_rate == to_rate) {
-            return input;
-        }
-        
-        // For 48kHz to 16kHz, we can simply take every 3rd sample (48/16 = 3)
-        if (from_rate == 48000 && to_rate == 16000) {
-            std::vector<float> output;
-            output.reserve(input.size() / 3);
-            for (size_t i = 0; i < input.size(); i += 3) {
-                output.push_back(input[i]);
-            }
-            return output;
-        }
-        
-        // For other ratios, use simple decimation
-        double ratio = static_cast<double>(from_rate) / to_rate;
-        size_t output_size = static_cast<size_t>(input.size() / ratio);
-        std::vector<float> output;
-        output.reserve(output_size);
-        
-        for (size_t i = 0; i < output_size; ++i) {
-            size_t src_idx = static_cast<size_t>(i * ratio);
-            if (src_idx < input.size()) {
-                output.push_back(input[src_idx]);
-            }
-        }
-        
-        return output;
-    }
-    
     std::unique_ptr<AudioRecorder> audio_recorder_;
     std::unique_ptr<VADDetector> vad_detector_;
     std::unique_ptr<ASRModel> asr_model_;
+    std::unique_ptr<BatchScheduler> scheduler_;
+    std::unique_ptr<OnlineFeatureExtractor> streaming_frontend_;
+    std::unique_ptr<StreamingRecognizer> streaming_recognizer_;
+    std::unique_ptr<OfflineTranscriber> offline_transcriber_;
+    std::unique_ptr<Resampler> capture_resampler_;  // capture rate -> 16kHz for the speech sink
+    SpeechSink speech_sink_;
+    std::vector<float> sink_buffer_;
     RecorderParams recorder_params_;
+    std::ostream& transcripts_;
 };
 
 void printUsage(const char* program_name) {
@@ -234,14 +524,31 @@ void printUsage(const char* program_name) {
     std::cout << "  --max_record_time <value>   Maximum recording time in seconds (default: 5.0)" << std::endl;
     std::cout << "  --trigger_threshold <value> VAD trigger threshold (default: 0.6)" << std::endl;
     std::cout << "  --stop_threshold <value>    VAD stop threshold (default: 0.35)" << std::endl;
-    std::cout << "  --vad_type <type>           VAD type: 'energy' or 'silero' (default: energy)" << std::endl;
+    std::cout << "  --vad_type <type>           VAD type: 'energy', 'silero' or 'cascade' (default: energy)" << std::endl;
+    std::cout << "  --use_scheduler             Recognize through the batch scheduler" << std::endl;
+    std::cout << "  --partial_results           Show partial results while speaking" << std::endl;
+    std::cout << "  --continuous                Listen continuously and recognize every utterance" << std::endl;
+    std::cout << "  --input <file|list.txt>     Transcribe an audio file or a list of files instead of the microphone" << std::endl;
+    std::cout << "  --output <file>             Write file-mode results here (default: stdout)" << std::endl;
+    std::cout << "  --num_threads <value>       Parallel decode sessions in file mode (default: 2)" << std::endl;
+    std::cout << "  --beam_size <value>         CTC prefix beam search width, 1 = greedy (default: 1)" << std::endl;
+    std::cout << "  --hotwords <file>           Bias decoding towards the words in this file, one per line" << std::endl;
+    std::cout << "  --no_cache                  Do not read or write the startup cache (binary vocab, optimized models)" << std::endl;
+    std::cout << "  --mmap_models               Load models from shared memory mappings (lower RSS across processes)" << std::endl;
+    std::cout << "  --provider <list>           Execution providers to try in order: auto, cpu, xnnpack, cuda, tensorrt, spacemit (default: auto)" << std::endl;
+    std::cout << "  --precision <type>          ASR model variant: auto, int8, fp32 or fp16 (default: auto)" << std::endl;
+    std::cout << "  --no_warmup                 Skip the ASR warmup runs at startup" << std::endl;
+    std::cout << "  --shape_buckets <n,...>     Pad ASR inputs up to these frame counts (60ms each), e.g. 50,100,200" << std::endl;
+    std::cout << "  --arena_max_mb <n>          Cap the shared ONNX Runtime arena at n MB (default: unbounded)" << std::endl;
+    std::cout << "  --arena_extend <strategy>   Arena growth: power_of_two or same_as_requested (default: power_of_two)" << std::endl;
+    std::cout << "  --timestamps                In file mode, list every token with its time span and confidence" << std::endl;
+    std::cout << "  --result_cache <n>          Reuse the results of the last n distinct clips for identical audio (default: off)" << std::endl;
+    std::cout << "  --perf                      Print a per-utterance stage timing breakdown" << std::endl;
+    std::cout << "  --metrics <file>            Write stage latency percentiles and RTF (Prometheus text) on exit" << std::endl;
     std::cout << "  --help                      Show this help message" << std::endl;
 }
 
 int main(int argc, char** argv) {
-    std::cout << "ASR C++ Demo Application" << std::endl;
-    std::cout << "=========================" << std::endl;
-    
     // Parse command line arguments
     ASRDemo::RecorderParams params;
     
@@ -275,11 +582,80 @@ int main(int argc, char** argv) {
         }
         else if (arg == "--vad_type" && i + 1 < argc) {
             params.vad_type = argv[++i];
-            if (params.vad_type != "energy" && params.vad_type != "silero") {
-                std::cerr << "Invalid VAD type: " << params.vad_type << ". Must be 'energy' or 'silero'" << std::endl;
+            if (params.vad_type != "energy" && params.vad_type != "silero" && params.vad_type != "cascade") {
+                std::cerr << "Invalid VAD type: " << params.vad_type << ". Must be 'energy', 'silero' or 'cascade'" << std::endl;
                 return 1;
             }
         }
+        else if (arg == "--use_scheduler") {
+            params.use_scheduler = true;
+        }
+        else if (arg == "--partial_results") {
+            params.partial_results = true;
+        }
+        else if (arg == "--continuous") {
+            params.continuous = true;
+        }
+        else if (arg == "--input" && i + 1 < argc) {
+            params.input_path = argv[++i];
+        }
+        else if (arg == "--output" && i + 1 < argc) {
+            params.output_path = argv[++i];
+        }
+        else if (arg == "--num_threads" && i + 1 < argc) {
+            params.num_threads = std::atoi(argv[++i]);
+        }
+        else if (arg == "--beam_size" && i + 1 < argc) {
+            params.beam_size = std::atoi(argv[++i]);
+        }
+        else if (arg == "--hotwords" && i + 1 < argc) {
+            params.hotwords_path = argv[++i];
+        }
+        else if (arg == "--no_cache") {
+            params.startup_cache = false;
+        }
+        else if (arg == "--mmap_models") {
+            params.map_models = true;
+        }
+        else if (arg == "--provider" && i + 1 < argc) {
+            params.providers = argv[++i];
+        }
+        else if (arg == "--precision" && i + 1 < argc) {
+            params.precision = argv[++i];
+            if (params.precision != "auto" && params.precision != "int8" && params.precision != "fp32" &&
+                params.precision != "fp16") {
+                std::cerr << "Invalid precision: " << params.precision << ". Must be 'auto', 'int8', 'fp32' or 'fp16'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--no_warmup") {
+            params.warmup = false;
+        }
+        else if (arg == "--shape_buckets" && i + 1 < argc) {
+            params.shape_buckets = ASRModel::parseShapeBuckets(argv[++i]);
+        }
+        else if (arg == "--arena_max_mb" && i + 1 < argc) {
+            params.arena_max_mb = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (arg == "--arena_extend" && i + 1 < argc) {
+            std::string strategy = argv[++i];
+            if (!OrtRuntime::parseArenaExtend(strategy, params.arena_extend)) {
+                std::cerr << "Invalid arena strategy: " << strategy << ". Must be 'power_of_two' or 'same_as_requested'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--timestamps") {
+            params.timestamps = true;
+        }
+        else if (arg == "--result_cache" && i + 1 < argc) {
+            params.result_cache = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (arg == "--perf") {
+            params.print_performance = true;
+        }
+        else if (arg == "--metrics" && i + 1 < argc) {
+            params.metrics_path = argv[++i];
+        }
         else {
             std::cerr << "Unknown argument: " << arg << std::endl;
             printUsage(argv[0]);
@@ -287,6 +663,17 @@ int main(int argc, char** argv) {
         }
     }
     
+    // In file mode stdout carries only transcripts: the banner, configuration and library
+    // logging go to stderr, like the progress output
+    std::streambuf* stdout_buffer = std::cout.rdbuf();
+    std::ostream transcripts(stdout_buffer);
+    if (!params.input_path.empty()) {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+    
+    std::cout << "ASR C++ Demo Application" << std::endl;
+    std::cout << "=========================" << std::endl;
+    
     // Print configuration
     std::cout << "\nRecorder Configuration:" << std::endl;
     std::cout << "  Sample rate: " << params.sample_rate << " Hz" << std::endl;
@@ -299,10 +686,34 @@ int main(int argc, char** argv) {
               << params.trigger_threshold << std::endl;
     std::cout << "  Stop threshold: " << params.stop_threshold << std::endl;
     std::cout << "  VAD type: " << params.vad_type << std::endl;
+    std::cout << "  Batch scheduler: " << (params.use_scheduler ? "on" : "off") << std::endl;
+    std::cout << "  Partial results: " << (params.partial_results ? "on" : "off") << std::endl;
+    std::cout << "  Continuous listening: " << (params.continuous ? "on" : "off") << std::endl;
+    std::cout << "  Beam size: " << params.beam_size << std::endl;
+    std::cout << "  Startup cache: " << (params.startup_cache ? "on" : "off") << std::endl;
+    std::cout << "  Mapped models: " << (params.map_models ? "on" : "off") << std::endl;
+    std::cout << "  Execution providers: " << params.providers << std::endl;
+    std::cout << "  Precision: " << params.precision << std::endl;
+    std::cout << "  Warmup: " << (params.warmup ? "on" : "off") << std::endl;
+    std::cout << "  Shape buckets: " << (params.shape_buckets.empty() ? "off" : std::to_string(params.shape_buckets.size()))
+              << std::endl;
+    std::cout << "  Result cache: " << (params.result_cache == 0 ? "off" : std::to_string(params.result_cache))
+              << std::endl;
+    if (!params.metrics_path.empty()) {
+        std::cout << "  Metrics: " << params.metrics_path << std::endl;
+    }
+    if (!params.hotwords_path.empty()) {
+        std::cout << "  Hotwords: " << params.hotwords_path << std::endl;
+    }
+    if (!params.input_path.empty()) {
+        std::cout << "  Input: " << params.input_path << std::endl;
+        std::cout << "  Output: " << (params.output_path.empty() ? "stdout" : params.output_path) << std::endl;
+        std::cout << "  Decode threads: " << params.num_threads << std::endl;
+    }
     std::cout << std::endl;
     
     try {
-        ASRDemo demo(params);
+        ASRDemo demo(params, transcripts);
         if (!demo.initialize()) {
             std::cerr << "Failed to initialize demo" << std::endl;
             return 1;
@@ -310,6 +721,14 @@ int main(int argc, char** argv) {
         
         demo.run();
         
+        if (!params.metrics_path.empty()) {
+            std::ofstream metrics(params.metrics_path);
+            metrics << Metrics::instance().prometheusText();
+            if (!metrics) {
+                std::cerr << "Cannot write metrics file: " << params.metrics_path << std::endl;
+            }
+        }
+        
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
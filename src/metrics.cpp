@@ -0,0 +1,179 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+uint64_t toNanoseconds(double seconds) {
+    return seconds > 0.0 ? static_cast<uint64_t>(seconds * 1e9 + 0.5) : 0;
+}
+
+}  // namespace
+
+size_t LatencyHistogram::bucketIndex(double seconds) {
+    double us = seconds * 1e6;
+    if (!(us > 1.0)) {
+        return 0;
+    }
+    double index = std::ceil(kBucketsPerOctave * std::log2(us));
+    return std::min(kNumBuckets - 1, static_cast<size_t>(index));
+}
+
+double LatencyHistogram::bucketUpperBound(size_t index) {
+    return 1e-6 * std::exp2(static_cast<double>(index) / kBucketsPerOctave);
+}
+
+void LatencyHistogram::record(double seconds, uint64_t count) {
+    if (count == 0) {
+        return;
+    }
+    const uint64_t ns = toNanoseconds(seconds);
+    buckets_[bucketIndex(seconds)].fetch_add(count, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns * count, std::memory_order_relaxed);
+
+    uint64_t current = max_ns_.load(std::memory_order_relaxed);
+    while (ns > current && !max_ns_.compare_exchange_weak(current, ns, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Summary LatencyHistogram::summary() const {
+    // Buckets are read one by one while writers keep going, so the totals come from the
+    // bucket copy itself to keep the percentiles self-consistent
+    std::array<uint64_t, kNumBuckets> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    Summary summary;
+    summary.count = total;
+    summary.sum = static_cast<double>(sum_ns_.load(std::memory_order_relaxed)) * 1e-9;
+    summary.max = static_cast<double>(max_ns_.load(std::memory_order_relaxed)) * 1e-9;
+    if (total == 0) {
+        return summary;
+    }
+
+    auto percentile = [&](double q) {
+        const double target = std::max(1.0, std::ceil(q * static_cast<double>(total)));
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < kNumBuckets; ++i) {
+            if (counts[i] == 0) {
+                continue;
+            }
+            if (static_cast<double>(cumulative + counts[i]) >= target) {
+                double lower = i == 0 ? 0.0 : bucketUpperBound(i - 1);
+                double upper = bucketUpperBound(i);
+                double fraction = (target - static_cast<double>(cumulative)) / static_cast<double>(counts[i]);
+                return std::min(summary.max, lower + (upper - lower) * fraction);
+            }
+            cumulative += counts[i];
+        }
+        return summary.max;
+    };
+    summary.p50 = percentile(0.50);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    return summary;
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    sum_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+}
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+const char* Metrics::stageName(Stage stage) {
+    switch (stage) {
+        case Stage::Feature: return "feature";
+        case Stage::Inference: return "inference";
+        case Stage::CTC: return "ctc";
+        case Stage::Detokenize: return "detokenize";
+        case Stage::VADWindow: return "vad_window";
+        case Stage::Endpoint: return "endpoint";
+    }
+    return "unknown";
+}
+
+void Metrics::addRecognition(double audio_seconds, double compute_seconds, uint64_t utterances) {
+    utterances_.fetch_add(utterances, std::memory_order_relaxed);
+    audio_ns_.fetch_add(toNanoseconds(audio_seconds), std::memory_order_relaxed);
+    compute_ns_.fetch_add(toNanoseconds(compute_seconds), std::memory_order_relaxed);
+}
+
+Metrics::Snapshot Metrics::snapshot() const {
+    Snapshot snapshot;
+    snapshot.stages.reserve(kNumStages);
+    for (size_t i = 0; i < kNumStages; ++i) {
+        snapshot.stages.push_back({stageName(static_cast<Stage>(i)), histograms_[i].summary()});
+    }
+    snapshot.utterances = utterances_.load(std::memory_order_relaxed);
+    snapshot.audio_seconds = static_cast<double>(audio_ns_.load(std::memory_order_relaxed)) * 1e-9;
+    snapshot.compute_seconds = static_cast<double>(compute_ns_.load(std::memory_order_relaxed)) * 1e-9;
+    snapshot.rtf = snapshot.audio_seconds > 0.0 ? snapshot.compute_seconds / snapshot.audio_seconds : 0.0;
+    snapshot.cache_hits = cache_hits_.load(std::memory_order_relaxed);
+    snapshot.cache_misses = cache_misses_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+std::string Metrics::prometheusText() const {
+    Snapshot snap = snapshot();
+    std::ostringstream out;
+    out.precision(9);
+
+    out << "# HELP sensevoice_stage_latency_seconds Latency of each pipeline stage.\n"
+        << "# TYPE sensevoice_stage_latency_seconds summary\n";
+    for (const StageStats& stage : snap.stages) {
+        const std::string label = std::string("stage=\"") + stage.name + "\"";
+        out << "sensevoice_stage_latency_seconds{" << label << ",quantile=\"0.5\"} " << stage.latency.p50 << "\n"
+            << "sensevoice_stage_latency_seconds{" << label << ",quantile=\"0.95\"} " << stage.latency.p95 << "\n"
+            << "sensevoice_stage_latency_seconds{" << label << ",quantile=\"0.99\"} " << stage.latency.p99 << "\n"
+            << "sensevoice_stage_latency_seconds_sum{" << label << "} " << stage.latency.sum << "\n"
+            << "sensevoice_stage_latency_seconds_count{" << label << "} " << stage.latency.count << "\n";
+    }
+
+    out << "# HELP sensevoice_stage_latency_max_seconds Slowest observation of each stage.\n"
+        << "# TYPE sensevoice_stage_latency_max_seconds gauge\n";
+    for (const StageStats& stage : snap.stages) {
+        out << "sensevoice_stage_latency_max_seconds{stage=\"" << stage.name << "\"} " << stage.latency.max << "\n";
+    }
+
+    out << "# HELP sensevoice_utterances_total Utterances recognized.\n"
+        << "# TYPE sensevoice_utterances_total counter\n"
+        << "sensevoice_utterances_total " << snap.utterances << "\n"
+        << "# HELP sensevoice_audio_seconds_total Seconds of audio recognized.\n"
+        << "# TYPE sensevoice_audio_seconds_total counter\n"
+        << "sensevoice_audio_seconds_total " << snap.audio_seconds << "\n"
+        << "# HELP sensevoice_compute_seconds_total Wall time spent recognizing.\n"
+        << "# TYPE sensevoice_compute_seconds_total counter\n"
+        << "sensevoice_compute_seconds_total " << snap.compute_seconds << "\n"
+        << "# HELP sensevoice_real_time_factor Compute time over audio time since start.\n"
+        << "# TYPE sensevoice_real_time_factor gauge\n"
+        << "sensevoice_real_time_factor " << snap.rtf << "\n"
+        << "# HELP sensevoice_result_cache_hits_total Recognitions answered from the result cache.\n"
+        << "# TYPE sensevoice_result_cache_hits_total counter\n"
+        << "sensevoice_result_cache_hits_total " << snap.cache_hits << "\n"
+        << "# HELP sensevoice_result_cache_misses_total Result cache lookups that ran the model.\n"
+        << "# TYPE sensevoice_result_cache_misses_total counter\n"
+        << "sensevoice_result_cache_misses_total " << snap.cache_misses << "\n";
+    return out.str();
+}
+
+void Metrics::reset() {
+    for (auto& histogram : histograms_) {
+        histogram.reset();
+    }
+    utterances_.store(0, std::memory_order_relaxed);
+    audio_ns_.store(0, std::memory_order_relaxed);
+    compute_ns_.store(0, std::memory_order_relaxed);
+    cache_hits_.store(0, std::memory_order_relaxed);
+    cache_misses_.store(0, std::memory_order_relaxed);
+}
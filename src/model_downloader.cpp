@@ -1,15 +1,157 @@
 #include "model_downloader.hpp"
+#include "sha256.hpp"
+#include "tar_gz_extractor.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <mutex>
 #include <curl/curl.h>
 #include <cstdlib>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char* kUserAgent = "ASR_CPP/1.0";
+
+void initCurl() {
+    // Not thread-safe itself, so done once before any transfer
+    static std::once_flag once;
+    std::call_once(once, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+}
+
+// Stall detection instead of a total timeout, so large files on slow links still finish
+void setCommonOptions(CURL* curl, const std::string& url) {
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, kUserAgent);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1024L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 60L);
+}
+
+struct ProbeHeaders {
+    bool ranges = false;
+    std::string etag;
+    std::string last_modified;
+};
+
+size_t headerCallback(char* buffer, size_t size, size_t nitems, void* userdata) {
+    ProbeHeaders* headers = static_cast<ProbeHeaders*>(userdata);
+    size_t total_size = size * nitems;
+    std::string line(buffer, total_size);
+    
+    // Each redirect hop starts a new header block
+    if (line.compare(0, 5, "HTTP/") == 0) {
+        *headers = ProbeHeaders();
+        return total_size;
+    }
+    
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+        return total_size;
+    }
+    std::string name = line.substr(0, colon);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+    size_t begin = line.find_first_not_of(" \t", colon + 1);
+    size_t end = line.find_last_not_of(" \t\r\n");
+    std::string value = begin == std::string::npos || end < begin ? "" : line.substr(begin, end - begin + 1);
+    
+    if (name == "accept-ranges") {
+        headers->ranges = value.find("bytes") != std::string::npos;
+    } else if (name == "etag") {
+        headers->etag = value;
+    } else if (name == "last-modified") {
+        headers->last_modified = value;
+    }
+    return total_size;
+}
+
+// Single-stream transfer: bytes go to the file and on to the sink
+struct StreamTransfer {
+    std::ofstream* file = nullptr;
+    const std::function<bool(const uint8_t*, size_t)>* sink = nullptr;
+    bool sink_failed = false;
+};
+
+size_t streamWriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+    StreamTransfer* transfer = static_cast<StreamTransfer*>(userp);
+    size_t total_size = size * nmemb;
+    
+    transfer->file->write(static_cast<const char*>(contents), total_size);
+    if (!*transfer->file) {
+        return 0;
+    }
+    if (*transfer->sink && !(*transfer->sink)(static_cast<const uint8_t*>(contents), total_size)) {
+        transfer->sink_failed = true;
+        return 0;
+    }
+    return total_size;
+}
+
+int streamProgressCallback(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t, curl_off_t) {
+    ModelDownloader::ProgressCallback* progress_cb = static_cast<ModelDownloader::ProgressCallback*>(clientp);
+    if (dltotal > 0) {
+        (*progress_cb)(static_cast<double>(dlnow) / static_cast<double>(dltotal));
+    }
+    return 0; // Continue download
+}
+
+// One range request of a chunked download, written in place with pwrite
+struct ChunkTransfer {
+    CURL* curl = nullptr;
+    int fd = -1;
+    size_t chunk = 0;
+    int64_t position = 0;   // next byte to write
+    int64_t end = 0;        // one past the chunk's last byte
+};
+
+size_t chunkWriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+    ChunkTransfer* transfer = static_cast<ChunkTransfer*>(userp);
+    size_t total_size = size * nmemb;
+    
+    // More than was asked for: the server ignored the range
+    if (transfer->position + static_cast<int64_t>(total_size) > transfer->end) {
+        return 0;
+    }
+    const char* data = static_cast<const char*>(contents);
+    size_t written = 0;
+    while (written < total_size) {
+        ssize_t n = pwrite(transfer->fd, data + written, total_size - written,
+                           static_cast<off_t>(transfer->position + written));
+        if (n <= 0) {
+            return 0;
+        }
+        written += static_cast<size_t>(n);
+    }
+    transfer->position += static_cast<int64_t>(total_size);
+    return total_size;
+}
+
+bool readFully(int fd, uint8_t* buffer, size_t size, int64_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = pread(fd, buffer + done, size - done, static_cast<off_t>(offset + done));
+        if (n <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+}  // namespace
 
 // Static constants
 const std::string ModelDownloader::ASR_MODEL_NAME = "model.onnx";
 const std::string ModelDownloader::ASR_MODEL_QUANT_NAME = "model_quant_optimized.onnx";
+const std::string ModelDownloader::ASR_MODEL_FP16_NAME = "model_fp16.onnx";
 const std::string ModelDownloader::VAD_MODEL_NAME = "silero_vad.onnx";
 const std::string ModelDownloader::CONFIG_NAME = "config.yaml";
 const std::string ModelDownloader::VOCAB_NAME = "tokens.txt";
@@ -37,42 +179,362 @@ bool ModelDownloader::ensureModelsExist() {
         ASR_MODEL_QUANT_NAME, VAD_MODEL_NAME
     };
     
-    bool all_exist = true;
+    std::vector<std::string> missing_models;
     for (const std::string& model : required_models) {
         if (!isModelAvailable(model)) {
             std::cout << "Model " << model << " not found" << std::endl;
-            all_exist = false;
+            missing_models.push_back(model);
         }
     }
     
-    if (!all_exist) {
-        std::cout << "Models not found, downloading..." << std::endl;
-        return downloadModels();
+    if (missing_models.empty()) {
+        std::cout << "All required models are available" << std::endl;
+        return true;
     }
     
-    std::cout << "All required models are available" << std::endl;
-    return true;
+    // Fetching just the missing files is far less than the whole archive on a partly provisioned node
+    if (!config_.asset_base_url.empty()) {
+        std::cout << "Downloading missing model files..." << std::endl;
+        if (downloadAssets(missing_models)) {
+            return true;
+        }
+        std::cerr << "Per-file download failed, falling back to the model archive" << std::endl;
+    }
+    
+    std::cout << "Models not found, downloading..." << std::endl;
+    return downloadModels();
 }
 
 bool ModelDownloader::downloadModels(ProgressCallback progress_cb) {
     std::string archive_path = cache_dir_expanded_ + "/sensevoice.tar.gz";
+    std::string temp_dir = cache_dir_expanded_ + "/temp_extract";
+    std::error_code ec;
+    std::filesystem::remove_all(temp_dir, ec);
+    std::filesystem::create_directories(temp_dir, ec);
+    
+    // Unpack and hash while the archive downloads; a resumed download replays the part
+    // already on disk through the same sink first
+    TarGzExtractor extractor(temp_dir);
+    Sha256 sha256;
+    DataSink sink = [&](const uint8_t* data, size_t size) {
+        sha256.update(data, size);
+        return extractor.feed(data, size);
+    };
+    
+    bool ok = downloadFile(config_.model_url, archive_path, progress_cb, sink);
+    if (ok) {
+        extractor.finish();
+    }
+    if (!extractor.error().empty()) {
+        std::cerr << "Failed to extract archive: " << extractor.error() << std::endl;
+        ok = false;
+    }
+    
+    if (ok && config_.verify_checksum && !config_.expected_checksum.empty()) {
+        std::string actual_checksum = sha256.hexDigest();
+        if (actual_checksum != config_.expected_checksum) {
+            std::cerr << "Checksum mismatch for " << config_.model_url << ": expected " << config_.expected_checksum
+                      << ", got " << actual_checksum << std::endl;
+            ok = false;
+        }
+    }
     
-    if (!downloadFile(config_.model_url, archive_path, progress_cb)) {
+    if (ok) {
+        ok = installExtracted(temp_dir);
+        if (ok) {
+            std::cout << "Models extracted successfully" << std::endl;
+        }
+    }
+    
+    // Clean up; an interrupted transfer keeps only its .part file for the next attempt
+    std::filesystem::remove_all(temp_dir, ec);
+    std::filesystem::remove(archive_path, ec);
+    
+    return ok;
+}
+
+bool ModelDownloader::downloadAssets(const std::vector<std::string>& model_names, ProgressCallback progress_cb) {
+    std::string base_url = config_.asset_base_url;
+    while (!base_url.empty() && base_url.back() == '/') {
+        base_url.pop_back();
+    }
+    
+    for (const std::string& name : model_names) {
+        // Verified under a temporary name, so a bad file never appears at the model path
+        const std::string model_path = getModelPath(name);
+        const std::string temp_path = model_path + ".download";
+        Sha256 sha256;
+        DataSink sink = [&](const uint8_t* data, size_t size) {
+            sha256.update(data, size);
+            return true;
+        };
+        if (!downloadFile(base_url + "/" + name, temp_path, progress_cb, sink)) {
+            return false;
+        }
+        
+        auto expected = config_.asset_checksums.find(name);
+        if (expected != config_.asset_checksums.end()) {
+            std::string actual_checksum = sha256.hexDigest();
+            if (actual_checksum != expected->second) {
+                std::cerr << "Checksum mismatch for " << name << ": expected " << expected->second
+                          << ", got " << actual_checksum << std::endl;
+                std::error_code ec;
+                std::filesystem::remove(temp_path, ec);
+                return false;
+            }
+        }
+        
+        std::error_code ec;
+        std::filesystem::rename(temp_path, model_path, ec);
+        if (ec) {
+            std::cerr << "Failed to install " << model_path << ": " << ec.message() << std::endl;
+            std::filesystem::remove(temp_path, ec);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ModelDownloader::downloadFile(const std::string& url, const std::string& output_path, 
+                                  ProgressCallback progress_cb, const DataSink& sink) {
+    initCurl();
+    const std::string part_path = output_path + ".part";
+    
+    RemoteInfo info;
+    bool ok = false;
+    if (probe(url, info) && info.ranges && info.size > 0) {
+        TransferStatus status = downloadRanges(url, part_path, info, progress_cb, sink);
+        if (status == TransferStatus::NoRanges) {
+            std::cout << "Server ignored range requests, downloading in one stream" << std::endl;
+            ok = downloadStream(url, part_path, progress_cb, sink);
+        } else {
+            ok = status == TransferStatus::Done;
+        }
+    } else {
+        ok = downloadStream(url, part_path, progress_cb, sink);
+    }
+    if (!ok) {
         return false;
     }
     
-    if (!extractModels(archive_path)) {
+    std::error_code ec;
+    std::filesystem::rename(part_path, output_path, ec);
+    if (ec) {
+        std::cerr << "Failed to move " << part_path << " into place: " << ec.message() << std::endl;
+        return false;
+    }
+    
+    std::cout << "Download completed: " << output_path << std::endl;
+    return true;
+}
+
+bool ModelDownloader::probe(const std::string& url, RemoteInfo& info) {
+    CURL* curl = curl_easy_init();
+    if (!curl) {
         return false;
     }
     
-    // Clean up archive
-    std::filesystem::remove(archive_path);
+    ProbeHeaders headers;
+    setCommonOptions(curl, url);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, headerCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &headers);
     
+    CURLcode res = curl_easy_perform(curl);
+    long response_code = 0;
+    curl_off_t content_length = -1;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
+    curl_easy_cleanup(curl);
+    
+    // Servers that reject HEAD still get the plain download
+    if (res != CURLE_OK || response_code != 200) {
+        return false;
+    }
+    
+    info.size = static_cast<int64_t>(content_length);
+    info.ranges = headers.ranges;
+    info.validator = !headers.etag.empty() ? headers.etag : headers.last_modified;
     return true;
 }
 
-bool ModelDownloader::downloadFile(const std::string& url, const std::string& output_path, 
-                                  ProgressCallback progress_cb) {
+ModelDownloader::TransferStatus ModelDownloader::downloadRanges(const std::string& url, const std::string& part_path,
+                                                                const RemoteInfo& info, ProgressCallback progress_cb,
+                                                                const DataSink& sink) {
+    const size_t chunk_bytes = std::max<size_t>(config_.chunk_bytes, 64 * 1024);
+    const size_t num_chunks = static_cast<size_t>((info.size + chunk_bytes - 1) / chunk_bytes);
+    const std::string state_path = part_path + ".state";
+    
+    // Resume state: a header naming the remote revision and chunking, then one line per
+    // finished chunk. Anything that does not match starts the file over.
+    std::ostringstream header;
+    header << info.size << " " << chunk_bytes << " " << info.validator;
+    std::vector<char> done(num_chunks, 0);
+    size_t resumed = 0;
+    {
+        std::ifstream state_in(state_path);
+        std::string line;
+        if (state_in && std::getline(state_in, line) && line == header.str() &&
+            static_cast<int64_t>(getFileSize(part_path)) == info.size) {
+            size_t chunk = 0;
+            while (state_in >> chunk) {
+                if (chunk < num_chunks && !done[chunk]) {
+                    done[chunk] = 1;
+                    ++resumed;
+                }
+            }
+        }
+    }
+    if (resumed == 0) {
+        std::error_code ec;
+        std::filesystem::remove(part_path, ec);
+    } else {
+        std::cout << "Resuming download: " << resumed << "/" << num_chunks << " chunks already present" << std::endl;
+    }
+    
+    int fd = open(part_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(info.size)) != 0) {
+        std::cerr << "Failed to open output file: " << part_path << std::endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return TransferStatus::Failed;
+    }
+    std::ofstream state_out(state_path, resumed == 0 ? std::ios::trunc : std::ios::app);
+    if (resumed == 0) {
+        state_out << header.str() << "\n" << std::flush;
+    }
+    
+    std::deque<size_t> pending;
+    for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        if (!done[chunk]) {
+            pending.push_back(chunk);
+        }
+    }
+    std::vector<int> attempts(num_chunks, 0);
+    
+    CURLM* multi = curl_multi_init();
+    const size_t connections = std::min(pending.size(), static_cast<size_t>(std::max(1, config_.connections)));
+    std::vector<ChunkTransfer> transfers(connections);
+    int active = 0;
+    
+    // Lowest chunks first, so the in-order consumer below rarely waits
+    auto startChunk = [&](ChunkTransfer& transfer) {
+        transfer.chunk = pending.front();
+        pending.pop_front();
+        transfer.position = static_cast<int64_t>(transfer.chunk * chunk_bytes);
+        transfer.end = std::min(info.size, transfer.position + static_cast<int64_t>(chunk_bytes));
+        std::string range = std::to_string(transfer.position) + "-" + std::to_string(transfer.end - 1);
+        curl_easy_setopt(transfer.curl, CURLOPT_RANGE, range.c_str());
+        curl_multi_add_handle(multi, transfer.curl);
+        ++active;
+    };
+    for (ChunkTransfer& transfer : transfers) {
+        transfer.fd = fd;
+        transfer.curl = curl_easy_init();
+        setCommonOptions(transfer.curl, url);
+        curl_easy_setopt(transfer.curl, CURLOPT_WRITEFUNCTION, chunkWriteCallback);
+        curl_easy_setopt(transfer.curl, CURLOPT_WRITEDATA, &transfer);
+        curl_easy_setopt(transfer.curl, CURLOPT_PRIVATE, &transfer);
+        startChunk(transfer);
+    }
+    
+    TransferStatus status = TransferStatus::Done;
+    bool sink_failed = false;
+    size_t next_consume = 0;
+    std::vector<uint8_t> buffer(sink ? chunk_bytes : 0);
+    
+    while (true) {
+        // Hand the finished prefix of the file to the sink, in order
+        while (next_consume < num_chunks && done[next_consume]) {
+            int64_t begin = static_cast<int64_t>(next_consume * chunk_bytes);
+            size_t length = static_cast<size_t>(std::min<int64_t>(chunk_bytes, info.size - begin));
+            if (sink && (!readFully(fd, buffer.data(), length, begin) || !sink(buffer.data(), length))) {
+                sink_failed = true;
+                break;
+            }
+            ++next_consume;
+            if (progress_cb) {
+                progress_cb(static_cast<double>(begin + static_cast<int64_t>(length)) / info.size);
+            }
+        }
+        if (sink_failed) {
+            status = TransferStatus::Failed;
+            break;
+        }
+        if (next_consume == num_chunks) {
+            break;
+        }
+        if (active == 0) {
+            status = TransferStatus::Failed;
+            break;
+        }
+        
+        int running = 0;
+        curl_multi_perform(multi, &running);
+        int queued = 0;
+        while (CURLMsg* message = curl_multi_info_read(multi, &queued)) {
+            if (message->msg != CURLMSG_DONE) {
+                continue;
+            }
+            char* private_data = nullptr;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &private_data);
+            ChunkTransfer& transfer = *reinterpret_cast<ChunkTransfer*>(private_data);
+            CURLcode result = message->data.result;
+            long response_code = 0;
+            curl_easy_getinfo(transfer.curl, CURLINFO_RESPONSE_CODE, &response_code);
+            curl_multi_remove_handle(multi, transfer.curl);
+            --active;
+            
+            if (result == CURLE_OK && response_code == 206 && transfer.position == transfer.end) {
+                // On disk before it is recorded, so a crash never resumes over a hole
+                fdatasync(fd);
+                done[transfer.chunk] = 1;
+                state_out << transfer.chunk << "\n" << std::flush;
+            } else if (response_code == 200 && next_consume == 0) {
+                status = TransferStatus::NoRanges;
+            } else if (++attempts[transfer.chunk] > config_.max_retries) {
+                std::cerr << "Download of " << url << " failed at chunk " << transfer.chunk << ": "
+                          << (result != CURLE_OK ? curl_easy_strerror(result)
+                                                 : ("HTTP code " + std::to_string(response_code)).c_str())
+                          << std::endl;
+                status = TransferStatus::Failed;
+            } else {
+                pending.push_front(transfer.chunk);
+            }
+            
+            if (status == TransferStatus::Done && !pending.empty()) {
+                startChunk(transfer);
+            }
+        }
+        if (status != TransferStatus::Done) {
+            break;
+        }
+        curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+    }
+    
+    for (ChunkTransfer& transfer : transfers) {
+        curl_multi_remove_handle(multi, transfer.curl);
+        curl_easy_cleanup(transfer.curl);
+    }
+    curl_multi_cleanup(multi);
+    close(fd);
+    state_out.close();
+    
+    // Keep the partial file for a resume only after network errors; bad data or a server
+    // without range support would just fail the same way again
+    std::error_code ec;
+    if (status == TransferStatus::Done || status == TransferStatus::NoRanges || sink_failed) {
+        std::filesystem::remove(state_path, ec);
+    }
+    if (status == TransferStatus::NoRanges || sink_failed) {
+        std::filesystem::remove(part_path, ec);
+    }
+    return status;
+}
+
+bool ModelDownloader::downloadStream(const std::string& url, const std::string& part_path, 
+                                    ProgressCallback progress_cb, const DataSink& sink) {
     CURL* curl;
     CURLcode res;
     
@@ -82,85 +544,121 @@ bool ModelDownloader::downloadFile(const std::string& url, const std::string& ou
         return false;
     }
     
-    std::ofstream file(output_path, std::ios::binary);
+    std::ofstream file(part_path, std::ios::binary | std::ios::trunc);
     if (!file.is_open()) {
-        std::cerr << "Failed to open output file: " << output_path << std::endl;
+        std::cerr << "Failed to open output file: " << part_path << std::endl;
         curl_easy_cleanup(curl);
         return false;
     }
     
-    DownloadData download_data;
-    download_data.progress_cb = progress_cb;
+    StreamTransfer transfer;
+    transfer.file = &file;
+    transfer.sink = &sink;
     
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &file);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "ASR_CPP/1.0");
+    setCommonOptions(curl, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, streamWriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer);
     
     if (progress_cb) {
-        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progressCallback);
-        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &download_data);
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, streamProgressCallback);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &progress_cb);
         curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
     }
     
     res = curl_easy_perform(curl);
     
-    long response_code;
+    long response_code = 0;
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
     
     curl_easy_cleanup(curl);
     file.close();
     
     if (res != CURLE_OK) {
-        std::cerr << "Download failed: " << curl_easy_strerror(res) << std::endl;
-        std::filesystem::remove(output_path);
+        if (!transfer.sink_failed) {
+            std::cerr << "Download failed: " << curl_easy_strerror(res) << std::endl;
+        }
+        std::error_code ec;
+        std::filesystem::remove(part_path, ec);
         return false;
     }
     
     if (response_code != 200) {
         std::cerr << "Download failed with HTTP code: " << response_code << std::endl;
-        std::filesystem::remove(output_path);
+        std::error_code ec;
+        std::filesystem::remove(part_path, ec);
         return false;
     }
     
-    std::cout << "Download completed: " << output_path << std::endl;
     return true;
 }
 
 bool ModelDownloader::extractModels(const std::string& archive_path) {
     // First extract to a temporary directory to check structure
     std::string temp_dir = cache_dir_expanded_ + "/temp_extract";
-    std::filesystem::create_directories(temp_dir);
-    
-    // Extract to temp directory
-    std::string cmd = "tar -xzf \"" + archive_path + "\" -C \"" + temp_dir + "\"";
-    
-    int result = std::system(cmd.c_str());
-    if (result != 0) {
-        std::cerr << "Failed to extract archive: " << archive_path << std::endl;
-        std::filesystem::remove_all(temp_dir);
+    std::error_code ec;
+    std::filesystem::create_directories(temp_dir, ec);
+    if (ec) {
+        std::cerr << "Failed to create " << temp_dir << ": " << ec.message() << std::endl;
         return false;
     }
     
-    // Check if extracted files are in a subdirectory
-    std::string sensevoice_subdir = temp_dir + "/sensevoice";
-    if (std::filesystem::exists(sensevoice_subdir) && std::filesystem::is_directory(sensevoice_subdir)) {
-        // Move files from sensevoice subdirectory to cache root
-        for (const auto& entry : std::filesystem::directory_iterator(sensevoice_subdir)) {
-            std::filesystem::rename(entry.path(), cache_dir_expanded_ + "/" + entry.path().filename().string());
-        }
-    } else {
-        // Move all files from temp to cache root
-        for (const auto& entry : std::filesystem::directory_iterator(temp_dir)) {
-            std::filesystem::rename(entry.path(), cache_dir_expanded_ + "/" + entry.path().filename().string());
+    std::ifstream archive(archive_path, std::ios::binary);
+    TarGzExtractor extractor(temp_dir);
+    std::vector<char> buffer(1 << 20);
+    bool ok = archive.is_open();
+    while (ok && archive) {
+        archive.read(buffer.data(), buffer.size());
+        std::streamsize count = archive.gcount();
+        if (count > 0) {
+            ok = extractor.feed(reinterpret_cast<const uint8_t*>(buffer.data()), static_cast<size_t>(count));
         }
     }
+    if (ok) {
+        ok = extractor.finish();
+    }
+    if (!ok) {
+        std::cerr << "Failed to extract archive: " << archive_path
+                  << (extractor.error().empty() ? "" : ": " + extractor.error()) << std::endl;
+        std::filesystem::remove_all(temp_dir, ec);
+        return false;
+    }
+    
+    ok = installExtracted(temp_dir);
     
     // Clean up temp directory
-    std::filesystem::remove_all(temp_dir);
+    std::filesystem::remove_all(temp_dir, ec);
+    
+    if (ok) {
+        std::cout << "Models extracted successfully" << std::endl;
+    }
+    return ok;
+}
+
+bool ModelDownloader::installExtracted(const std::string& temp_dir) {
+    // Check if extracted files are in a subdirectory
+    std::string source_dir = temp_dir;
+    std::string sensevoice_subdir = temp_dir + "/sensevoice";
+    std::error_code ec;
+    if (std::filesystem::is_directory(sensevoice_subdir, ec)) {
+        source_dir = sensevoice_subdir;
+    }
     
-    std::cout << "Models extracted successfully" << std::endl;
+    // Move files from the extracted tree to cache root; the range-for form would throw on
+    // a failed increment
+    std::filesystem::directory_iterator it(source_dir, ec);
+    for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+        std::filesystem::path target = cache_dir_expanded_ + "/" + it->path().filename().string();
+        std::error_code rename_ec;
+        std::filesystem::rename(it->path(), target, rename_ec);
+        if (rename_ec) {
+            std::cerr << "Failed to install " << target.string() << ": " << rename_ec.message() << std::endl;
+            return false;
+        }
+    }
+    if (ec) {
+        std::cerr << "Failed to read " << source_dir << ": " << ec.message() << std::endl;
+        return false;
+    }
     return true;
 }
 
@@ -168,6 +666,42 @@ std::string ModelDownloader::getModelPath(const std::string& model_name) const {
     return cache_dir_expanded_ + "/" + model_name;
 }
 
+std::string ModelDownloader::getAsrModelPath(const std::string& precision, bool gpu, std::string* selected) const {
+    // Preference order per request; int8 QDQ kernels only pay off on CPUs, fp16 only on GPUs
+    std::vector<std::string> order;
+    if (precision == "fp16" || (precision == "auto" && gpu)) {
+        order = {"fp16", "fp32", "int8"};
+    } else if (precision == "fp32") {
+        order = {"fp32", "int8"};
+    } else {
+        order = {"int8", "fp32"};
+    }
+    
+    for (const std::string& candidate : order) {
+        const std::string& name = candidate == "fp16" ? ASR_MODEL_FP16_NAME
+                                : candidate == "fp32" ? ASR_MODEL_NAME : ASR_MODEL_QUANT_NAME;
+        if (isModelAvailable(name)) {
+            if (candidate != order.front() && precision != "auto") {
+                std::cerr << "Warning: no " << precision << " ASR model in " << cache_dir_expanded_
+                          << ", using " << candidate << std::endl;
+            }
+            if (selected) {
+                *selected = candidate;
+            }
+            return getModelPath(name);
+        }
+    }
+    
+    if (selected) {
+        *selected = "int8";
+    }
+    return getModelPath(ASR_MODEL_QUANT_NAME);
+}
+
+std::string ModelDownloader::getStartupCacheDir() const {
+    return cache_dir_expanded_ + "/startup_cache";
+}
+
 bool ModelDownloader::isModelAvailable(const std::string& model_name) const {
     return fileExists(getModelPath(model_name));
 }
@@ -200,7 +734,8 @@ std::string ModelDownloader::expandPath(const std::string& path) {
 }
 
 bool ModelDownloader::fileExists(const std::string& path) const {
-    return std::filesystem::exists(path) && std::filesystem::is_regular_file(path);
+    std::error_code ec;
+    return std::filesystem::is_regular_file(path, ec);
 }
 
 size_t ModelDownloader::getFileSize(const std::string& path) const {
@@ -211,26 +746,6 @@ size_t ModelDownloader::getFileSize(const std::string& path) const {
     }
 }
 
-size_t ModelDownloader::writeCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-    std::ofstream* file = static_cast<std::ofstream*>(userp);
-    size_t total_size = size * nmemb;
-    
-    file->write(static_cast<const char*>(contents), total_size);
-    return total_size;
-}
-
-int ModelDownloader::progressCallback(void* clientp, double dltotal, double dlnow, 
-                                     double ultotal, double ulnow) {
-    DownloadData* data = static_cast<DownloadData*>(clientp);
-    
-    if (data->progress_cb && dltotal > 0) {
-        double progress = dlnow / dltotal;
-        data->progress_cb(progress);
-    }
-    
-    return 0; // Continue download
-}
-
 bool ModelDownloader::verifyChecksum(const std::string& file_path, 
                                     const std::string& expected_checksum) {
     if (!config_.verify_checksum || expected_checksum.empty()) {
@@ -242,27 +757,18 @@ bool ModelDownloader::verifyChecksum(const std::string& file_path,
 }
 
 std::string ModelDownloader::calculateSHA256(const std::string& file_path) {
-    // Simple implementation using system sha256sum command
-    std::string cmd = "sha256sum \"" + file_path + "\" | cut -d' ' -f1";
-    
-    FILE* pipe = popen(cmd.c_str(), "r");
-    if (!pipe) {
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
         return "";
     }
     
-    char buffer[128];
-    std::string result;
-    while (!feof(pipe)) {
-        if (fgets(buffer, 128, pipe) != nullptr) {
-            result += buffer;
+    Sha256 sha256;
+    std::vector<char> buffer(1 << 20);
+    while (file) {
+        file.read(buffer.data(), buffer.size());
+        if (file.gcount() > 0) {
+            sha256.update(buffer.data(), static_cast<size_t>(file.gcount()));
         }
     }
-    pclose(pipe);
-    
-    // Remove newline
-    if (!result.empty() && result.back() == '\n') {
-        result.pop_back();
-    }
-    
-    return result;
-}
\ No newline at end of file
+    return sha256.hexDigest();
+}
@@ -0,0 +1,270 @@
+#include "multi_stream_vad.hpp"
+#include "ort_runtime.hpp"
+#include "metrics.hpp"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+
+MultiStreamVAD::MultiStreamVAD(const Config& config)
+    : config_(config), memory_info_(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)) {
+}
+
+MultiStreamVAD::~MultiStreamVAD() {
+    session_.reset();
+}
+
+bool MultiStreamVAD::initialize() {
+    config_.max_streams = std::max<size_t>(config_.max_streams, 1);
+    config_.max_batch = std::max<size_t>(config_.max_batch, 1);
+
+    if (!initializeSession()) {
+        return false;
+    }
+
+    const size_t row = static_cast<size_t>(config_.context_size + config_.window_size);
+    streams_.assign(config_.max_streams, Stream());
+    states_.assign(2 * config_.max_streams * kStateSize, 0.0f);
+    contexts_.assign(config_.max_streams * config_.context_size, 0.0f);
+
+    batch_input_.resize(config_.max_batch * row);
+    batch_state_in_.resize(2 * config_.max_batch * kStateSize);
+    batch_state_out_.resize(2 * config_.max_batch * kStateSize);
+    batch_prob_.resize(config_.max_batch);
+    batch_slots_.resize(config_.max_batch);
+    batch_generations_.resize(config_.max_batch);
+    batch_windows_.resize(config_.max_batch);
+    sample_rate_value_ = config_.sample_rate;
+    return true;
+}
+
+bool MultiStreamVAD::initializeSession() {
+    try {
+        OrtRuntime& runtime = OrtRuntime::instance();
+        Ort::SessionOptions session_options;
+        runtime.configureSession(session_options);
+        if (!runtime.hasGlobalThreadPool()) {
+            session_options.SetIntraOpNumThreads(1);
+        }
+        session_ = runtime.createSession(config_.model_path, session_options,
+                                         GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+
+        Ort::AllocatorWithDefaultOptions allocator;
+        for (size_t i = 0; i < session_->GetInputCount(); i++) {
+            input_names_str_.push_back(session_->GetInputNameAllocated(i, allocator).get());
+        }
+        for (size_t i = 0; i < session_->GetOutputCount(); i++) {
+            output_names_str_.push_back(session_->GetOutputNameAllocated(i, allocator).get());
+        }
+        for (const auto& name : input_names_str_) {
+            input_names_.push_back(name.c_str());
+        }
+        for (const auto& name : output_names_str_) {
+            output_names_.push_back(name.c_str());
+        }
+
+        // Batching relies on the v5 layout: (input, state, sr) -> (output, stateN)
+        if (input_names_.size() != 3 || output_names_.size() < 2) {
+            std::cerr << "Unsupported Silero VAD model layout for batched inference" << std::endl;
+            return false;
+        }
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to initialize multi-stream VAD session: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int MultiStreamVAD::addStream() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t slot = 0; slot < streams_.size(); ++slot) {
+        if (!streams_[slot].active) {
+            clearSlot(static_cast<int>(slot));
+            streams_[slot].active = true;
+            return static_cast<int>(slot);
+        }
+    }
+    return -1;
+}
+
+void MultiStreamVAD::removeStream(int stream_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stream_id >= 0 && static_cast<size_t>(stream_id) < streams_.size()) {
+        clearSlot(stream_id);
+        streams_[stream_id].active = false;
+        streams_[stream_id].pending.shrink_to_fit();
+    }
+}
+
+void MultiStreamVAD::resetStream(int stream_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stream_id >= 0 && static_cast<size_t>(stream_id) < streams_.size() && streams_[stream_id].active) {
+        clearSlot(stream_id);
+    }
+}
+
+void MultiStreamVAD::clearSlot(int slot) {
+    Stream& stream = streams_[slot];
+    stream.generation++;
+    stream.pending.clear();
+    stream.pending_offset = 0;
+    stream.windows_processed = 0;
+    stream.last_probability = 0.0f;
+
+    for (size_t k = 0; k < 2; ++k) {
+        float* state = states_.data() + (k * config_.max_streams + slot) * kStateSize;
+        std::fill(state, state + kStateSize, 0.0f);
+    }
+    float* context = contexts_.data() + static_cast<size_t>(slot) * config_.context_size;
+    std::fill(context, context + config_.context_size, 0.0f);
+}
+
+void MultiStreamVAD::pushAudio(int stream_id, const float* samples, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stream_id < 0 || static_cast<size_t>(stream_id) >= streams_.size() || !streams_[stream_id].active) {
+        return;
+    }
+
+    Stream& stream = streams_[stream_id];
+    // Compact once the consumed prefix dominates, so the buffer stays about one window long
+    if (stream.pending_offset > 0 && stream.pending_offset >= stream.pending.size() / 2) {
+        stream.pending.erase(stream.pending.begin(), stream.pending.begin() + stream.pending_offset);
+        stream.pending_offset = 0;
+    }
+    stream.pending.insert(stream.pending.end(), samples, samples + length);
+}
+
+size_t MultiStreamVAD::gatherBatch() {
+    const size_t window = static_cast<size_t>(config_.window_size);
+    const size_t context = static_cast<size_t>(config_.context_size);
+    const size_t row = context + window;
+    size_t batch = 0;
+
+    for (size_t slot = 0; slot < streams_.size() && batch < config_.max_batch; ++slot) {
+        Stream& stream = streams_[slot];
+        if (!stream.active || stream.pending.size() - stream.pending_offset < window) {
+            continue;
+        }
+
+        // Row = [context | window]; the row's tail is the next context
+        float* input = batch_input_.data() + batch * row;
+        float* stream_context = contexts_.data() + slot * context;
+        const float* samples = stream.pending.data() + stream.pending_offset;
+        std::copy(stream_context, stream_context + context, input);
+        std::copy(samples, samples + window, input + context);
+        std::copy(input + row - context, input + row, stream_context);
+        stream.pending_offset += window;
+
+        batch_slots_[batch] = static_cast<int>(slot);
+        batch_generations_[batch] = stream.generation;
+        batch_windows_[batch] = stream.windows_processed++;
+        batch++;
+    }
+
+    // State [2, B, 128] gathered from the per-slot state array
+    for (size_t k = 0; k < 2; ++k) {
+        for (size_t b = 0; b < batch; ++b) {
+            const float* src = states_.data() + (k * config_.max_streams + batch_slots_[b]) * kStateSize;
+            std::copy(src, src + kStateSize, batch_state_in_.data() + (k * batch + b) * kStateSize);
+        }
+    }
+    return batch;
+}
+
+void MultiStreamVAD::scatterBatch(size_t batch) {
+    for (size_t b = 0; b < batch; ++b) {
+        Stream& stream = streams_[batch_slots_[b]];
+        if (stream.generation != batch_generations_[b]) {
+            batch_slots_[b] = -1;  // reset or removed while the batch was running
+            continue;
+        }
+        for (size_t k = 0; k < 2; ++k) {
+            const float* src = batch_state_out_.data() + (k * batch + b) * kStateSize;
+            std::copy(src, src + kStateSize, states_.data() + (k * config_.max_streams + batch_slots_[b]) * kStateSize);
+        }
+        stream.last_probability = batch_prob_[b];
+    }
+}
+
+size_t MultiStreamVAD::process() {
+    if (!session_) {
+        return 0;
+    }
+
+    const size_t row = static_cast<size_t>(config_.context_size + config_.window_size);
+    size_t total = 0;
+
+    while (true) {
+        size_t batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batch = gatherBatch();
+        }
+        if (batch == 0) {
+            break;
+        }
+
+        try {
+            const int64_t input_shape[] = {static_cast<int64_t>(batch), static_cast<int64_t>(row)};
+            const int64_t state_shape[] = {2, static_cast<int64_t>(batch), static_cast<int64_t>(kStateSize)};
+            const int64_t sr_shape[] = {1};
+            const int64_t prob_shape[] = {static_cast<int64_t>(batch), 1};
+
+            Ort::Value inputs[3] = {
+                Ort::Value::CreateTensor<float>(memory_info_, batch_input_.data(), batch * row, input_shape, 2),
+                Ort::Value::CreateTensor<float>(memory_info_, batch_state_in_.data(), 2 * batch * kStateSize,
+                                                state_shape, 3),
+                Ort::Value::CreateTensor<int64_t>(memory_info_, &sample_rate_value_, 1, sr_shape, 1),
+            };
+            Ort::Value outputs[2] = {
+                Ort::Value::CreateTensor<float>(memory_info_, batch_prob_.data(), batch, prob_shape, 2),
+                Ort::Value::CreateTensor<float>(memory_info_, batch_state_out_.data(), 2 * batch * kStateSize,
+                                                state_shape, 3),
+            };
+
+            // Every window in the batch waits for the whole run
+            auto run_start = std::chrono::steady_clock::now();
+            session_->Run(Ort::RunOptions{nullptr}, input_names_.data(), inputs, 3,
+                          output_names_.data(), outputs, 2);
+            Metrics::instance().record(Metrics::Stage::VADWindow,
+                                       std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count(),
+                                       batch);
+
+        } catch (const std::exception& e) {
+            std::cerr << "Multi-stream VAD inference error: " << e.what() << std::endl;
+            std::fill(batch_prob_.begin(), batch_prob_.begin() + batch, 0.0f);
+            std::copy(batch_state_in_.begin(), batch_state_in_.begin() + 2 * batch * kStateSize,
+                      batch_state_out_.begin());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            scatterBatch(batch);
+        }
+
+        if (result_callback_) {
+            for (size_t b = 0; b < batch; ++b) {
+                if (batch_slots_[b] < 0) {
+                    continue;
+                }
+                result_callback_(batch_slots_[b], batch_prob_[b], batch_windows_[b]);
+            }
+        }
+        total += batch;
+    }
+
+    return total;
+}
+
+float MultiStreamVAD::getLastProbability(int stream_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stream_id < 0 || static_cast<size_t>(stream_id) >= streams_.size()) {
+        return 0.0f;
+    }
+    return streams_[stream_id].last_probability;
+}
+
+size_t MultiStreamVAD::numStreams() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::count_if(streams_.begin(), streams_.end(), [](const Stream& s) { return s.active; });
+}
@@ -0,0 +1,311 @@
+#include "offline_transcriber.hpp"
+#include "asr_model.hpp"
+#include "vad_detector.hpp"
+#include "resampler.hpp"
+#include <sndfile.h>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+constexpr int kSampleRate = 16000;
+constexpr size_t kVADWindow = 512;  // 32ms at 16kHz
+
+std::string formatTime(double seconds) {
+    long long ms = static_cast<long long>(seconds * 1000.0 + 0.5);
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%02lld:%02lld:%02lld.%03lld",
+                  ms / 3600000, (ms / 60000) % 60, (ms / 1000) % 60, ms % 1000);
+    return buffer;
+}
+
+}  // namespace
+
+OfflineTranscriber::OfflineTranscriber(ASRModel& model, const Config& config)
+    : model_(model), config_(config) {
+}
+
+OfflineTranscriber::~OfflineTranscriber() = default;
+
+bool OfflineTranscriber::initialize() {
+    if (config_.vad_model_path.empty()) {
+        std::cout << "No VAD model, splitting audio into "
+                  << config_.max_segment_seconds << "s chunks" << std::endl;
+        return true;
+    }
+
+    VADDetector::Config vad_config;
+    vad_config.model_path = config_.vad_model_path;
+    vad_config.sample_rate = kSampleRate;
+    vad_config.window_size = static_cast<int>(kVADWindow);
+    vad_config.context_size = 64;
+    vad_config.history_size = 1;  // segmentation applies its own hysteresis
+
+    vad_ = std::make_unique<VADDetector>(vad_config);
+    if (!vad_->initialize()) {
+        std::cerr << "Failed to initialize VAD for offline segmentation" << std::endl;
+        vad_.reset();
+        return false;
+    }
+    return true;
+}
+
+bool OfflineTranscriber::readAudio(const std::string& path, std::vector<float>& audio, int& sample_rate) {
+    SF_INFO info = {};
+    SNDFILE* file = sf_open(path.c_str(), SFM_READ, &info);
+    if (!file) {
+        std::cerr << "Cannot open audio file " << path << ": " << sf_strerror(nullptr) << std::endl;
+        return false;
+    }
+
+    const size_t channels = static_cast<size_t>(std::max(1, info.channels));
+    sample_rate = info.samplerate;
+    audio.assign(static_cast<size_t>(std::max<sf_count_t>(info.frames, 0)), 0.0f);
+
+    // Read in blocks and average channels down to mono as they arrive
+    const sf_count_t block_frames = 65536;
+    std::vector<float> block(static_cast<size_t>(block_frames) * channels);
+    size_t written = 0;
+    sf_count_t read;
+    while ((read = sf_readf_float(file, block.data(), block_frames)) > 0) {
+        size_t frames = static_cast<size_t>(read);
+        if (written + frames > audio.size()) {
+            audio.resize(written + frames);
+        }
+        if (channels == 1) {
+            std::copy(block.begin(), block.begin() + frames, audio.begin() + written);
+        } else {
+            const float scale = 1.0f / channels;
+            for (size_t i = 0; i < frames; ++i) {
+                const float* frame = block.data() + i * channels;
+                audio[written + i] = std::accumulate(frame, frame + channels, 0.0f) * scale;
+            }
+        }
+        written += frames;
+    }
+    audio.resize(written);
+    sf_close(file);
+    return true;
+}
+
+std::vector<std::string> OfflineTranscriber::expandInputs(const std::string& input) {
+    auto ends_with = [&input](const std::string& suffix) {
+        return input.size() >= suffix.size() &&
+               input.compare(input.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    if (!ends_with(".txt") && !ends_with(".lst") && !ends_with(".scp")) {
+        return {input};
+    }
+
+    std::vector<std::string> paths;
+    std::ifstream list(input);
+    if (!list.is_open()) {
+        std::cerr << "Cannot open input list: " << input << std::endl;
+        return paths;
+    }
+
+    std::string line;
+    while (std::getline(list, line)) {
+        line.erase(0, line.find_first_not_of(" \t\r"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (!line.empty() && line[0] != '#') {
+            paths.push_back(line);
+        }
+    }
+    return paths;
+}
+
+std::vector<OfflineTranscriber::SampleRange> OfflineTranscriber::fixedChunks(size_t num_samples) const {
+    std::vector<SampleRange> ranges;
+    const size_t chunk = static_cast<size_t>(std::max(1.0, config_.max_segment_seconds * kSampleRate));
+    for (size_t begin = 0; begin < num_samples; begin += chunk) {
+        ranges.emplace_back(begin, std::min(num_samples, begin + chunk));
+    }
+    return ranges;
+}
+
+std::vector<OfflineTranscriber::SampleRange> OfflineTranscriber::segmentAudio(const std::vector<float>& audio) {
+    if (!vad_) {
+        return fixedChunks(audio.size());
+    }
+
+    const size_t min_silence = static_cast<size_t>(config_.min_silence_seconds * kSampleRate);
+    const size_t min_speech = static_cast<size_t>(config_.min_speech_seconds * kSampleRate);
+    const size_t max_segment = static_cast<size_t>(std::max(1.0, config_.max_segment_seconds * kSampleRate));
+    const size_t pad = static_cast<size_t>(config_.speech_pad_seconds * kSampleRate);
+
+    std::vector<SampleRange> raw;
+    bool triggered = false;
+    size_t start = 0;
+    size_t silence_start = 0;  // 0: no silence run in progress
+
+    vad_->reset();
+    for (size_t pos = 0; pos < audio.size(); pos += kVADWindow) {
+        size_t length = std::min(kVADWindow, audio.size() - pos);
+        float prob = vad_->detectVAD(audio.data() + pos, length);
+        size_t window_end = pos + length;
+
+        if (!triggered) {
+            if (prob >= config_.trigger_threshold) {
+                triggered = true;
+                start = pos;
+                silence_start = 0;
+            }
+            continue;
+        }
+
+        if (prob >= config_.trigger_threshold) {
+            silence_start = 0;
+        } else if (prob < config_.stop_threshold && silence_start == 0) {
+            silence_start = pos;
+        }
+
+        if (silence_start != 0 && window_end - silence_start >= min_silence) {
+            if (silence_start - start >= min_speech) {
+                raw.emplace_back(start, silence_start);
+            }
+            triggered = false;
+        } else if (window_end - start >= max_segment) {
+            // Cut at the start of the current silence run if there is one, else here
+            size_t cut = silence_start != 0 ? silence_start : window_end;
+            raw.emplace_back(start, cut);
+            start = cut;
+        }
+    }
+    if (triggered && audio.size() - start >= min_speech) {
+        raw.emplace_back(start, audio.size());
+    }
+
+    // Pad both sides; where padding would overlap a neighbour, split the gap between them
+    std::vector<SampleRange> ranges(raw.size());
+    for (size_t i = 0; i < raw.size(); ++i) {
+        size_t lower = i == 0 ? 0 : (raw[i - 1].second + raw[i].first) / 2;
+        size_t upper = i + 1 == raw.size() ? audio.size() : (raw[i].second + raw[i + 1].first) / 2;
+        size_t begin = raw[i].first > pad ? raw[i].first - pad : 0;
+        ranges[i] = {std::max(begin, lower), std::min(raw[i].second + pad, upper)};
+    }
+    return ranges;
+}
+
+void OfflineTranscriber::decodeSegments(const std::vector<float>& audio, const std::vector<SampleRange>& ranges,
+                                        std::vector<ASRModel::Result>& results) {
+    results.assign(ranges.size(), ASRModel::Result());
+    if (ranges.empty()) {
+        return;
+    }
+
+    // Longest first, then cut into batches under the padded frame budget; similar lengths
+    // end up together, and the expensive batches are claimed before the cheap ones
+    std::vector<size_t> order(ranges.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&ranges](size_t a, size_t b) {
+        return ranges[a].second - ranges[a].first > ranges[b].second - ranges[b].first;
+    });
+
+    std::vector<std::vector<size_t>> batches;
+    size_t batch_frames = 0;
+    for (size_t index : order) {
+        size_t frames = std::max<size_t>(1, model_.getFeatureFrames(ranges[index].second - ranges[index].first));
+        if (batches.empty() || (batches.back().size() + 1) * batch_frames > config_.max_padded_frames) {
+            batches.emplace_back();
+            batch_frames = frames;  // sorted descending: the first clip sets T_max
+        }
+        batches.back().push_back(index);
+    }
+
+    int num_threads = config_.num_threads > 0 ? config_.num_threads : model_.getNumSessions();
+    num_threads = std::max(1, std::min<int>(num_threads, static_cast<int>(batches.size())));
+
+    std::atomic<size_t> next_batch{0};
+    auto worker = [&]() {
+        std::vector<std::vector<float>> clips;
+        for (size_t b = next_batch++; b < batches.size(); b = next_batch++) {
+            const std::vector<size_t>& batch = batches[b];
+            clips.clear();
+            for (size_t index : batch) {
+                clips.emplace_back(audio.begin() + ranges[index].first, audio.begin() + ranges[index].second);
+            }
+            std::vector<ASRModel::Result> batch_results = model_.recognizeBatchDetailed(clips);
+            for (size_t i = 0; i < batch.size() && i < batch_results.size(); ++i) {
+                results[batch[i]] = std::move(batch_results[i]);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+std::vector<OfflineTranscriber::Segment> OfflineTranscriber::transcribe(const std::vector<float>& audio) {
+    std::vector<SampleRange> ranges = segmentAudio(audio);
+    std::vector<ASRModel::Result> results;
+    decodeSegments(audio, ranges, results);
+
+    std::vector<Segment> segments;
+    segments.reserve(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (results[i].text.empty()) {
+            continue;
+        }
+        Segment segment;
+        segment.start = static_cast<double>(ranges[i].first) / kSampleRate;
+        segment.end = static_cast<double>(ranges[i].second) / kSampleRate;
+        segment.text = std::move(results[i].text);
+        segment.tokens = std::move(results[i].tokens);
+        for (auto& token : segment.tokens) {
+            token.start += segment.start;
+            token.end += segment.start;
+        }
+        segments.push_back(std::move(segment));
+    }
+    return segments;
+}
+
+bool OfflineTranscriber::transcribeFile(const std::string& path, std::vector<Segment>& segments) {
+    std::vector<float> audio;
+    int sample_rate = 0;
+    if (!readAudio(path, audio, sample_rate)) {
+        return false;
+    }
+    if (sample_rate != kSampleRate) {
+        audio = Resampler::resample(audio, sample_rate, kSampleRate);
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    segments = transcribe(audio);
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    double processing = std::chrono::duration<double>(end_time - start_time).count();
+    double duration = static_cast<double>(audio.size()) / kSampleRate;
+    std::cerr << path << ": " << segments.size() << " segments, " << duration << "s audio in "
+              << processing << "s (RTF " << (duration > 0.0 ? processing / duration : 0.0) << ")" << std::endl;
+    return true;
+}
+
+void OfflineTranscriber::writeSegments(std::ostream& out, const std::string& path, const std::vector<Segment>& segments) {
+    out << "# " << path << "\n";
+    for (const auto& segment : segments) {
+        out << "[" << formatTime(segment.start) << " --> " << formatTime(segment.end) << "] "
+            << segment.text << "\n";
+        for (const auto& token : segment.tokens) {
+            char confidence[16];
+            std::snprintf(confidence, sizeof(confidence), "%.2f", token.confidence);
+            out << "    [" << formatTime(token.start) << " --> " << formatTime(token.end) << "] "
+                << token.text << " (" << confidence << ")\n";
+        }
+    }
+    out.flush();
+}
@@ -0,0 +1,122 @@
+#include "online_feature_extractor.hpp"
+#include <iostream>
+#include <algorithm>
+
+OnlineFeatureExtractor::OnlineFeatureExtractor(const AudioProcessor::Config& config)
+    : config_(config) {
+}
+
+OnlineFeatureExtractor::~OnlineFeatureExtractor() {
+}
+
+bool OnlineFeatureExtractor::initialize() {
+    // Own processor, so its scratch buffers are never shared with the offline path
+    processor_ = std::make_unique<AudioProcessor>(config_);
+    if (!processor_->initialize()) {
+        std::cerr << "Failed to initialize streaming audio processor" << std::endl;
+        return false;
+    }
+
+    feature_dim_ = processor_->getFeatureDim();
+    reset();
+    return true;
+}
+
+void OnlineFeatureExtractor::reset() {
+    last_sample_ = 0.0f;
+    has_last_sample_ = false;
+    pending_samples_.clear();
+    fbank_.clear();
+    fbank_offset_ = 0;
+    num_fbank_frames_ = 0;
+    features_.clear();
+    num_lfr_frames_ = 0;
+    input_finished_ = false;
+}
+
+void OnlineFeatureExtractor::acceptWaveform(const float* samples, size_t length) {
+    if (!processor_ || input_finished_ || length == 0) {
+        return;
+    }
+
+    // Pre-emphasis continues from the last sample of the previous chunk
+    size_t old_size = pending_samples_.size();
+    pending_samples_.resize(old_size + length);
+    float* out = pending_samples_.data() + old_size;
+    const float coeff = config_.preemphasis;
+
+    if (coeff > 0.0f) {
+        out[0] = has_last_sample_ ? samples[0] - coeff * last_sample_ : samples[0];
+        for (size_t i = 1; i < length; ++i) {
+            out[i] = samples[i] - coeff * samples[i - 1];
+        }
+    } else {
+        std::copy(samples, samples + length, out);
+    }
+    last_sample_ = samples[length - 1];
+    has_last_sample_ = true;
+
+    // Fbank over every complete frame; the overlap tail stays pending
+    size_t new_frames = processor_->getNumFbankFrames(pending_samples_.size());
+    if (new_frames > 0) {
+        size_t old_fbank = fbank_.size();
+        fbank_.resize(old_fbank + new_frames * config_.n_mels);
+        processor_->computeFbankInto(pending_samples_.data(), pending_samples_.size(), fbank_.data() + old_fbank);
+        num_fbank_frames_ += new_frames;
+
+        size_t consumed = new_frames * config_.frame_shift;
+        pending_samples_.erase(pending_samples_.begin(), pending_samples_.begin() + consumed);
+    }
+
+    // Emit every LFR frame whose lfr_m fbank frames are all available
+    while (num_lfr_frames_ * config_.lfr_n + config_.lfr_m <= num_fbank_frames_) {
+        size_t start = num_lfr_frames_ * config_.lfr_n;
+        emitFrame(num_lfr_frames_, start + config_.lfr_m - 1);
+    }
+
+    trimFbank();
+}
+
+void OnlineFeatureExtractor::inputFinished() {
+    if (!processor_ || input_finished_) {
+        return;
+    }
+
+    // Remaining LFR frames are padded with the last fbank frame
+    while (num_lfr_frames_ * config_.lfr_n < num_fbank_frames_) {
+        emitFrame(num_lfr_frames_, num_fbank_frames_ - 1);
+    }
+
+    trimFbank();
+    input_finished_ = true;
+}
+
+void OnlineFeatureExtractor::emitFrame(size_t lfr_index, size_t last_fbank_frame) {
+    const size_t dim = config_.n_mels;
+    size_t old_size = features_.size();
+    features_.resize(old_size + feature_dim_);
+    float* row = features_.data() + old_size;
+
+    for (int j = 0; j < config_.lfr_m; ++j) {
+        size_t frame_idx = std::min(lfr_index * config_.lfr_n + j, last_fbank_frame);
+        const float* fbank_row = fbank_.data() + (frame_idx - fbank_offset_) * dim;
+        std::copy(fbank_row, fbank_row + dim, row + j * dim);
+    }
+
+    processor_->applyCMVNInto(row, 1);
+    num_lfr_frames_++;
+
+    if (frame_callback_) {
+        frame_callback_(row, feature_dim_);
+    }
+}
+
+void OnlineFeatureExtractor::trimFbank() {
+    // The next LFR frame starts at num_lfr_frames_ * lfr_n; nothing before it is needed
+    size_t needed_from = std::min(num_lfr_frames_ * config_.lfr_n, num_fbank_frames_);
+    if (needed_from > fbank_offset_) {
+        size_t drop = needed_from - fbank_offset_;
+        fbank_.erase(fbank_.begin(), fbank_.begin() + drop * config_.n_mels);
+        fbank_offset_ = needed_from;
+    }
+}
@@ -0,0 +1,458 @@
+#include "ort_runtime.hpp"
+#include "mapped_file.hpp"
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <sstream>
+#include <cstring>
+#include <unistd.h>
+#ifdef ASR_ENABLE_SPACEMIT
+#include <spacemit_ort_env.h>
+#endif
+
+namespace {
+
+std::mutex& runtimeMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::unique_ptr<OrtRuntime>& runtimeSlot() {
+    static std::unique_ptr<OrtRuntime> runtime;
+    return runtime;
+}
+
+std::string& modelCacheDir() {
+    static std::string dir;
+    return dir;
+}
+
+bool& modelMapping() {
+    static bool enabled = false;
+    return enabled;
+}
+
+// ORT-format models are flatbuffers with the file identifier "ORTM"
+bool isOrtFormat(const MappedFile& file) {
+    return file.size() >= 8 && std::memcmp(file.data() + 4, "ORTM", 4) == 0;
+}
+
+// Names ORT reports from GetAvailableProviders()
+const char* ortProviderName(OrtRuntime::Provider provider) {
+    switch (provider) {
+        case OrtRuntime::Provider::XNNPACK: return "XnnpackExecutionProvider";
+        case OrtRuntime::Provider::CUDA: return "CUDAExecutionProvider";
+        case OrtRuntime::Provider::TensorRT: return "TensorrtExecutionProvider";
+        case OrtRuntime::Provider::SpacemiT: return "SpaceMITExecutionProvider";
+        default: return "CPUExecutionProvider";
+    }
+}
+
+}  // namespace
+
+OrtRuntime& OrtRuntime::instance(const Config& config) {
+    std::lock_guard<std::mutex> lock(runtimeMutex());
+    auto& runtime = runtimeSlot();
+    if (!runtime) {
+        runtime.reset(new OrtRuntime(config));
+    } else if (runtime->config_.use_global_thread_pool != config.use_global_thread_pool ||
+               (config.use_global_thread_pool && runtime->config_.intra_op_threads != config.intra_op_threads)) {
+        std::cerr << "Warning: ONNX Runtime already initialized with a different thread pool setup" << std::endl;
+    } else if (config.share_allocator && (runtime->config_.arena_extend != config.arena_extend ||
+                                          runtime->config_.arena_max_bytes != config.arena_max_bytes)) {
+        std::cerr << "Warning: ONNX Runtime already initialized with a different arena setup" << std::endl;
+    }
+    return *runtime;
+}
+
+OrtRuntime& OrtRuntime::instance() {
+    {
+        std::lock_guard<std::mutex> lock(runtimeMutex());
+        if (runtimeSlot()) {
+            return *runtimeSlot();
+        }
+    }
+    return instance(Config());
+}
+
+OrtRuntime::~OrtRuntime() = default;
+
+OrtRuntime::OrtRuntime(const Config& config) : config_(config) {
+    if (config_.use_global_thread_pool) {
+        Ort::ThreadingOptions threading_options;
+        threading_options.SetGlobalIntraOpNumThreads(std::max(1, config_.intra_op_threads));
+        threading_options.SetGlobalInterOpNumThreads(std::max(1, config_.inter_op_threads));
+        threading_options.SetGlobalSpinControl(config_.allow_spinning ? 1 : 0);
+        if (!config_.intra_op_affinity.empty()) {
+            Ort::ThrowOnError(Ort::GetApi().SetGlobalIntraOpThreadAffinity(
+                threading_options, config_.intra_op_affinity.c_str()));
+        }
+        env_ = std::make_unique<Ort::Env>(threading_options, config_.log_level, "SenseVoice");
+    } else {
+        env_ = std::make_unique<Ort::Env>(config_.log_level, "SenseVoice");
+    }
+
+    if (config_.share_allocator) {
+        // -1 keeps ORT's defaults for the initial chunk and dead-bytes-per-chunk limits
+        auto memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+        Ort::ArenaCfg arena_cfg(config_.arena_max_bytes, static_cast<int>(config_.arena_extend), -1, -1);
+        env_->CreateAndRegisterAllocator(memory_info, arena_cfg);
+    }
+
+    if (config_.share_prepacked_weights) {
+        prepacked_weights_ = std::make_unique<Ort::PrepackedWeightsContainer>();
+    }
+}
+
+void OrtRuntime::configureSession(Ort::SessionOptions& options) const {
+    if (config_.use_global_thread_pool) {
+        options.DisablePerSessionThreads();
+    }
+    if (config_.share_allocator) {
+        options.AddConfigEntry("session.use_env_allocators", "1");
+    }
+}
+
+std::unique_ptr<Ort::Session> OrtRuntime::createSession(const std::string& model_path,
+                                                        Ort::SessionOptions& options,
+                                                        GraphOptimizationLevel optimization_level) {
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    return createCachedSession(model_path, options, optimization_level, Provider::CPU);
+}
+
+std::unique_ptr<Ort::Session> OrtRuntime::createSession(const std::string& model_path,
+                                                        Ort::SessionOptions& options,
+                                                        GraphOptimizationLevel optimization_level,
+                                                        const std::vector<Provider>& providers,
+                                                        const ProviderOptions& provider_options,
+                                                        Provider* selected) {
+    std::vector<Provider> order = providers;
+    if (std::find(order.begin(), order.end(), Provider::CPU) == order.end()) {
+        order.push_back(Provider::CPU);
+    }
+    
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    for (Provider provider : order) {
+        if (provider == Provider::CPU) {
+            if (selected) {
+                *selected = provider;
+            }
+            return createCachedSession(model_path, options, optimization_level, provider);
+        }
+        if (!isProviderAvailable(provider)) {
+            continue;
+        }
+        
+        Ort::SessionOptions provider_session_options = options.Clone();
+        try {
+            if (!appendProvider(provider_session_options, provider, provider_options)) {
+                continue;
+            }
+            auto session = createCachedSession(model_path, provider_session_options, optimization_level, provider);
+            if (selected) {
+                *selected = provider;
+            }
+            return session;
+        } catch (const Ort::Exception& e) {
+            // Missing driver or libraries, unsupported device, or a graph the EP refuses
+            std::cerr << "Execution provider " << providerName(provider) << " unavailable for " << model_path
+                      << ": " << e.what() << std::endl;
+        }
+    }
+    return nullptr;
+}
+
+std::unique_ptr<Ort::Session> OrtRuntime::createCachedSession(const std::string& model_path,
+                                                              Ort::SessionOptions& options,
+                                                              GraphOptimizationLevel optimization_level,
+                                                              Provider provider) {
+    const std::string cached_path = optimizedModelPath(model_path, optimization_level, provider);
+    if (cached_path.empty()) {
+        options.SetGraphOptimizationLevel(optimization_level);
+        return openSession(model_path, options);
+    }
+    
+    std::error_code ec;
+    if (std::filesystem::exists(cached_path, ec)) {
+        Ort::SessionOptions cached_options = options.Clone();
+        cached_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_DISABLE_ALL);
+        try {
+            return openSession(cached_path, cached_options);
+        } catch (const Ort::Exception& e) {
+            // Written by another ORT build or truncated; rebuild it from the source model
+            std::cerr << "Discarding optimized model cache " << cached_path << ": " << e.what() << std::endl;
+            std::filesystem::remove(cached_path, ec);
+            retireMapping(cached_path);
+        }
+    }
+    
+    // Optimize from source and save the result aside, renamed into place once complete
+    std::filesystem::create_directories(std::filesystem::path(cached_path).parent_path(), ec);
+    const std::string temp_path = cached_path + "." + std::to_string(getpid()) + ".tmp";
+    options.SetGraphOptimizationLevel(optimization_level);
+    Ort::SessionOptions save_options = options.Clone();
+    save_options.SetOptimizedModelFilePath(temp_path.c_str());
+    save_options.AddConfigEntry("session.save_model_format", "ORT");
+    std::unique_ptr<Ort::Session> session;
+    try {
+        session = openSession(model_path, save_options);
+    } catch (const Ort::Exception& e) {
+        // Some graphs cannot be serialized in ORT format; run them uncached
+        std::cerr << "Cannot cache optimized model for " << model_path << ": " << e.what() << std::endl;
+        std::filesystem::remove(temp_path, ec);
+        return openSession(model_path, options);
+    }
+    
+    std::filesystem::rename(temp_path, cached_path, ec);
+    if (ec) {
+        std::filesystem::remove(temp_path, ec);
+    } else {
+        std::cout << "Saved optimized model to " << cached_path << std::endl;
+    }
+    return session;
+}
+
+std::unique_ptr<Ort::Session> OrtRuntime::openSession(const std::string& model_path,
+                                                      const Ort::SessionOptions& options) {
+    bool mapping_enabled = false;
+    {
+        std::lock_guard<std::mutex> lock(runtimeMutex());
+        mapping_enabled = modelMapping();
+    }
+    const MappedFile* mapping = mapping_enabled ? mapModel(model_path) : nullptr;
+    if (!mapping) {
+        if (prepacked_weights_) {
+            return std::make_unique<Ort::Session>(*env_, model_path.c_str(), options, *prepacked_weights_);
+        }
+        return std::make_unique<Ort::Session>(*env_, model_path.c_str(), options);
+    }
+    
+    // An ORT-format graph and its initializers can point straight into the mapping
+    Ort::SessionOptions mapped_options = options.Clone();
+    if (isOrtFormat(*mapping)) {
+        mapped_options.AddConfigEntry("session.use_ort_model_bytes_directly", "1");
+        mapped_options.AddConfigEntry("session.use_ort_model_bytes_for_initializers", "1");
+    }
+    if (prepacked_weights_) {
+        return std::make_unique<Ort::Session>(*env_, mapping->data(), mapping->size(), mapped_options,
+                                              *prepacked_weights_);
+    }
+    return std::make_unique<Ort::Session>(*env_, mapping->data(), mapping->size(), mapped_options);
+}
+
+const MappedFile* OrtRuntime::mapModel(const std::string& model_path) {
+    auto it = mapped_models_.find(model_path);
+    if (it != mapped_models_.end()) {
+        return it->second.get();
+    }
+    
+    auto mapping = std::make_unique<MappedFile>();
+    if (!mapping->open(model_path)) {
+        std::cerr << "Cannot map " << model_path << ", loading it into memory instead" << std::endl;
+        return nullptr;
+    }
+    const MappedFile* result = mapping.get();
+    mapped_models_[model_path] = std::move(mapping);
+    return result;
+}
+
+void OrtRuntime::retireMapping(const std::string& model_path) {
+    auto it = mapped_models_.find(model_path);
+    if (it != mapped_models_.end()) {
+        retired_mappings_.push_back(std::move(it->second));
+        mapped_models_.erase(it);
+    }
+}
+
+void OrtRuntime::setModelCacheDir(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(runtimeMutex());
+    modelCacheDir() = dir;
+}
+
+void OrtRuntime::setModelMapping(bool enabled) {
+    std::lock_guard<std::mutex> lock(runtimeMutex());
+    modelMapping() = enabled;
+}
+
+std::string OrtRuntime::optimizedModelPath(const std::string& model_path,
+                                           GraphOptimizationLevel optimization_level,
+                                           Provider provider) {
+    std::string dir;
+    {
+        std::lock_guard<std::mutex> lock(runtimeMutex());
+        dir = modelCacheDir();
+    }
+    // GPU providers partition the graph at session creation; an ORT-format file saved with
+    // their nodes is not portable, and TensorRT keeps its own engine cache instead
+    if (dir.empty() || isGpuProvider(provider)) {
+        return "";
+    }
+    
+    // Keyed by the source file's identity, the optimization level, the provider and the ORT
+    // API version, so a new model, level, provider or runtime never picks up a stale graph
+    std::error_code ec;
+    std::filesystem::path source = std::filesystem::absolute(model_path, ec);
+    auto size = std::filesystem::file_size(source, ec);
+    if (ec) {
+        return "";
+    }
+    auto mtime = std::filesystem::last_write_time(source, ec);
+    if (ec) {
+        return "";
+    }
+    
+    std::ostringstream key;
+    key << source.string() << '|' << size << '|' << mtime.time_since_epoch().count() << '|'
+        << static_cast<int>(optimization_level) << '|' << providerName(provider) << '|' << ORT_API_VERSION;
+    std::ostringstream name;
+    name << source.stem().string() << '-' << std::hex << std::hash<std::string>{}(key.str()) << ".ort";
+    return (std::filesystem::path(dir) / name.str()).string();
+}
+
+bool OrtRuntime::appendProvider(Ort::SessionOptions& options, Provider provider,
+                                const ProviderOptions& provider_options) {
+    switch (provider) {
+        case Provider::CPU:
+            return true;
+        
+        case Provider::XNNPACK:
+            // XNNPACK brings its own pool; spinning ORT threads would only compete with it
+            options.AddConfigEntry("session.intra_op.allow_spinning", "0");
+            options.AppendExecutionProvider("XNNPACK", {
+                {"intra_op_num_threads", std::to_string(std::max(1, provider_options.xnnpack_threads))}});
+            return true;
+        
+        case Provider::TensorRT: {
+            static std::string engine_cache_dir;
+            OrtTensorRTProviderOptions trt_options{};
+            trt_options.device_id = provider_options.device_id;
+            trt_options.trt_max_partition_iterations = 1000;
+            trt_options.trt_min_subgraph_size = 1;
+            trt_options.trt_max_workspace_size = size_t(1) << 30;
+            trt_options.trt_fp16_enable = provider_options.fp16 ? 1 : 0;
+            trt_options.trt_int8_enable = provider_options.int8 ? 1 : 0;
+            {
+                std::lock_guard<std::mutex> lock(runtimeMutex());
+                if (!modelCacheDir().empty()) {
+                    // Engine builds take minutes; keep them next to the optimized models
+                    engine_cache_dir = (std::filesystem::path(modelCacheDir()) / "tensorrt").string();
+                    std::error_code ec;
+                    std::filesystem::create_directories(engine_cache_dir, ec);
+                    trt_options.trt_engine_cache_enable = 1;
+                    trt_options.trt_engine_cache_path = engine_cache_dir.c_str();
+                }
+            }
+            options.AppendExecutionProvider_TensorRT(trt_options);
+            
+            // Nodes TensorRT does not take run on CUDA rather than on the CPU
+            if (isProviderAvailable(Provider::CUDA)) {
+                OrtCUDAProviderOptions cuda_options;
+                cuda_options.device_id = provider_options.device_id;
+                options.AppendExecutionProvider_CUDA(cuda_options);
+            }
+            return true;
+        }
+        
+        case Provider::CUDA: {
+            OrtCUDAProviderOptions cuda_options;
+            cuda_options.device_id = provider_options.device_id;
+            options.AppendExecutionProvider_CUDA(cuda_options);
+            return true;
+        }
+        
+        case Provider::SpacemiT:
+#ifdef ASR_ENABLE_SPACEMIT
+            Ort::SessionOptionsSpaceMITEnvInit(options);
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+const char* OrtRuntime::providerName(Provider provider) {
+    switch (provider) {
+        case Provider::XNNPACK: return "xnnpack";
+        case Provider::CUDA: return "cuda";
+        case Provider::TensorRT: return "tensorrt";
+        case Provider::SpacemiT: return "spacemit";
+        default: return "cpu";
+    }
+}
+
+bool OrtRuntime::parseProvider(const std::string& name, Provider& provider) {
+    for (Provider candidate : {Provider::CPU, Provider::XNNPACK, Provider::CUDA, Provider::TensorRT, Provider::SpacemiT}) {
+        if (name == providerName(candidate)) {
+            provider = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool OrtRuntime::parseArenaExtend(const std::string& name, ArenaExtend& extend) {
+    if (name == "power_of_two") {
+        extend = ArenaExtend::PowerOfTwo;
+    } else if (name == "same_as_requested") {
+        extend = ArenaExtend::SameAsRequested;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::vector<OrtRuntime::Provider> OrtRuntime::parseProviders(const std::string& list) {
+    std::vector<Provider> providers;
+    std::stringstream stream(list);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        if (name == "auto") {
+            auto defaults = defaultProviders();
+            providers.insert(providers.end(), defaults.begin(), defaults.end());
+            continue;
+        }
+        Provider provider;
+        if (parseProvider(name, provider)) {
+            providers.push_back(provider);
+        } else if (!name.empty()) {
+            std::cerr << "Unknown execution provider: " << name << std::endl;
+        }
+    }
+    return providers;
+}
+
+bool OrtRuntime::isProviderAvailable(Provider provider) {
+    if (provider == Provider::CPU) {
+        return true;
+    }
+#ifndef ASR_ENABLE_SPACEMIT
+    if (provider == Provider::SpacemiT) {
+        return false;
+    }
+#endif
+    static const std::vector<std::string> available = Ort::GetAvailableProviders();
+    return std::find(available.begin(), available.end(), ortProviderName(provider)) != available.end();
+}
+
+std::vector<OrtRuntime::Provider> OrtRuntime::defaultProviders() {
+    // TensorRT is left to an explicit request: its first engine build takes minutes
+    std::vector<Provider> providers;
+    for (Provider provider : {Provider::CUDA, Provider::SpacemiT}) {
+        if (isProviderAvailable(provider)) {
+            providers.push_back(provider);
+        }
+    }
+    providers.push_back(Provider::CPU);
+    return providers;
+}
+
+OrtRuntime::Provider OrtRuntime::firstAvailableProvider(const std::vector<Provider>& providers) {
+    for (Provider provider : providers) {
+        if (isProviderAvailable(provider)) {
+            return provider;
+        }
+    }
+    return Provider::CPU;
+}
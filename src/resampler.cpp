@@ -0,0 +1,176 @@
+#include "resampler.hpp"
+#include "simd_utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace {
+
+// Zeroth-order modified Bessel function of the first kind (power series)
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    const double half_x_sq = 0.25 * x * x;
+    for (int k = 1; k < 64; ++k) {
+        term *= half_x_sq / (static_cast<double>(k) * k);
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+}  // namespace
+
+Resampler::Resampler(const Config& config) : config_(config) {
+    const int g = std::gcd(std::max(1, config_.input_rate), std::max(1, config_.output_rate));
+    up_ = std::max(1, config_.output_rate) / g;
+    down_ = std::max(1, config_.input_rate) / g;
+    if (!isPassthrough()) {
+        bank_ = getFilterBank(config_, up_, down_);
+    }
+    reset();
+}
+
+Resampler::Resampler(int input_rate, int output_rate)
+    : Resampler([&] {
+          Config config;
+          config.input_rate = input_rate;
+          config.output_rate = output_rate;
+          return config;
+      }()) {
+}
+
+std::shared_ptr<const Resampler::FilterBank> Resampler::getFilterBank(const Config& config, int up, int down) {
+    using Key = std::tuple<int, int, int, float, double>;
+    static std::mutex mutex;
+    static std::map<Key, std::shared_ptr<const FilterBank>> banks;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (banks.empty()) {
+        // Capture rates we see in practice, so the first stream of each does not pay the design
+        for (int rate : {48000, 44100, 8000}) {
+            const int g = std::gcd(rate, 16000);
+            Config common = config;
+            common.input_rate = rate;
+            common.output_rate = 16000;
+            banks[Key(16000 / g, rate / g, common.zero_crossings, common.cutoff, common.kaiser_beta)] =
+                designFilterBank(common, 16000 / g, rate / g);
+        }
+    }
+
+    auto& bank = banks[Key(up, down, config.zero_crossings, config.cutoff, config.kaiser_beta)];
+    if (!bank) {
+        bank = designFilterBank(config, up, down);
+    }
+    return bank;
+}
+
+std::shared_ptr<Resampler::FilterBank> Resampler::designFilterBank(const Config& config, int up, int down) {
+    auto bank = std::make_shared<FilterBank>();
+    bank->up = up;
+    bank->down = down;
+
+    // Low-pass at the upsampled rate, below the lower of the two Nyquist frequencies
+    const int wider = std::max(up, down);
+    const double fc = 0.5 * config.cutoff / wider;
+    bank->taps = static_cast<size_t>(std::ceil(2.0 * config.zero_crossings * wider / up));
+    const size_t length = bank->taps * up;
+    // Odd active length so the centre tap sits on the upsampled grid; the spare tap stays zero
+    const size_t active = length % 2 == 0 ? length - 1 : length;
+    bank->center = (active - 1) / 2;
+    const double center = static_cast<double>(bank->center);
+    const double i0_beta = besselI0(config.kaiser_beta);
+
+    std::vector<double> prototype(length, 0.0);
+    for (size_t n = 0; n < active; ++n) {
+        double t = static_cast<double>(n) - center;
+        double x = 2.0 * fc * t;
+        double sinc = std::abs(x) < 1e-12 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+        double r = center > 0.0 ? t / center : 0.0;
+        double window = besselI0(config.kaiser_beta * std::sqrt(std::max(0.0, 1.0 - r * r))) / i0_beta;
+        // Gain up: zero stuffing leaves 1/up of the energy in each phase
+        prototype[n] = up * 2.0 * fc * sinc * window;
+    }
+
+    // Phase p holds h[p + k*up]; stored reversed so it lines up with history oldest-first
+    bank->phases.resize(length);
+    for (int p = 0; p < up; ++p) {
+        float* phase = bank->phases.data() + static_cast<size_t>(p) * bank->taps;
+        for (size_t k = 0; k < bank->taps; ++k) {
+            phase[bank->taps - 1 - k] = static_cast<float>(prototype[p + k * up]);
+        }
+    }
+    return bank;
+}
+
+void Resampler::reset() {
+    history_.clear();
+    phase_ = 0;
+    position_ = 0;
+    if (bank_) {
+        // Start one group delay in, so output m lines up with input time m * down / up
+        history_.assign(bank_->taps - 1, 0.0f);
+        position_ = bank_->taps - 1 + bank_->center / up_;
+        phase_ = static_cast<int>(bank_->center % up_);
+    }
+}
+
+void Resampler::process(const float* input, size_t length, std::vector<float>& output) {
+    if (isPassthrough()) {
+        output.insert(output.end(), input, input + length);
+        return;
+    }
+
+    history_.insert(history_.end(), input, input + length);
+
+    const size_t taps = bank_->taps;
+    const float* phases = bank_->phases.data();
+    while (position_ < history_.size()) {
+        const float* window = history_.data() + position_ + 1 - taps;
+        output.push_back(simd::dotProduct(phases + static_cast<size_t>(phase_) * taps, window, taps));
+
+        phase_ += down_;
+        position_ += static_cast<size_t>(phase_ / up_);
+        phase_ %= up_;
+    }
+
+    // Keep only the taps-1 samples the next output still reads (position_ may run past the
+    // end when down > up; the skipped samples are then dropped from the next chunk)
+    size_t consumed = std::min(position_ + 1 - taps, history_.size());
+    history_.erase(history_.begin(), history_.begin() + consumed);
+    position_ -= consumed;
+}
+
+void Resampler::flush(std::vector<float>& output) {
+    if (isPassthrough()) {
+        return;
+    }
+    std::vector<float> zeros(bank_->taps, 0.0f);
+    process(zeros.data(), zeros.size(), output);
+}
+
+std::vector<float> Resampler::resample(const std::vector<float>& input, int input_rate, int output_rate) {
+    if (input_rate == output_rate) {
+        return input;
+    }
+
+    Resampler resampler(input_rate, output_rate);
+    const size_t expected = static_cast<size_t>(
+        std::llround(static_cast<double>(input.size()) * resampler.up_ / resampler.down_));
+
+    std::vector<float> output;
+    output.reserve(expected + resampler.bank_->taps);
+    resampler.process(input.data(), input.size(), output);
+    resampler.flush(output);
+    output.resize(expected, 0.0f);
+    return output;
+}
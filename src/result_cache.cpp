@@ -0,0 +1,128 @@
+#include "result_cache.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9e3779b185ebca87ULL;
+constexpr uint64_t kPrime2 = 0xc2b2ae3d27d4eb4fULL;
+constexpr uint64_t kPrime3 = 0x165667b19e3779f9ULL;
+constexpr uint64_t kPrime4 = 0x85ebca77c2b2ae63ULL;
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// MurmurHash3 finalizer: every input bit affects every output bit
+inline uint64_t finalize(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// PCM in [-1, 1] maps onto the full 16-bit range
+constexpr float kSampleScale = 32768.0f;
+// CMVN-normalized features sit within a few units of zero; 1/256 steps keep them in 16 bits
+constexpr float kFeatureScale = 256.0f;
+
+inline uint64_t quantize(float value, float scale) {
+    float scaled = std::min(32767.0f, std::max(-32768.0f, value * scale));
+    return static_cast<uint16_t>(static_cast<int16_t>(std::lrint(scaled)));
+}
+
+ResultCache::Key hashValues(const float* values, size_t length, float scale, const std::string& settings) {
+    ResultCache::Key key;
+    key.samples = length;
+    key.settings = settings;
+
+    // Four 16-bit values per word, folded into two lanes with different constants
+    uint64_t h0 = kPrime1 ^ length;
+    uint64_t h1 = kPrime2 + length;
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        uint64_t word = quantize(values[i], scale) | (quantize(values[i + 1], scale) << 16) |
+                        (quantize(values[i + 2], scale) << 32) | (quantize(values[i + 3], scale) << 48);
+        h0 = rotl(h0 ^ (word * kPrime1), 31) * kPrime2;
+        h1 = rotl(h1 + (word * kPrime3), 27) * kPrime4;
+    }
+    if (i < length) {
+        uint64_t word = 0;
+        for (int shift = 0; i < length; ++i, shift += 16) {
+            word |= quantize(values[i], scale) << shift;
+        }
+        h0 = rotl(h0 ^ (word * kPrime1), 31) * kPrime2;
+        h1 = rotl(h1 + (word * kPrime3), 27) * kPrime4;
+    }
+    key.hash[0] = finalize(h0);
+    key.hash[1] = finalize(h1 ^ h0);
+    return key;
+}
+
+}  // namespace
+
+ResultCache::Key ResultCache::makeKey(const float* audio, size_t length, const std::string& settings) {
+    return hashValues(audio, length, kSampleScale, settings);
+}
+
+ResultCache::Key ResultCache::makeFeatureKey(const float* features, size_t count, const std::string& settings) {
+    return hashValues(features, count, kFeatureScale, settings + "|features");
+}
+
+bool ResultCache::lookup(const Key& key, ASRModel::Result& result) {
+    bool hit = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            entries_.splice(entries_.begin(), entries_, it->second);
+            result = it->second->second;
+            hit = true;
+        }
+    }
+    Metrics::instance().addCacheLookup(hit);
+    return hit;
+}
+
+void ResultCache::insert(const Key& key, const ASRModel::Result& result) {
+    if (capacity_ == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        it->second->second = result;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return;
+    }
+    entries_.emplace_front(key, result);
+    index_.emplace(key, entries_.begin());
+    while (entries_.size() > capacity_) {
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+    }
+}
+
+void ResultCache::setModelFingerprint(const std::string& fingerprint) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fingerprint == model_fingerprint_) {
+        return;
+    }
+    model_fingerprint_ = fingerprint;
+    entries_.clear();
+    index_.clear();
+}
+
+void ResultCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+}
+
+size_t ResultCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
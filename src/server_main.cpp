@@ -0,0 +1,213 @@
+// sensevoice_server: WebSocket ASR service. Clients stream s16le PCM and receive partial and
+// final transcripts as JSON; GET /metrics serves Prometheus text. See ASRServer for the protocol.
+//
+//   sensevoice_server --port 8765 --max_sessions 32 --num_sessions 4
+
+#include "asr_server.hpp"
+#include "asr_model.hpp"
+#include "batch_scheduler.hpp"
+#include "multi_stream_vad.hpp"
+#include "model_downloader.hpp"
+#include "ort_runtime.hpp"
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+namespace {
+
+struct ServerOptions {
+    std::string model_dir = "~/.cache/sensevoice";
+    std::string language = "zh";
+    int num_sessions = 2;       // model sessions shared by all streams
+    int intra_op_threads = 1;
+    int max_batch = 8;
+    bool startup_cache = true;
+    bool map_models = false;
+    std::string providers = "auto";
+    std::string precision = "auto";
+    bool warmup = true;
+    std::vector<size_t> shape_buckets;
+    size_t arena_max_mb = 0;
+    size_t result_cache = 0;    // results kept for byte-identical segments; 0 = off
+    OrtRuntime::ArenaExtend arena_extend = OrtRuntime::ArenaExtend::PowerOfTwo;
+};
+
+void printUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options]" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --host <addr>               Listen address (default: 0.0.0.0)" << std::endl;
+    std::cout << "  --port <n>                  Listen port (default: 8765)" << std::endl;
+    std::cout << "  --model_dir <dir>           Model cache directory (default: ~/.cache/sensevoice)" << std::endl;
+    std::cout << "  --language <code>           Default recognition language (default: zh)" << std::endl;
+    std::cout << "  --max_sessions <n>          Concurrent streams (default: 32)" << std::endl;
+    std::cout << "  --num_sessions <n>          Model sessions shared by the streams (default: 2)" << std::endl;
+    std::cout << "  --intra_op_threads <n>      ORT intra-op threads per model session (default: 1)" << std::endl;
+    std::cout << "  --max_batch <n>             Segments per batched recognize call (default: 8)" << std::endl;
+    std::cout << "  --trigger_threshold <p>     VAD probability that starts speech (default: 0.5)" << std::endl;
+    std::cout << "  --stop_threshold <p>        VAD probability counted as silence (default: 0.35)" << std::endl;
+    std::cout << "  --silence_duration <s>      Silence that ends a segment (default: 0.5)" << std::endl;
+    std::cout << "  --max_segment <s>           Longest segment before it is split (default: 20)" << std::endl;
+    std::cout << "  --no_partial                Send final results only" << std::endl;
+    std::cout << "  --max_backlog <s>           Unprocessed audio per stream before reading pauses (default: 2)" << std::endl;
+    std::cout << "  --max_session_memory_mb <n> Buffered audio per stream before reading pauses (default: 8)" << std::endl;
+    std::cout << "  --provider <list>           Execution providers to try in order (default: auto)" << std::endl;
+    std::cout << "  --precision <type>          ASR model variant: auto, int8, fp32 or fp16 (default: auto)" << std::endl;
+    std::cout << "  --no_cache                  Do not reuse the binary vocabulary and optimized models" << std::endl;
+    std::cout << "  --mmap_models               Load models from shared memory mappings" << std::endl;
+    std::cout << "  --no_warmup                 Skip the ASR warmup runs at startup" << std::endl;
+    std::cout << "  --shape_buckets <n,...>     Pad ASR inputs up to these frame counts (60ms each)" << std::endl;
+    std::cout << "  --arena_max_mb <n>          Cap the shared ONNX Runtime arena at n MB (default: unbounded)" << std::endl;
+    std::cout << "  --arena_extend <strategy>   power_of_two or same_as_requested (default: power_of_two)" << std::endl;
+    std::cout << "  --result_cache <n>          Reuse the results of the last n distinct segments (default: off)" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    ASRServer::Config server_config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--host" && i + 1 < argc) {
+            server_config.host = argv[++i];
+        } else if (arg == "--port" && i + 1 < argc) {
+            server_config.port = std::atoi(argv[++i]);
+        } else if (arg == "--model_dir" && i + 1 < argc) {
+            options.model_dir = argv[++i];
+        } else if (arg == "--language" && i + 1 < argc) {
+            options.language = argv[++i];
+        } else if (arg == "--max_sessions" && i + 1 < argc) {
+            server_config.max_sessions = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--num_sessions" && i + 1 < argc) {
+            options.num_sessions = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--intra_op_threads" && i + 1 < argc) {
+            options.intra_op_threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--max_batch" && i + 1 < argc) {
+            options.max_batch = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--trigger_threshold" && i + 1 < argc) {
+            server_config.trigger_threshold = std::atof(argv[++i]);
+        } else if (arg == "--stop_threshold" && i + 1 < argc) {
+            server_config.stop_threshold = std::atof(argv[++i]);
+        } else if (arg == "--silence_duration" && i + 1 < argc) {
+            server_config.min_silence_seconds = std::atof(argv[++i]);
+        } else if (arg == "--max_segment" && i + 1 < argc) {
+            server_config.max_segment_seconds = std::atof(argv[++i]);
+        } else if (arg == "--no_partial") {
+            server_config.partial_results = false;
+        } else if (arg == "--max_backlog" && i + 1 < argc) {
+            server_config.max_backlog_seconds = std::atof(argv[++i]);
+        } else if (arg == "--max_session_memory_mb" && i + 1 < argc) {
+            server_config.max_session_memory_bytes = static_cast<size_t>(std::max(1, std::atoi(argv[++i]))) << 20;
+        } else if (arg == "--provider" && i + 1 < argc) {
+            options.providers = argv[++i];
+        } else if (arg == "--precision" && i + 1 < argc) {
+            options.precision = argv[++i];
+        } else if (arg == "--no_cache") {
+            options.startup_cache = false;
+        } else if (arg == "--mmap_models") {
+            options.map_models = true;
+        } else if (arg == "--no_warmup") {
+            options.warmup = false;
+        } else if (arg == "--shape_buckets" && i + 1 < argc) {
+            options.shape_buckets = ASRModel::parseShapeBuckets(argv[++i]);
+        } else if (arg == "--result_cache" && i + 1 < argc) {
+            options.result_cache = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--arena_max_mb" && i + 1 < argc) {
+            options.arena_max_mb = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--arena_extend" && i + 1 < argc) {
+            std::string strategy = argv[++i];
+            if (!OrtRuntime::parseArenaExtend(strategy, options.arena_extend)) {
+                std::cerr << "Invalid arena strategy: " << strategy << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Every thread started below inherits the mask, so only sigwait() sees SIGINT/SIGTERM
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    ModelDownloader::Config downloader_config;
+    downloader_config.cache_dir = options.model_dir;
+    ModelDownloader downloader(downloader_config);
+    if (!downloader.ensureModelsExist()) {
+        std::cerr << "Failed to ensure models exist" << std::endl;
+        return 1;
+    }
+    if (options.startup_cache) {
+        OrtRuntime::setModelCacheDir(downloader.getStartupCacheDir());
+    }
+    OrtRuntime::setModelMapping(options.map_models);
+
+    ASRModel::Config asr_config;
+    asr_config.execution_providers = OrtRuntime::parseProviders(options.providers);
+    std::string precision;
+    asr_config.model_path = downloader.getAsrModelPath(
+        options.precision, OrtRuntime::isGpuProvider(OrtRuntime::firstAvailableProvider(asr_config.execution_providers)),
+        &precision);
+    asr_config.quantized = precision == "int8";
+    asr_config.half_precision = precision == "fp16";
+    asr_config.config_path = downloader.getModelPath(ModelDownloader::CONFIG_NAME);
+    asr_config.vocab_path = downloader.getModelPath(ModelDownloader::VOCAB_NAME);
+    asr_config.decoder_path = downloader.getModelPath(ModelDownloader::DECODER_NAME);
+    if (options.startup_cache) {
+        asr_config.cache_dir = downloader.getStartupCacheDir();
+    }
+    asr_config.language = options.language;
+    asr_config.num_sessions = options.num_sessions;
+    asr_config.intra_op_threads = options.intra_op_threads;
+    asr_config.batch_size = options.max_batch;
+    asr_config.warmup = options.warmup;
+    asr_config.shape_buckets = options.shape_buckets;
+    asr_config.arena_extend = options.arena_extend;
+    asr_config.arena_max_bytes = options.arena_max_mb << 20;
+    asr_config.result_cache_entries = options.result_cache;
+    ASRModel model(asr_config);
+    if (!model.initialize()) {
+        std::cerr << "Failed to initialize ASR model" << std::endl;
+        return 1;
+    }
+
+    MultiStreamVAD::Config vad_config;
+    vad_config.model_path = downloader.getModelPath(ModelDownloader::VAD_MODEL_NAME);
+    vad_config.max_streams = server_config.max_sessions;
+    vad_config.max_batch = server_config.max_sessions;
+    MultiStreamVAD vad(vad_config);
+    if (!vad.initialize()) {
+        std::cerr << "Failed to initialize VAD" << std::endl;
+        return 1;
+    }
+
+    BatchScheduler::Config scheduler_config;
+    scheduler_config.max_batch_size = options.max_batch;
+    scheduler_config.num_workers = model.getNumSessions();
+    BatchScheduler scheduler(model, scheduler_config);
+    scheduler.start();
+
+    ASRServer server(model, scheduler, vad, server_config);
+    if (!server.start()) {
+        scheduler.stop();
+        return 1;
+    }
+
+    int signal_number = 0;
+    sigwait(&signals, &signal_number);
+    std::cout << "Shutting down..." << std::endl;
+    server.stop();
+    scheduler.stop();
+    return 0;
+}
@@ -0,0 +1,345 @@
+#include "simd_utils.hpp"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ASR_SIMD_NEON 1
+#elif defined(__riscv_vector) && defined(__riscv_v_intrinsic) && __riscv_v_intrinsic >= 12000
+#include <riscv_vector.h>
+#define ASR_SIMD_RVV 1
+#elif (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define ASR_SIMD_AVX2 1
+#endif
+
+namespace simd {
+
+namespace {
+
+// Cephes logf: x = m * 2^e with m in [sqrt(0.5), sqrt(2)), ln(m) by a degree-9 polynomial in
+// m - 1, and ln(2) * e split in two constants so the sum stays exact
+constexpr float kSqrtHalf = 0.707106781186547524f;
+constexpr float kLogP[9] = {7.0376836292e-2f, -1.1514610310e-1f, 1.1676998740e-1f,
+                            -1.2420140846e-1f, 1.4249322787e-1f, -1.6668057665e-1f,
+                            2.0000714765e-1f, -2.4999993993e-1f, 3.3333331174e-1f};
+constexpr float kLn2Low = -2.12194440e-4f;
+constexpr float kLn2High = 0.693359375f;
+
+#if defined(ASR_SIMD_AVX2)
+// AVX2 kernels are compiled for the target on demand and only used if the CPU has them
+bool hasAVX2() {
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+}
+
+__attribute__((target("avx2,fma")))
+float horizontalSum(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+    return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma")))
+size_t powerSpectrumAVX2(const float* complex_data, float* power, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 a = _mm256_loadu_ps(complex_data + 2 * i);
+        __m256 b = _mm256_loadu_ps(complex_data + 2 * i + 8);
+        // hadd pairs re^2 + im^2 per 128-bit lane, the permute restores bin order
+        __m256 sum = _mm256_hadd_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b));
+        sum = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sum), 0xD8));
+        _mm256_storeu_ps(power + i, sum);
+    }
+    return i;
+}
+
+__attribute__((target("avx2,fma")))
+float dotProductAVX2(const float* a, const float* b, size_t n, size_t& done) {
+    __m256 acc = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc);
+    }
+    done = i;
+    return horizontalSum(acc);
+}
+
+__attribute__((target("avx2,fma")))
+size_t clampMinAVX2(float* data, size_t n, float min_value) {
+    __m256 floor = _mm256_set1_ps(min_value);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(data + i, _mm256_max_ps(_mm256_loadu_ps(data + i), floor));
+    }
+    return i;
+}
+
+__attribute__((target("avx2,fma")))
+size_t logInPlaceAVX2(float* data, size_t n) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256i mantissa_mask = _mm256_set1_epi32(static_cast<int>(0x807fffffu));
+    const __m256i half_exponent = _mm256_set1_epi32(0x3f000000);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i bits = _mm256_castps_si256(_mm256_loadu_ps(data + i));
+        __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+        __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, mantissa_mask), half_exponent));
+        
+        // m in [0.5, 1): below sqrt(0.5) use 2m and one less in the exponent
+        __m256 small = _mm256_cmp_ps(m, _mm256_set1_ps(kSqrtHalf), _CMP_LT_OQ);
+        __m256 x = _mm256_add_ps(_mm256_sub_ps(m, one), _mm256_and_ps(m, small));
+        e = _mm256_sub_ps(e, _mm256_and_ps(one, small));
+        
+        __m256 z = _mm256_mul_ps(x, x);
+        __m256 y = _mm256_set1_ps(kLogP[0]);
+        for (int k = 1; k < 9; ++k) {
+            y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kLogP[k]));
+        }
+        y = _mm256_mul_ps(_mm256_mul_ps(y, x), z);
+        y = _mm256_fmadd_ps(e, _mm256_set1_ps(kLn2Low), y);
+        y = _mm256_fnmadd_ps(z, _mm256_set1_ps(0.5f), y);
+        x = _mm256_add_ps(x, y);
+        _mm256_storeu_ps(data + i, _mm256_fmadd_ps(e, _mm256_set1_ps(kLn2High), x));
+    }
+    return i;
+}
+
+__attribute__((target("avx2,fma")))
+size_t argmaxAVX2(const float* data, size_t n, float& best_value, size_t& done) {
+    __m256 best = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+    __m256i best_index = _mm256_setzero_si256();
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i step = _mm256_set1_epi32(8);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(data + i);
+        __m256 greater = _mm256_cmp_ps(v, best, _CMP_GT_OQ);  // strict: each lane keeps its first max
+        best = _mm256_blendv_ps(best, v, greater);
+        best_index = _mm256_blendv_epi8(best_index, index, _mm256_castps_si256(greater));
+        index = _mm256_add_epi32(index, step);
+    }
+    done = i;
+
+    alignas(32) float values[8];
+    alignas(32) int32_t indices[8];
+    _mm256_store_ps(values, best);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(indices), best_index);
+    size_t result = 0;
+    best_value = -std::numeric_limits<float>::infinity();
+    for (int lane = 0; lane < 8 && i > 0; ++lane) {
+        if (values[lane] > best_value ||
+            (values[lane] == best_value && static_cast<size_t>(indices[lane]) < result)) {
+            best_value = values[lane];
+            result = static_cast<size_t>(indices[lane]);
+        }
+    }
+    return result;
+}
+#endif
+
+}  // namespace
+
+void powerSpectrum(const float* complex_data, float* power, size_t n) {
+    size_t i = 0;
+
+#if defined(ASR_SIMD_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4x2_t c = vld2q_f32(complex_data + 2 * i);  // de-interleaves re / im
+        vst1q_f32(power + i, vmlaq_f32(vmulq_f32(c.val[0], c.val[0]), c.val[1], c.val[1]));
+    }
+#elif defined(ASR_SIMD_RVV)
+    for (size_t vl; i < n; i += vl) {
+        vl = __riscv_vsetvl_e32m4(n - i);
+        vfloat32m4_t re = __riscv_vlse32_v_f32m4(complex_data + 2 * i, 2 * sizeof(float), vl);
+        vfloat32m4_t im = __riscv_vlse32_v_f32m4(complex_data + 2 * i + 1, 2 * sizeof(float), vl);
+        vfloat32m4_t p = __riscv_vfmul_vv_f32m4(re, re, vl);
+        __riscv_vse32_v_f32m4(power + i, __riscv_vfmacc_vv_f32m4(p, im, im, vl), vl);
+    }
+#elif defined(ASR_SIMD_AVX2)
+    if (hasAVX2()) {
+        i = powerSpectrumAVX2(complex_data, power, n);
+    }
+#endif
+
+    for (; i < n; ++i) {
+        float re = complex_data[2 * i];
+        float im = complex_data[2 * i + 1];
+        power[i] = re * re + im * im;
+    }
+}
+
+float dotProduct(const float* a, const float* b, size_t n) {
+    size_t i = 0;
+    float sum = 0.0f;
+
+#if defined(ASR_SIMD_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n; i += 4) {
+        acc = vfmaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    sum = vaddvq_f32(acc);
+#elif defined(ASR_SIMD_RVV)
+    vfloat32m1_t acc = __riscv_vfmv_s_f_f32m1(0.0f, 1);
+    for (size_t vl; i < n; i += vl) {
+        vl = __riscv_vsetvl_e32m4(n - i);
+        vfloat32m4_t prod = __riscv_vfmul_vv_f32m4(__riscv_vle32_v_f32m4(a + i, vl),
+                                                   __riscv_vle32_v_f32m4(b + i, vl), vl);
+        acc = __riscv_vfredusum_vs_f32m4_f32m1(prod, acc, vl);
+    }
+    sum = __riscv_vfmv_f_s_f32m1_f32(acc);
+#elif defined(ASR_SIMD_AVX2)
+    if (hasAVX2()) {
+        sum = dotProductAVX2(a, b, n, i);
+    }
+#endif
+
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+void clampMin(float* data, size_t n, float min_value) {
+    size_t i = 0;
+
+#if defined(ASR_SIMD_NEON)
+    float32x4_t floor = vdupq_n_f32(min_value);
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(data + i, vmaxq_f32(vld1q_f32(data + i), floor));
+    }
+#elif defined(ASR_SIMD_RVV)
+    for (size_t vl; i < n; i += vl) {
+        vl = __riscv_vsetvl_e32m8(n - i);
+        vfloat32m8_t v = __riscv_vle32_v_f32m8(data + i, vl);
+        __riscv_vse32_v_f32m8(data + i, __riscv_vfmax_vf_f32m8(v, min_value, vl), vl);
+    }
+#elif defined(ASR_SIMD_AVX2)
+    if (hasAVX2()) {
+        i = clampMinAVX2(data, n, min_value);
+    }
+#endif
+
+    for (; i < n; ++i) {
+        data[i] = std::max(data[i], min_value);
+    }
+}
+
+void logInPlace(float* data, size_t n) {
+    size_t i = 0;
+
+#if defined(ASR_SIMD_NEON)
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    for (; i + 4 <= n; i += 4) {
+        uint32x4_t bits = vreinterpretq_u32_f32(vld1q_f32(data + i));
+        float32x4_t e = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(126)));
+        float32x4_t m = vreinterpretq_f32_u32(
+            vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x807fffffu)), vdupq_n_u32(0x3f000000u)));
+
+        uint32x4_t small = vcltq_f32(m, vdupq_n_f32(kSqrtHalf));
+        float32x4_t x = vaddq_f32(vsubq_f32(m, one), vbslq_f32(small, m, vdupq_n_f32(0.0f)));
+        e = vsubq_f32(e, vbslq_f32(small, one, vdupq_n_f32(0.0f)));
+
+        float32x4_t z = vmulq_f32(x, x);
+        float32x4_t y = vdupq_n_f32(kLogP[0]);
+        for (int k = 1; k < 9; ++k) {
+            y = vfmaq_f32(vdupq_n_f32(kLogP[k]), y, x);
+        }
+        y = vmulq_f32(vmulq_f32(y, x), z);
+        y = vfmaq_f32(y, e, vdupq_n_f32(kLn2Low));
+        y = vfmsq_f32(y, z, vdupq_n_f32(0.5f));
+        x = vaddq_f32(x, y);
+        vst1q_f32(data + i, vfmaq_f32(x, e, vdupq_n_f32(kLn2High)));
+    }
+#elif defined(ASR_SIMD_RVV)
+    for (size_t vl; i < n; i += vl) {
+        vl = __riscv_vsetvl_e32m4(n - i);
+        vuint32m4_t bits = __riscv_vreinterpret_v_f32m4_u32m4(__riscv_vle32_v_f32m4(data + i, vl));
+        vint32m4_t exponent = __riscv_vsub_vx_i32m4(
+            __riscv_vreinterpret_v_u32m4_i32m4(__riscv_vsrl_vx_u32m4(bits, 23, vl)), 126, vl);
+        vfloat32m4_t e = __riscv_vfcvt_f_x_v_f32m4(exponent, vl);
+        vfloat32m4_t m = __riscv_vreinterpret_v_u32m4_f32m4(
+            __riscv_vor_vx_u32m4(__riscv_vand_vx_u32m4(bits, 0x807fffffu, vl), 0x3f000000u, vl));
+
+        vbool8_t small = __riscv_vmflt_vf_f32m4_b8(m, kSqrtHalf, vl);
+        vfloat32m4_t x = __riscv_vfsub_vf_f32m4(m, 1.0f, vl);
+        x = __riscv_vfadd_vv_f32m4_mu(small, x, x, m, vl);
+        e = __riscv_vfsub_vf_f32m4_mu(small, e, e, 1.0f, vl);
+
+        vfloat32m4_t z = __riscv_vfmul_vv_f32m4(x, x, vl);
+        vfloat32m4_t y = __riscv_vfmv_v_f_f32m4(kLogP[0], vl);
+        for (int k = 1; k < 9; ++k) {
+            y = __riscv_vfadd_vf_f32m4(__riscv_vfmul_vv_f32m4(y, x, vl), kLogP[k], vl);
+        }
+        y = __riscv_vfmul_vv_f32m4(__riscv_vfmul_vv_f32m4(y, x, vl), z, vl);
+        y = __riscv_vfmacc_vf_f32m4(y, kLn2Low, e, vl);
+        y = __riscv_vfnmsac_vf_f32m4(y, 0.5f, z, vl);
+        x = __riscv_vfadd_vv_f32m4(x, y, vl);
+        __riscv_vse32_v_f32m4(data + i, __riscv_vfmacc_vf_f32m4(x, kLn2High, e, vl), vl);
+    }
+#elif defined(ASR_SIMD_AVX2)
+    if (hasAVX2()) {
+        i = logInPlaceAVX2(data, n);
+    }
+#endif
+
+    for (; i < n; ++i) {
+        data[i] = std::log(data[i]);
+    }
+}
+
+size_t argmax(const float* data, size_t n, float* max_value) {
+    size_t i = 0;
+    size_t best_index = 0;
+    float best = -std::numeric_limits<float>::infinity();
+
+#if defined(ASR_SIMD_NEON)
+    if (n >= 4) {
+        float32x4_t best_v = vdupq_n_f32(best);
+        uint32x4_t best_i = vdupq_n_u32(0);
+        uint32x4_t index = {0, 1, 2, 3};
+        const uint32x4_t step = vdupq_n_u32(4);
+        for (; i + 4 <= n; i += 4) {
+            float32x4_t v = vld1q_f32(data + i);
+            uint32x4_t greater = vcgtq_f32(v, best_v);
+            best_v = vbslq_f32(greater, v, best_v);
+            best_i = vbslq_u32(greater, index, best_i);
+            index = vaddq_u32(index, step);
+        }
+        // Largest value, then the smallest lane index holding it
+        best = vmaxvq_f32(best_v);
+        uint32x4_t is_best = vceqq_f32(best_v, vdupq_n_f32(best));
+        best_index = vminvq_u32(vbslq_u32(is_best, best_i, vdupq_n_u32(0xFFFFFFFFu)));
+    }
+#elif defined(ASR_SIMD_RVV)
+    for (size_t vl; i < n; i += vl) {
+        vl = __riscv_vsetvl_e32m8(n - i);
+        vfloat32m8_t v = __riscv_vle32_v_f32m8(data + i, vl);
+        vfloat32m1_t init = __riscv_vfmv_s_f_f32m1(best, 1);
+        float chunk_max = __riscv_vfmv_f_s_f32m1_f32(__riscv_vfredmax_vs_f32m8_f32m1(v, init, vl));
+        if (chunk_max > best) {
+            best = chunk_max;
+            best_index = i + __riscv_vfirst_m_b4(__riscv_vmfeq_vf_f32m8_b4(v, chunk_max, vl), vl);
+        }
+    }
+#elif defined(ASR_SIMD_AVX2)
+    if (hasAVX2()) {
+        best_index = argmaxAVX2(data, n, best, i);
+    }
+#endif
+
+    for (; i < n; ++i) {
+        if (data[i] > best) {
+            best = data[i];
+            best_index = i;
+        }
+    }
+    if (max_value) {
+        *max_value = best;
+    }
+    return best_index;
+}
+
+}  // namespace simd
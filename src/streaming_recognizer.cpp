@@ -0,0 +1,183 @@
+#include "streaming_recognizer.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+
+StreamingRecognizer::StreamingRecognizer(ASRModel& model, const Config& config)
+    : model_(model), config_(config) {
+}
+
+StreamingRecognizer::~StreamingRecognizer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+bool StreamingRecognizer::initialize() {
+    frontend_ = model_.createStreamingFrontend();
+    if (!frontend_) {
+        std::cerr << "Failed to create streaming front-end" << std::endl;
+        return false;
+    }
+    feature_dim_ = frontend_->getFeatureDim();
+    config_.chunk_frames = std::max<size_t>(config_.chunk_frames, 1);
+
+    running_ = true;
+    worker_ = std::thread(&StreamingRecognizer::workerLoop, this);
+    return true;
+}
+
+void StreamingRecognizer::reset() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !decoding_; });
+
+    if (frontend_) {
+        frontend_->reset();
+    }
+    decode_pending_ = false;
+    finishing_ = false;
+    decoded_frames_ = 0;
+    segment_start_ = 0;
+    committed_text_.clear();
+    partial_text_.clear();
+}
+
+void StreamingRecognizer::acceptWaveform(const float* samples, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!frontend_ || finishing_) {
+        return;
+    }
+
+    frontend_->acceptWaveform(samples, length);
+    if (frontend_->numFramesReady() >= decoded_frames_ + config_.chunk_frames) {
+        decode_pending_ = true;
+        cv_.notify_all();
+    }
+}
+
+std::string StreamingRecognizer::finish() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!frontend_) {
+        return "";
+    }
+
+    // No more partials for this utterance; wait out the one in flight
+    finishing_ = true;
+    decode_pending_ = false;
+    cv_.wait(lock, [this] { return !decoding_; });
+
+    frontend_->inputFinished();
+    size_t total_frames = frontend_->numFramesReady();
+
+    commitSegments(lock, total_frames);
+    std::string text = committed_text_;
+    appendText(text, decodeSegment(lock, total_frames));
+    decoded_frames_ = total_frames;
+    partial_text_ = text;
+
+    ResultCallback callback = result_callback_;
+    lock.unlock();
+    if (callback) {
+        callback(text, true);
+    }
+    return text;
+}
+
+std::string StreamingRecognizer::getPartialResult() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return partial_text_;
+}
+
+size_t StreamingRecognizer::memoryBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t frames = frontend_ ? frontend_->numFramesReady() : 0;
+    return (frames * feature_dim_ + window_buffer_.capacity()) * sizeof(float);
+}
+
+void StreamingRecognizer::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return !running_ || (decode_pending_ && !finishing_); });
+        if (!running_) {
+            break;
+        }
+
+        decode_pending_ = false;
+        decoding_ = true;
+
+        // Always decode up to the newest frame; chunks that arrived meanwhile are coalesced
+        size_t total_frames = frontend_->numFramesReady();
+        commitSegments(lock, total_frames);
+        std::string text = committed_text_;
+        appendText(text, decodeSegment(lock, total_frames));
+        decoded_frames_ = total_frames;
+
+        bool changed = text != partial_text_;
+        partial_text_ = text;
+        ResultCallback callback = result_callback_;
+
+        if (callback && changed && !finishing_) {
+            lock.unlock();
+            callback(text, false);
+            lock.lock();
+        }
+
+        decoding_ = false;
+        cv_.notify_all();
+    }
+}
+
+std::string StreamingRecognizer::decodeSegment(std::unique_lock<std::mutex>& lock, size_t end) {
+    if (end <= segment_start_) {
+        return "";
+    }
+
+    size_t context_start = segment_start_ > config_.left_context_frames
+        ? segment_start_ - config_.left_context_frames : 0;
+    size_t num_frames = end - context_start;
+    size_t skip_frames = segment_start_ - context_start;
+
+    // The front-end keeps growing under the lock, so decode from a private copy of the window
+    size_t needed = num_frames * feature_dim_;
+    if (window_buffer_.size() < needed) {
+        window_buffer_.resize(needed);
+    }
+    const float* src = frontend_->frames() + context_start * feature_dim_;
+    std::copy(src, src + needed, window_buffer_.data());
+
+    lock.unlock();
+    std::string text = model_.recognizeFeatures(window_buffer_.data(), num_frames, skip_frames);
+    lock.lock();
+    return text;
+}
+
+void StreamingRecognizer::commitSegments(std::unique_lock<std::mutex>& lock, size_t total_frames) {
+    if (config_.max_segment_frames == 0) {
+        return;
+    }
+
+    while (total_frames - segment_start_ > config_.max_segment_frames) {
+        size_t end = segment_start_ + config_.max_segment_frames;
+        appendText(committed_text_, decodeSegment(lock, end));
+        segment_start_ = end;
+    }
+}
+
+void StreamingRecognizer::appendText(std::string& text, const std::string& piece) {
+    if (piece.empty()) {
+        return;
+    }
+
+    // Separate words across a segment boundary; CJK text is joined directly
+    if (!text.empty() &&
+        std::isalnum(static_cast<unsigned char>(text.back())) &&
+        std::isalnum(static_cast<unsigned char>(piece.front()))) {
+        text += ' ';
+    }
+    text += piece;
+}
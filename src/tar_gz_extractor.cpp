@@ -0,0 +1,309 @@
+#include "tar_gz_extractor.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+const size_t kBlockSize = 512;
+
+// Octal field, or GNU base-256 for sizes that do not fit
+uint64_t parseNumber(const uint8_t* field, size_t length) {
+    if (field[0] & 0x80) {
+        uint64_t value = field[0] & 0x7F;
+        for (size_t i = 1; i < length; ++i) {
+            value = (value << 8) | field[i];
+        }
+        return value;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < length && field[i]; ++i) {
+        if (field[i] >= '0' && field[i] <= '7') {
+            value = value * 8 + (field[i] - '0');
+        }
+    }
+    return value;
+}
+
+std::string parseString(const uint8_t* field, size_t length) {
+    const uint8_t* end = static_cast<const uint8_t*>(std::memchr(field, 0, length));
+    return std::string(reinterpret_cast<const char*>(field), end ? end - field : length);
+}
+
+// "path" record of a pax extended header ("<len> path=<value>\n" records)
+std::string paxPath(const std::string& records) {
+    size_t pos = 0;
+    while (pos < records.size()) {
+        size_t space = records.find(' ', pos);
+        if (space == std::string::npos) {
+            break;
+        }
+        size_t length = std::strtoul(records.c_str() + pos, nullptr, 10);
+        if (length == 0 || pos + length > records.size()) {
+            break;
+        }
+        std::string record = records.substr(space + 1, pos + length - space - 2);
+        if (record.compare(0, 5, "path=") == 0) {
+            return record.substr(5);
+        }
+        pos += length;
+    }
+    return "";
+}
+
+// Relative, without ".." components
+bool isSafePath(const std::string& name) {
+    std::filesystem::path path(name);
+    if (name.empty() || path.is_absolute()) {
+        return false;
+    }
+    for (const auto& part : path) {
+        if (part == "..") {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+TarGzExtractor::TarGzExtractor(const std::string& output_dir) : output_dir_(output_dir) {
+    std::memset(&stream_, 0, sizeof(stream_));
+    // 16 + MAX_WBITS: expect a gzip wrapper
+    stream_ready_ = inflateInit2(&stream_, 16 + MAX_WBITS) == Z_OK;
+    inflated_.resize(256 * 1024);
+}
+
+TarGzExtractor::~TarGzExtractor() {
+    if (stream_ready_) {
+        inflateEnd(&stream_);
+    }
+}
+
+bool TarGzExtractor::feed(const uint8_t* data, size_t size) {
+    if (!error_.empty()) {
+        return false;
+    }
+    if (!stream_ready_) {
+        return fail("zlib initialization failed");
+    }
+
+    stream_.next_in = const_cast<Bytef*>(data);
+    stream_.avail_in = static_cast<uInt>(size);
+    while (stream_.avail_in > 0) {
+        if (stream_ended_) {
+            // Concatenated gzip members continue the same tar stream
+            if (inflateReset(&stream_) != Z_OK) {
+                return fail("zlib reset failed");
+            }
+            stream_ended_ = false;
+        }
+        stream_.next_out = inflated_.data();
+        stream_.avail_out = static_cast<uInt>(inflated_.size());
+        int result = inflate(&stream_, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+            return fail(std::string("corrupt gzip stream: ") + (stream_.msg ? stream_.msg : "inflate failed"));
+        }
+        size_t produced = inflated_.size() - stream_.avail_out;
+        if (produced > 0 && !consumeTar(inflated_.data(), produced)) {
+            return false;
+        }
+        if (result == Z_STREAM_END) {
+            stream_ended_ = true;
+        } else if (result == Z_BUF_ERROR && produced == 0) {
+            break;  // needs more input
+        }
+    }
+
+    // Drain output still buffered inside zlib
+    while (!stream_ended_) {
+        stream_.next_out = inflated_.data();
+        stream_.avail_out = static_cast<uInt>(inflated_.size());
+        int result = inflate(&stream_, Z_NO_FLUSH);
+        size_t produced = inflated_.size() - stream_.avail_out;
+        if (produced > 0 && !consumeTar(inflated_.data(), produced)) {
+            return false;
+        }
+        if (result == Z_STREAM_END) {
+            stream_ended_ = true;
+        }
+        if (produced == 0 || (result != Z_OK && result != Z_STREAM_END)) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool TarGzExtractor::finish() {
+    if (!error_.empty()) {
+        return false;
+    }
+    if (!stream_ended_) {
+        return fail("truncated gzip stream");
+    }
+    // Some writers omit the two zero blocks; the last entry must still be complete
+    if (state_ != State::End && (state_ != State::Header || header_size_ != 0)) {
+        return fail("truncated tar archive");
+    }
+    if (file_.is_open()) {
+        file_.close();
+    }
+    return true;
+}
+
+bool TarGzExtractor::consumeTar(const uint8_t* data, size_t size) {
+    while (size > 0) {
+        switch (state_) {
+            case State::Header: {
+                size_t take = std::min(size, kBlockSize - header_size_);
+                std::memcpy(header_ + header_size_, data, take);
+                header_size_ += take;
+                data += take;
+                size -= take;
+                if (header_size_ == kBlockSize) {
+                    header_size_ = 0;
+                    if (!parseHeader()) {
+                        return false;
+                    }
+                }
+                break;
+            }
+            case State::Data:
+            case State::LongName:
+            case State::PaxHeader: {
+                size_t take = static_cast<size_t>(std::min<uint64_t>(size, remaining_));
+                if (state_ == State::Data) {
+                    file_.write(reinterpret_cast<const char*>(data), take);
+                    if (!file_) {
+                        return fail("write failed: " + files_.back());
+                    }
+                } else {
+                    meta_.append(reinterpret_cast<const char*>(data), take);
+                }
+                remaining_ -= take;
+                data += take;
+                size -= take;
+                if (remaining_ == 0) {
+                    if (state_ == State::Data) {
+                        file_.close();
+                    } else if (state_ == State::LongName) {
+                        long_name_ = parseString(reinterpret_cast<const uint8_t*>(meta_.data()), meta_.size());
+                    } else {
+                        long_name_ = paxPath(meta_);
+                    }
+                    state_ = padding_ > 0 ? State::Skip : State::Header;
+                }
+                break;
+            }
+            case State::Skip: {
+                size_t take = static_cast<size_t>(std::min<uint64_t>(size, padding_));
+                padding_ -= take;
+                data += take;
+                size -= take;
+                if (padding_ == 0) {
+                    state_ = State::Header;
+                }
+                break;
+            }
+            case State::End:
+                return true;  // trailing zero padding after the end marker
+        }
+    }
+    return true;
+}
+
+bool TarGzExtractor::parseHeader() {
+    if (std::all_of(header_, header_ + kBlockSize, [](uint8_t b) { return b == 0; })) {
+        if (++zero_blocks_ == 2) {
+            state_ = State::End;
+        }
+        return true;
+    }
+    zero_blocks_ = 0;
+
+    // The checksum field counts as eight spaces
+    uint64_t expected = parseNumber(header_ + 148, 8);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        sum += (i >= 148 && i < 156) ? ' ' : header_[i];
+    }
+    if (sum != expected) {
+        return fail("corrupt tar header");
+    }
+
+    std::string name = parseString(header_, 100);
+    if (std::memcmp(header_ + 257, "ustar", 5) == 0) {
+        std::string prefix = parseString(header_ + 345, 155);
+        if (!prefix.empty()) {
+            name = prefix + "/" + name;
+        }
+    }
+    if (!long_name_.empty()) {
+        name = long_name_;
+        long_name_.clear();
+    }
+    return beginEntry(name, static_cast<char>(header_[156]), parseNumber(header_ + 124, 12));
+}
+
+bool TarGzExtractor::beginEntry(const std::string& name, char type, uint64_t size) {
+    remaining_ = size;
+    padding_ = (kBlockSize - size % kBlockSize) % kBlockSize;
+    State body = State::Skip;
+
+    if (type == 'L' || type == 'x') {
+        meta_.clear();
+        body = type == 'L' ? State::LongName : State::PaxHeader;
+    } else if (type == '0' || type == '\0' || type == '7' || type == '5') {
+        std::string relative = name;
+        while (relative.compare(0, 2, "./") == 0) {
+            relative.erase(0, 2);
+        }
+        while (!relative.empty() && relative.back() == '/') {
+            relative.pop_back();
+        }
+        if (relative.empty() || relative == ".") {
+            body = State::Skip;
+        } else if (!isSafePath(relative)) {
+            return fail("unsafe path in archive: " + name);
+        } else {
+            std::filesystem::path path = std::filesystem::path(output_dir_) / relative;
+            std::error_code ec;
+            if (type == '5') {
+                std::filesystem::create_directories(path, ec);
+            } else {
+                std::filesystem::create_directories(path.parent_path(), ec);
+                file_.open(path, std::ios::binary | std::ios::trunc);
+                if (!file_.is_open()) {
+                    return fail("cannot create " + path.string());
+                }
+                files_.push_back(relative);
+                body = State::Data;
+            }
+        }
+    }
+    // Other entry types (links, devices, global pax headers) are skipped with their data
+
+    if (remaining_ == 0) {
+        if (body == State::Data) {
+            file_.close();
+        }
+        state_ = padding_ > 0 ? State::Skip : State::Header;
+    } else if (body == State::Skip) {
+        padding_ += remaining_;
+        remaining_ = 0;
+        state_ = State::Skip;
+    } else {
+        state_ = body;
+    }
+    return true;
+}
+
+bool TarGzExtractor::fail(const std::string& message) {
+    if (error_.empty()) {
+        error_ = message;
+    }
+    if (file_.is_open()) {
+        file_.close();
+    }
+    return false;
+}
@@ -1,9 +1,49 @@
 #include "tokenizer.hpp"
+#include "ort_runtime.hpp"
+#include "mapped_file.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
-#include <regex>
 #include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <unistd.h>
+
+namespace {
+
+// Binary vocabulary cache: this header, then offsets[V + 1], sorted_ids[V], flags[V] and the
+// token bytes. The source file's size and mtime are stored so an edited tokens.txt invalidates it.
+struct VocabCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_tokens;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t blob_size;
+};
+
+const char kVocabCacheMagic[8] = {'S', 'V', 'V', 'O', 'C', 'A', 'B', '\0'};
+const uint32_t kVocabCacheVersion = 1;
+
+size_t vocabImageSize(uint64_t num_tokens, uint64_t blob_size) {
+    return sizeof(VocabCacheHeader) + sizeof(uint32_t) * (2 * num_tokens + 1) + num_tokens + blob_size;
+}
+
+bool sourceStamp(const std::string& path, uint64_t& size, int64_t& mtime) {
+    std::error_code ec;
+    size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return false;
+    }
+    auto time = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        return false;
+    }
+    mtime = static_cast<int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+}  // namespace
 
 Tokenizer::Tokenizer(const Config& config)
     : config_(config), memory_info_(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)) {
@@ -15,18 +55,15 @@ Tokenizer::~Tokenizer() {
 
 bool Tokenizer::initialize() {
     try {
-        env_ = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "Tokenizer");
-        
         if (!loadVocabulary()) {
             std::cerr << "Failed to load vocabulary" << std::endl;
             return false;
         }
         
-        if (!config_.decoder_model_path.empty()) {
-            if (!initializeDecoder()) {
-                // Note: ONNX decoder initialization failed, but this is not critical
-                // The system will fall back to simple text decoding which works fine
-            }
+        // The decoder model is only loaded when it is what produces the text
+        if (config_.decode_strategy == DecodeStrategy::OnnxDecoder && !initializeDecoder()) {
+            std::cerr << "Warning: ONNX decoder unavailable, using the built-in detokenizer" << std::endl;
+            config_.decode_strategy = DecodeStrategy::Table;
         }
         
         return true;
@@ -43,47 +80,209 @@ bool Tokenizer::loadVocabulary() {
         return false;
     }
     
+    uint64_t source_size = 0;
+    int64_t source_mtime = 0;
+    if (!sourceStamp(config_.vocab_file, source_size, source_mtime)) {
+        std::cerr << "Cannot open vocabulary file: " << config_.vocab_file << std::endl;
+        return false;
+    }
+    
+    // A cache built from this exact tokens.txt is mapped as-is, with no parsing or hashing
+    if (!config_.vocab_cache_file.empty() && mapVocabularyCache(source_size, source_mtime)) {
+        std::cout << "Loaded vocabulary with " << vocab_size_ << " tokens from cache" << std::endl;
+        return true;
+    }
+    
+    if (!parseVocabulary(source_size, source_mtime)) {
+        return false;
+    }
+    if (!config_.vocab_cache_file.empty()) {
+        writeVocabularyCache();
+    }
+    
+    std::cout << "Loaded vocabulary with " << vocab_size_ << " tokens" << std::endl;
+    return true;
+}
+
+bool Tokenizer::parseVocabulary(uint64_t source_size, int64_t source_mtime) {
     std::ifstream file(config_.vocab_file);
     if (!file.is_open()) {
         std::cerr << "Cannot open vocabulary file: " << config_.vocab_file << std::endl;
         return false;
     }
     
+    static const std::string kWordBoundary = "\xe2\x96\x81";  // ▁
+    std::string blob;
+    std::vector<uint32_t> offsets(1, 0);
+    std::vector<uint8_t> flags;
+    
     std::string line;
-    int id = 0;
     while (std::getline(file, line)) {
         if (!line.empty()) {
             // Parse format: "token\tscore"
             size_t tab_pos = line.find('\t');
-            std::string token;
-            if (tab_pos != std::string::npos) {
-                token = line.substr(0, tab_pos);
-            } else {
-                token = line;
+            std::string token = tab_pos != std::string::npos ? line.substr(0, tab_pos) : line;
+            
+            uint8_t token_flags = 0;
+            bool special = token.size() >= 4 && token.compare(0, 2, "<|") == 0 &&
+                           token.compare(token.size() - 2, 2, "|>") == 0;
+            if (token.empty() || token == "<blank>" || special) {
+                token_flags |= kTokenSkip;
+            }
+            if (token.compare(0, kWordBoundary.size(), kWordBoundary) == 0) {
+                token_flags |= kTokenWordStart;
             }
             
-            id_to_token_[id] = token;
-            token_to_id_[token] = id;
-            id++;
+            blob += token;
+            offsets.push_back(static_cast<uint32_t>(blob.size()));
+            flags.push_back(token_flags);
         }
     }
     
-    vocab_size_ = id_to_token_.size();
-    std::cout << "Loaded vocabulary with " << vocab_size_ << " tokens" << std::endl;
+    // Ids ordered by token bytes (lowest id first among duplicates) for binary-search lookups
+    const size_t num_tokens = flags.size();
+    std::vector<uint32_t> sorted(num_tokens);
+    for (size_t id = 0; id < num_tokens; ++id) {
+        sorted[id] = static_cast<uint32_t>(id);
+    }
+    auto token_at = [&](uint32_t id) {
+        return std::string_view(blob).substr(offsets[id], offsets[id + 1] - offsets[id]);
+    };
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [&](uint32_t a, uint32_t b) { return token_at(a) < token_at(b); });
+    
+    // Lay the table out exactly as the cache file stores it
+    VocabCacheHeader header{};
+    std::memcpy(header.magic, kVocabCacheMagic, sizeof(header.magic));
+    header.version = kVocabCacheVersion;
+    header.num_tokens = static_cast<uint32_t>(num_tokens);
+    header.source_size = source_size;
+    header.source_mtime = source_mtime;
+    header.blob_size = blob.size();
+    
+    vocab_image_.assign(vocabImageSize(num_tokens, blob.size()), 0);
+    uint8_t* out = vocab_image_.data();
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    std::memcpy(out, offsets.data(), offsets.size() * sizeof(uint32_t));
+    out += offsets.size() * sizeof(uint32_t);
+    std::memcpy(out, sorted.data(), sorted.size() * sizeof(uint32_t));
+    out += sorted.size() * sizeof(uint32_t);
+    std::memcpy(out, flags.data(), flags.size());
+    out += flags.size();
+    std::memcpy(out, blob.data(), blob.size());
+    
+    vocab_mapping_.reset();
+    setVocabularyViews(vocab_image_.data());
+    return true;
+}
+
+bool Tokenizer::mapVocabularyCache(uint64_t source_size, int64_t source_mtime) {
+    auto mapping = std::make_unique<MappedFile>();
+    if (!mapping->open(config_.vocab_cache_file) || mapping->size() < sizeof(VocabCacheHeader)) {
+        return false;
+    }
+    
+    VocabCacheHeader header;
+    std::memcpy(&header, mapping->data(), sizeof(header));
+    if (std::memcmp(header.magic, kVocabCacheMagic, sizeof(header.magic)) != 0 ||
+        header.version != kVocabCacheVersion ||
+        header.source_size != source_size || header.source_mtime != source_mtime ||
+        mapping->size() != vocabImageSize(header.num_tokens, header.blob_size)) {
+        return false;
+    }
+    
+    setVocabularyViews(mapping->data());
+    if (token_offsets_[vocab_size_] != header.blob_size) {
+        setVocabularyViews(nullptr);
+        return false;
+    }
+    
+    vocab_image_.clear();
+    vocab_mapping_ = std::move(mapping);
     return true;
 }
 
+void Tokenizer::writeVocabularyCache() const {
+    // Written aside and renamed, so concurrent workers never map a partial file
+    std::error_code ec;
+    std::filesystem::path path(config_.vocab_cache_file);
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path(), ec);
+    }
+    std::string temp_path = config_.vocab_cache_file + "." + std::to_string(getpid()) + ".tmp";
+    
+    std::ofstream file(temp_path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(vocab_image_.data()), static_cast<std::streamsize>(vocab_image_.size()));
+    file.close();
+    if (!file) {
+        std::cerr << "Warning: could not write vocabulary cache " << temp_path << std::endl;
+        std::filesystem::remove(temp_path, ec);
+        return;
+    }
+    
+    std::filesystem::rename(temp_path, config_.vocab_cache_file, ec);
+    if (ec) {
+        std::cerr << "Warning: could not write vocabulary cache " << config_.vocab_cache_file
+                  << ": " << ec.message() << std::endl;
+        std::filesystem::remove(temp_path, ec);
+    }
+}
+
+void Tokenizer::setVocabularyViews(const uint8_t* image) {
+    if (!image) {
+        vocab_size_ = 0;
+        token_offsets_ = nullptr;
+        sorted_ids_ = nullptr;
+        token_flags_ = nullptr;
+        token_blob_ = nullptr;
+        return;
+    }
+    
+    VocabCacheHeader header;
+    std::memcpy(&header, image, sizeof(header));
+    vocab_size_ = header.num_tokens;
+    
+    const uint8_t* data = image + sizeof(header);
+    token_offsets_ = reinterpret_cast<const uint32_t*>(data);
+    data += (vocab_size_ + 1) * sizeof(uint32_t);
+    sorted_ids_ = reinterpret_cast<const uint32_t*>(data);
+    data += vocab_size_ * sizeof(uint32_t);
+    token_flags_ = data;
+    data += vocab_size_;
+    token_blob_ = reinterpret_cast<const char*>(data);
+}
+
+int Tokenizer::findToken(std::string_view token) const {
+    const uint32_t* end = sorted_ids_ + vocab_size_;
+    const uint32_t* it = std::lower_bound(sorted_ids_, end, token, [this](uint32_t id, std::string_view value) {
+        return tokenView(static_cast<int>(id)) < value;
+    });
+    if (it != end && tokenView(static_cast<int>(*it)) == token) {
+        return static_cast<int>(*it);
+    }
+    return -1;
+}
+
 bool Tokenizer::initializeDecoder() {
+    if (config_.decoder_model_path.empty()) {
+        return false;
+    }
+    
     try {
+        OrtRuntime& runtime = OrtRuntime::instance();
         Ort::SessionOptions session_options;
-        session_options.SetIntraOpNumThreads(1);
+        runtime.configureSession(session_options);
+        if (!runtime.hasGlobalThreadPool()) {
+            session_options.SetIntraOpNumThreads(1);
+        }
         
         // Load ONNX extensions if specified
         if (!config_.ort_extensions_path.empty()) {
             session_options.RegisterCustomOpsLibrary(config_.ort_extensions_path.c_str());
         }
         
-        decoder_session_ = std::make_unique<Ort::Session>(*env_, config_.decoder_model_path.c_str(), session_options);
+        decoder_session_ = runtime.createSession(config_.decoder_model_path, session_options);
         
         // Get input/output names
         Ort::AllocatorWithDefaultOptions allocator;
@@ -104,18 +303,27 @@ bool Tokenizer::initializeDecoder() {
             output_names_.push_back(output_name.release());
         }
         
+        // Only a model that emits the text itself is worth a session run per utterance
+        if (num_input_nodes != 1 || num_output_nodes == 0 ||
+            decoder_session_->GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetElementType() !=
+                ONNX_TENSOR_ELEMENT_DATA_TYPE_STRING) {
+            std::cerr << "Decoder model does not map token ids to a string output" << std::endl;
+            cleanup();
+            return false;
+        }
+        
         std::cout << "ONNX decoder initialized successfully" << std::endl;
         return true;
         
     } catch (const std::exception& e) {
-        // Silently fail - decoder is optional
+        std::cerr << "Failed to load ONNX decoder: " << e.what() << std::endl;
+        cleanup();
         return false;
     }
 }
 
 void Tokenizer::cleanup() {
     decoder_session_.reset();
-    env_.reset();
     
     for (auto name : input_names_) {
         delete[] name;
@@ -130,83 +338,177 @@ void Tokenizer::cleanup() {
 
 std::string Tokenizer::decode(const std::vector<int>& token_ids) {
     if (decoder_session_) {
-        // Use ONNX decoder if available
         try {
-            // Convert token IDs to tensor
-            std::vector<int64_t> token_shape = {1, static_cast<int64_t>(token_ids.size())};
-            std::vector<int64_t> token_ids_int64(token_ids.begin(), token_ids.end());
-            
-            std::vector<Ort::Value> input_tensors;
-            input_tensors.push_back(Ort::Value::CreateTensor<int64_t>(
-                memory_info_, token_ids_int64.data(), token_ids_int64.size(),
-                token_shape.data(), token_shape.size()));
-            
-            auto output_tensors = decoder_session_->Run(Ort::RunOptions{nullptr},
-                                                      input_names_.data(), input_tensors.data(), input_tensors.size(),
-                                                      output_names_.data(), output_names_.size());
-            
-            // Extract decoded text (implementation depends on decoder model output format)
-            // For now, fall back to simple decoding
-            
+            return decodeWithSession(token_ids);
         } catch (const std::exception& e) {
             std::cerr << "ONNX decoder error: " << e.what() << ", falling back to simple decode" << std::endl;
         }
     }
+    return decodeTable(token_ids);
+}
+
+std::string Tokenizer::decodeWithSession(const std::vector<int>& token_ids) {
+    if (token_ids.empty()) {
+        return "";
+    }
+    
+    std::vector<int64_t> token_shape = {1, static_cast<int64_t>(token_ids.size())};
+    std::vector<int64_t> token_ids_int64(token_ids.begin(), token_ids.end());
+    Ort::Value input = Ort::Value::CreateTensor<int64_t>(
+        memory_info_, token_ids_int64.data(), token_ids_int64.size(),
+        token_shape.data(), token_shape.size());
+    
+    auto output_tensors = decoder_session_->Run(Ort::RunOptions{nullptr},
+                                                input_names_.data(), &input, 1,
+                                                output_names_.data(), 1);
     
-    // Simple decoding
-    std::vector<std::string> tokens;
+    std::string text;
+    size_t count = output_tensors[0].GetTensorTypeAndShapeInfo().GetElementCount();
+    for (size_t i = 0; i < count; ++i) {
+        text += output_tensors[0].GetStringTensorElement(i);
+    }
+    return postProcessText(text);
+}
+
+std::string Tokenizer::decodeTable(const std::vector<int>& token_ids) const {
+    // Simple decoding: append every text token's bytes straight from the table
+    std::string result;
+    result.reserve(token_ids.size() * 4);
     for (int id : token_ids) {
-        std::string token = idToToken(id);
-        if (!token.empty() && token != "<blank>") {
-            tokens.push_back(token);
+        if (id >= 0 && static_cast<size_t>(id) < vocab_size_) {
+            if (!(token_flags_[id] & kTokenSkip)) {
+                result.append(token_blob_ + token_offsets_[id], token_offsets_[id + 1] - token_offsets_[id]);
+            }
+        } else {
+            result += "<unk>";
         }
     }
     
-    std::string result = joinTokens(tokens);
     return postProcessText(result);
 }
 
 std::vector<int> Tokenizer::encode(const std::string& text) {
-    // Simple character-level encoding for Chinese text
+    // Greedy longest match against the vocabulary, word by word; the first piece of a word
+    // is tried with the SentencePiece "▁" marker first. Unmatched characters become <unk>.
+    static const std::string kWordBoundary = "\xe2\x96\x81";  // ▁
+    static const size_t kMaxPieceChars = 16;
     std::vector<int> token_ids;
     
-    // Convert UTF-8 string to individual characters
-    std::vector<std::string> chars = splitByDelimiters(text);
-    
-    for (const std::string& ch : chars) {
-        int id = tokenToId(ch);
-        token_ids.push_back(id);
+    std::istringstream words(text);
+    std::string word;
+    while (words >> word) {
+        std::vector<std::string> chars = splitByDelimiters(word);
+        size_t i = 0;
+        while (i < chars.size()) {
+            size_t matched = 0;
+            int id = unk_token_id_;
+            for (size_t len = std::min(kMaxPieceChars, chars.size() - i); len > 0 && matched == 0; --len) {
+                std::string piece;
+                for (size_t k = i; k < i + len; ++k) {
+                    piece += chars[k];
+                }
+                int found = i == 0 ? findToken(kWordBoundary + piece) : -1;
+                if (found < 0) {
+                    found = findToken(piece);
+                }
+                if (found >= 0) {
+                    id = found;
+                    matched = len;
+                }
+            }
+            token_ids.push_back(id);
+            i += std::max<size_t>(matched, 1);
+        }
     }
     
     return token_ids;
 }
 
 std::string Tokenizer::idToToken(int id) const {
-    auto it = id_to_token_.find(id);
-    return it != id_to_token_.end() ? it->second : "<unk>";
+    return std::string(tokenView(id));
+}
+
+std::string_view Tokenizer::tokenView(int id) const {
+    if (id < 0 || static_cast<size_t>(id) >= vocab_size_) {
+        return "<unk>";
+    }
+    return std::string_view(token_blob_ + token_offsets_[id], token_offsets_[id + 1] - token_offsets_[id]);
 }
 
 int Tokenizer::tokenToId(const std::string& token) const {
-    auto it = token_to_id_.find(token);
-    return it != token_to_id_.end() ? it->second : unk_token_id_;
+    int id = findToken(token);
+    return id >= 0 ? id : unk_token_id_;
 }
 
-std::string Tokenizer::postProcessText(const std::string& text) {
-    std::string result = text;
-    
-    // Remove SenseVoice special tokens and formatting
-    result = std::regex_replace(result, std::regex("<\\|[^|]*\\|>"), "");  // Remove <|zh|>, <|NEUTRAL|>, etc.
-    result = std::regex_replace(result, std::regex("-?\\d+\\.\\d+"), "");  // Remove scores like -20.3711
-    result = std::regex_replace(result, std::regex("\\d+"), "");          // Remove standalone numbers
-    result = std::regex_replace(result, std::regex("\\?\\s*\\?"), "");    // Remove ? ? patterns
-    result = std::regex_replace(result, std::regex("▁"), " ");            // Replace SentencePiece underscores
+std::string Tokenizer::postProcessText(const std::string& text) const {
+    // One left-to-right scan over the joined tokens with a little lookahead. In order, this
+    // drops decimal scores like -20.3711 and digit runs (strip_digits), "? ?" pairs, maps
+    // the "▁" marker to a space, and collapses whitespace runs into single, trimmed spaces.
+    // SenseVoice special tokens (<|zh|>, <|NEUTRAL|>, ...) never get here: CTCDecoder
+    // reports them as structured fields and the table marks them as skipped.
+    auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+    auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; };
+    const size_t n = text.size();
     
-    // Remove extra spaces and clean up
-    result = std::regex_replace(result, std::regex("\\s+"), " ");
+    // Pass over the digits first, so a "?" pair split only by digits is still seen as a pair
+    std::string stripped;
+    const std::string* source = &text;
+    if (config_.strip_digits) {
+        stripped.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            char c = text[i];
+            if (is_digit(c)) {
+                // A digit run followed by ".digits" is a score: take the fraction with it
+                while (i + 1 < n && is_digit(text[i + 1])) ++i;
+                if (i + 2 < n && text[i + 1] == '.' && is_digit(text[i + 2])) {
+                    i += 2;
+                    while (i + 1 < n && is_digit(text[i + 1])) ++i;
+                }
+                continue;
+            }
+            if (c == '-' && i + 1 < n && is_digit(text[i + 1])) {
+                // Sign of a decimal score; a dash before plain digits stays
+                size_t j = i + 1;
+                while (j < n && is_digit(text[j])) ++j;
+                if (j + 1 < n && text[j] == '.' && is_digit(text[j + 1])) {
+                    continue;
+                }
+            }
+            stripped += c;
+        }
+        source = &stripped;
+    }
     
-    // Remove leading/trailing spaces
-    result.erase(0, result.find_first_not_of(" \t\n\r"));
-    result.erase(result.find_last_not_of(" \t\n\r") + 1);
+    const std::string& input = *source;
+    const size_t m = input.size();
+    std::string result;
+    result.reserve(m);
+    bool pending_space = false;
+    for (size_t i = 0; i < m; ++i) {
+        char c = input[i];
+        if (c == '?') {
+            size_t j = i + 1;
+            while (j < m && is_space(input[j])) ++j;
+            if (j < m && input[j] == '?') {
+                i = j;  // drop the pair and the whitespace between
+                continue;
+            }
+        }
+        if (is_space(c)) {
+            pending_space = true;
+            continue;
+        }
+        if (c == '\xe2' && i + 2 < m && input[i + 1] == '\x96' && input[i + 2] == '\x81') {
+            pending_space = true;  // ▁
+            i += 2;
+            continue;
+        }
+        if (pending_space && !result.empty()) {
+            result += ' ';
+        }
+        pending_space = false;
+        result += c;
+    }
     
     return result;
 }
@@ -239,16 +541,3 @@ std::vector<std::string> Tokenizer::splitByDelimiters(const std::string& text) {
     
     return result;
 }
-
-std::string Tokenizer::joinTokens(const std::vector<std::string>& tokens) {
-    if (tokens.empty()) {
-        return "";
-    }
-    
-    std::string result;
-    for (const std::string& token : tokens) {
-        result += token;
-    }
-    
-    return result;
-}
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "vad_detector.hpp"
+#include "ort_runtime.hpp"
+#include "metrics.hpp"
 #include <iostream>
 #include <algorithm>
 #include <cmath>
@@ -14,13 +16,12 @@ VADDetector::~VADDetector() {
 
 bool VADDetector::initialize() {
     try {
-        env_ = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "VADDetector");
-        
         if (!initializeSession()) {
             return false;
         }
         
         reset();
+        bindTensors();
         return true;
         
     } catch (const std::exception& e) {
@@ -31,11 +32,14 @@ bool VADDetector::initialize() {
 
 bool VADDetector::initializeSession() {
     try {
+        OrtRuntime& runtime = OrtRuntime::instance();
         Ort::SessionOptions session_options;
-        session_options.SetIntraOpNumThreads(1);
-        session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
-        
-        session_ = std::make_unique<Ort::Session>(*env_, config_.model_path.c_str(), session_options);
+        runtime.configureSession(session_options);
+        if (!runtime.hasGlobalThreadPool()) {
+            session_options.SetIntraOpNumThreads(1);
+        }
+        session_ = runtime.createSession(config_.model_path, session_options,
+                                         GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
         
         // Get input/output info
         Ort::AllocatorWithDefaultOptions allocator;
@@ -88,7 +92,6 @@ bool VADDetector::initializeSession() {
 
 void VADDetector::cleanup() {
     session_.reset();
-    env_.reset();
     
     // Clear name vectors
     input_names_str_.clear();
@@ -99,18 +102,63 @@ void VADDetector::cleanup() {
     // Clear other vectors
     input_shapes_.clear();
     output_shapes_.clear();
-    state_h_.clear();
-    state_c_.clear();
-    context_.clear();
+    binding_.reset();
+    state_tensors_[0] = Ort::Value(nullptr);
+    state_tensors_[1] = Ort::Value(nullptr);
+    input_buffer_.clear();
+    state_[0].clear();
+    state_[1].clear();
     prob_history_.clear();
 }
 
 void VADDetector::reset() {
-    // Initialize states according to Silero VAD model
-    state_h_.assign(2 * 1 * 128, 0.0f); // (2, 1, 128)
-    state_c_.assign(2 * 1 * 128, 0.0f); // (2, 1, 128)
-    context_.assign(1 * config_.context_size, 0.0f); // (1, context_size)
+    // Sizes never change after the first reset, so bound tensors stay valid
+    input_buffer_.resize(config_.context_size + config_.window_size);
+    std::fill(input_buffer_.begin(), input_buffer_.end(), 0.0f);  // zero context
+    for (auto& state : state_) {
+        state.resize(2 * 1 * 128);  // (2, 1, 128) per Silero VAD
+        std::fill(state.begin(), state.end(), 0.0f);
+    }
+    current_state_ = 0;
+    prob_output_.assign(1, 0.0f);
     prob_history_.clear();
+    
+    if (config_.pre_gate) {
+        if (!gate_) {
+            gate_ = std::make_unique<EnergyGate>(config_.gate);
+        }
+        gate_->reset();
+        skipped_windows_.assign(static_cast<size_t>(std::max(0, config_.gate_replay_windows)) * config_.window_size, 0.0f);
+    }
+    skipped_run_ = 0;
+    last_prob_ = 0.0f;
+}
+
+void VADDetector::bindTensors() {
+    binding_ = std::make_unique<Ort::IoBinding>(*session_);
+    sample_rate_value_ = config_.sample_rate;
+    
+    const int64_t input_shape[] = {1, static_cast<int64_t>(input_buffer_.size())};
+    const int64_t sr_shape[] = {1};
+    const int64_t state_shape[] = {2, 1, 128};
+    const int64_t prob_shape[] = {1, 1};
+    
+    binding_->BindInput(input_names_[0], Ort::Value::CreateTensor<float>(
+        memory_info_, input_buffer_.data(), input_buffer_.size(), input_shape, 2));
+    binding_->BindInput(input_names_[2], Ort::Value::CreateTensor<int64_t>(
+        memory_info_, &sample_rate_value_, 1, sr_shape, 1));
+    binding_->BindOutput(output_names_[0], Ort::Value::CreateTensor<float>(
+        memory_info_, prob_output_.data(), prob_output_.size(), prob_shape, 2));
+    
+    for (int i = 0; i < 2; ++i) {
+        state_tensors_[i] = Ort::Value::CreateTensor<float>(
+            memory_info_, state_[i].data(), state_[i].size(), state_shape, 3);
+    }
+    
+    // Outputs beyond prob and state are not used; let ORT place them
+    for (size_t i = 2; i < output_names_.size(); ++i) {
+        binding_->BindOutput(output_names_[i], memory_info_);
+    }
 }
 
 float VADDetector::detectVAD(const std::vector<float>& audio) {
@@ -123,118 +171,91 @@ float VADDetector::detectVAD(const float* audio, size_t length) {
         return 0.0f;
     }
     
-    try {
-        // Prepare input data
-        std::vector<float> input_audio;
-        if (length != config_.window_size) {
-            // Resample or pad to correct size
-            input_audio.resize(config_.window_size);
-            if (length > config_.window_size) {
-                std::copy(audio, audio + config_.window_size, input_audio.begin());
-            } else {
-                std::copy(audio, audio + length, input_audio.begin());
-                std::fill(input_audio.begin() + length, input_audio.end(), 0.0f);
-            }
-        } else {
-            input_audio.assign(audio, audio + length);
+    const size_t window_size = config_.window_size;
+    size_t n = std::min(length, window_size);
+    windows_processed_++;
+    
+    float prob = 0.0f;
+    if (gate_ && !gate_->process(audio, n, last_prob_ >= config_.gate_speech_threshold)) {
+        // Clear silence: no inference, but keep the window in case the gate reopens next
+        windows_gated_++;
+        const size_t replay = skipped_windows_.size() / window_size;
+        if (replay > 0) {
+            float* slot = skipped_windows_.data() + (skipped_run_ % replay) * window_size;
+            std::copy(audio, audio + n, slot);
+            std::fill(slot + n, slot + window_size, 0.0f);
         }
+        skipped_run_++;
+    } else {
+        if (skipped_run_ > 0) {
+            resumeAfterGate();
+        }
+        prob = runModel(audio, n);
+        last_prob_ = prob;
+    }
+    
+    // Apply smoothing
+    prob_history_.push_back(prob);
+    if (prob_history_.size() > config_.history_size) {
+        prob_history_.pop_front();
+    }
+    
+    float smoothed_prob = std::accumulate(prob_history_.begin(), prob_history_.end(), 0.0f) / prob_history_.size();
+    
+    return smoothed_prob;
+}
+
+void VADDetector::resumeAfterGate() {
+    // A short gap is replayed in full, so the LSTM state is exactly the ungated one. After a
+    // longer gap the stale state is dropped and the model restarts as on a fresh stream,
+    // warmed up on the last skipped windows (silence by construction) before the current one.
+    const size_t window_size = config_.window_size;
+    const size_t replay = skipped_windows_.size() / window_size;
+    size_t first = 0;
+    if (skipped_run_ > replay) {
+        std::fill(input_buffer_.begin(), input_buffer_.end(), 0.0f);
+        for (auto& state : state_) {
+            std::fill(state.begin(), state.end(), 0.0f);
+        }
+        first = skipped_run_ - replay;
+    }
+    for (size_t i = first; i < skipped_run_; ++i) {
+        runModel(skipped_windows_.data() + (i % replay) * window_size, window_size);
+    }
+    skipped_run_ = 0;
+}
+
+float VADDetector::runModel(const float* audio, size_t length) {
+    try {
+        ScopedTimer timer(Metrics::Stage::VADWindow);
+        const size_t context_size = config_.context_size;
+        const size_t window_size = config_.window_size;
+        float* x = input_buffer_.data();
         
+        // The tail of the previous window becomes the context of this one
+        std::copy(x + window_size, x + window_size + context_size, x);
         
-        // Concatenate context and current audio
-        std::vector<float> x(config_.context_size + config_.window_size);
-        std::copy(context_.begin(), context_.end(), x.begin());
-        std::copy(input_audio.begin(), input_audio.end(), x.begin() + config_.context_size);
+        // Truncate or zero-pad the new audio to exactly one window
+        size_t n = std::min(length, window_size);
+        std::copy(audio, audio + n, x + context_size);
+        std::fill(x + context_size + n, x + context_size + window_size, 0.0f);
         
-        // Update context for next frame
-        if (x.size() >= config_.context_size) {
-            std::copy(x.end() - config_.context_size, x.end(), context_.begin());
+        // Read the current state, write the next one into the other buffer
+        int next_state = 1 - current_state_;
+        binding_->BindInput(input_names_[1], state_tensors_[current_state_]);
+        if (output_names_.size() > 1) {
+            binding_->BindOutput(output_names_[1], state_tensors_[next_state]);
         }
         
-        // Prepare input tensors
-        std::vector<int64_t> input_shape = {1, static_cast<int64_t>(x.size())};
-        std::vector<int64_t> sr_shape = {1};
-        std::vector<int64_t> state_shape = {2, 1, 128};
-        
-        std::vector<int64_t> sr_value = {config_.sample_rate};
-        
-        std::vector<Ort::Value> input_tensors;
-        input_tensors.push_back(Ort::Value::CreateTensor<float>(
-            memory_info_, x.data(), x.size(), input_shape.data(), input_shape.size()));
-        input_tensors.push_back(Ort::Value::CreateTensor<float>(
-            memory_info_, state_h_.data(), state_h_.size(), state_shape.data(), state_shape.size()));
-        input_tensors.push_back(Ort::Value::CreateTensor<int64_t>(
-            memory_info_, sr_value.data(), sr_value.size(), sr_shape.data(), sr_shape.size()));
-        
-        // Run inference
-        auto output_tensors = session_->Run(Ort::RunOptions{nullptr}, 
-                                          input_names_.data(), input_tensors.data(), input_tensors.size(),
-                                          output_names_.data(), output_names_.size());
-        
-        // Get probability result
-        float* prob_data = output_tensors[0].GetTensorMutableData<float>();
-        float prob = prob_data[0];
-        
-        // Update LSTM states (both h and c states)
-        if (output_tensors.size() > 2) {
-            // Update h state
-            float* new_state_h = output_tensors[1].GetTensorMutableData<float>();
-            std::copy(new_state_h, new_state_h + state_h_.size(), state_h_.begin());
-            
-            // Update c state
-            float* new_state_c = output_tensors[2].GetTensorMutableData<float>();
-            std::copy(new_state_c, new_state_c + state_c_.size(), state_c_.begin());
-        } else if (output_tensors.size() > 1) {
-            // Fallback: only update h state if c state not available
-            float* new_state_h = output_tensors[1].GetTensorMutableData<float>();
-            std::copy(new_state_h, new_state_h + state_h_.size(), state_h_.begin());
-        }
+        session_->Run(Ort::RunOptions{nullptr}, *binding_);
         
-        // Apply smoothing
-        prob_history_.push_back(prob);
-        if (prob_history_.size() > config_.history_size) {
-            prob_history_.pop_front();
+        if (output_names_.size() > 1) {
+            current_state_ = next_state;
         }
-        
-        float smoothed_prob = std::accumulate(prob_history_.begin(), prob_history_.end(), 0.0f) / prob_history_.size();
-        
-        return smoothed_prob;
+        return prob_output_[0];
         
     } catch (const std::exception& e) {
         std::cerr << "VAD inference error: " << e.what() << std::endl;
         return 0.0f;
     }
 }
-
-void VADDetector::resampleIfNeeded(const float* input, size_t input_length, 
-                                  std::vector<float>& output) {
-    // Simple resampling implementation
-    if (input_length == config_.window_size) {
-        output.assign(input, input + input_length);
-        return;
-    }
-    
-    output.resize(config_.window_size);
-    
-    if (input_length > config_.window_size) {
-        // Downsample by simple decimation
-        float ratio = static_cast<float>(input_length) / config_.window_size;
-        for (size_t i = 0; i < config_.window_size; ++i) {
-            size_t src_idx = static_cast<size_t>(i * ratio);
-            output[i] = input[src_idx];
-        }
-    } else {
-        // Upsample by linear interpolation
-        float ratio = static_cast<float>(input_length) / config_.window_size;
-        for (size_t i = 0; i < config_.window_size; ++i) {
-            float src_pos = i * ratio;
-            size_t src_idx = static_cast<size_t>(src_pos);
-            float frac = src_pos - src_idx;
-            
-            if (src_idx + 1 < input_length) {
-                output[i] = input[src_idx] * (1.0f - frac) + input[src_idx + 1] * frac;
-            } else {
-                output[i] = input[src_idx];
-            }
-        }
-    }
-}
\ No newline at end of file
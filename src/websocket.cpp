@@ -0,0 +1,431 @@
+#include "websocket.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t kMaxRequestHeadBytes = 16 * 1024;
+const char* kWebSocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// SHA-1 is only needed for the handshake's Sec-WebSocket-Accept
+std::string sha1(const std::string& input) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string message = input;
+    const uint64_t bit_length = static_cast<uint64_t>(input.size()) * 8;
+    message += static_cast<char>(0x80);
+    while (message.size() % 64 != 56) {
+        message += static_cast<char>(0);
+    }
+    for (int i = 7; i >= 0; --i) {
+        message += static_cast<char>((bit_length >> (i * 8)) & 0xFF);
+    }
+
+    auto rotl = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(message.data() + chunk + i * 4);
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    std::string digest;
+    for (uint32_t word : h) {
+        for (int i = 3; i >= 0; --i) {
+            digest += static_cast<char>((word >> (i * 8)) & 0xFF);
+        }
+    }
+    return digest;
+}
+
+std::string base64(const std::string& input) {
+    static const char* kAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string output;
+    size_t i = 0;
+    for (; i + 2 < input.size(); i += 3) {
+        uint32_t v = (uint32_t(uint8_t(input[i])) << 16) | (uint32_t(uint8_t(input[i + 1])) << 8) |
+                     uint32_t(uint8_t(input[i + 2]));
+        output += kAlphabet[(v >> 18) & 63];
+        output += kAlphabet[(v >> 12) & 63];
+        output += kAlphabet[(v >> 6) & 63];
+        output += kAlphabet[v & 63];
+    }
+    if (i < input.size()) {
+        uint32_t v = uint32_t(uint8_t(input[i])) << 16;
+        if (i + 1 < input.size()) {
+            v |= uint32_t(uint8_t(input[i + 1])) << 8;
+        }
+        output += kAlphabet[(v >> 18) & 63];
+        output += kAlphabet[(v >> 12) & 63];
+        output += i + 1 < input.size() ? kAlphabet[(v >> 6) & 63] : '=';
+        output += '=';
+    }
+    return output;
+}
+
+std::string toLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+std::string percentDecode(const std::string& text) {
+    std::string output;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '%' && i + 2 < text.size() && std::isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            output += static_cast<char>(std::stoi(text.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            output += text[i] == '+' ? ' ' : text[i];
+        }
+    }
+    return output;
+}
+
+}  // namespace
+
+std::string HttpRequest::header(const std::string& name) const {
+    auto it = headers.find(toLower(name));
+    return it != headers.end() ? it->second : "";
+}
+
+std::string HttpRequest::queryParam(const std::string& name, const std::string& fallback) const {
+    auto it = query.find(name);
+    return it != query.end() ? it->second : fallback;
+}
+
+bool HttpRequest::isWebSocketUpgrade() const {
+    return method == "GET" && toLower(header("upgrade")).find("websocket") != std::string::npos &&
+           toLower(header("connection")).find("upgrade") != std::string::npos &&
+           !header("sec-websocket-key").empty();
+}
+
+WebSocketConnection::WebSocketConnection(int fd, size_t max_message_bytes)
+    : fd_(fd), max_message_bytes_(max_message_bytes), open_(fd >= 0) {
+}
+
+WebSocketConnection::~WebSocketConnection() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void WebSocketConnection::setTimeouts(int receive_ms, int send_ms) {
+    struct timeval receive = {receive_ms / 1000, (receive_ms % 1000) * 1000};
+    struct timeval send = {send_ms / 1000, (send_ms % 1000) * 1000};
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &receive, sizeof(receive));
+    setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &send, sizeof(send));
+}
+
+bool WebSocketConnection::readRequest(HttpRequest& request) {
+    // Read until the blank line; anything after it stays buffered for the frame reader
+    size_t head_end = std::string::npos;
+    char chunk[4096];
+    while ((head_end = read_buffer_.find("\r\n\r\n")) == std::string::npos) {
+        if (read_buffer_.size() > kMaxRequestHeadBytes) {
+            return false;
+        }
+        ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+        if (n <= 0) {
+            return false;
+        }
+        read_buffer_.append(chunk, static_cast<size_t>(n));
+    }
+
+    std::istringstream head(read_buffer_.substr(0, head_end));
+    read_offset_ = head_end + 4;
+
+    std::string line;
+    std::getline(head, line);
+    std::istringstream request_line(trim(line));
+    std::string target, version;
+    request_line >> request.method >> target >> version;
+    if (request.method.empty() || target.empty()) {
+        return false;
+    }
+
+    size_t question = target.find('?');
+    request.path = percentDecode(target.substr(0, question));
+    if (question != std::string::npos) {
+        std::istringstream query(target.substr(question + 1));
+        std::string pair;
+        while (std::getline(query, pair, '&')) {
+            size_t equals = pair.find('=');
+            std::string key = percentDecode(pair.substr(0, equals));
+            std::string value = equals != std::string::npos ? percentDecode(pair.substr(equals + 1)) : "";
+            if (!key.empty()) {
+                request.query[key] = value;
+            }
+        }
+    }
+
+    while (std::getline(head, line)) {
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            request.headers[toLower(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+        }
+    }
+    return true;
+}
+
+bool WebSocketConnection::sendHttpResponse(int status, const std::string& reason, const std::string& content_type,
+                                           const std::string& body) {
+    std::ostringstream response;
+    response << "HTTP/1.1 " << status << " " << reason << "\r\n"
+             << "Content-Type: " << content_type << "\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << body;
+    std::string text = response.str();
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    bool sent = sendAll(text.data(), text.size());
+    open_.store(false);
+    return sent;
+}
+
+bool WebSocketConnection::acceptUpgrade(const HttpRequest& request) {
+    if (!request.isWebSocketUpgrade() || request.header("sec-websocket-version") != "13") {
+        sendHttpResponse(400, "Bad Request", "text/plain", "WebSocket upgrade required\n");
+        return false;
+    }
+
+    std::string accept = base64(sha1(request.header("sec-websocket-key") + kWebSocketGuid));
+    std::string response = "HTTP/1.1 101 Switching Protocols\r\n"
+                           "Upgrade: websocket\r\n"
+                           "Connection: Upgrade\r\n"
+                           "Sec-WebSocket-Accept: " + accept + "\r\n\r\n";
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    return sendAll(response.data(), response.size());
+}
+
+bool WebSocketConnection::waitReadable(int timeout_ms) {
+    if (read_offset_ < read_buffer_.size()) {
+        return true;
+    }
+    struct pollfd pfd = {fd_, POLLIN, 0};
+    return poll(&pfd, 1, timeout_ms) > 0;
+}
+
+bool WebSocketConnection::readExact(void* data, size_t length) {
+    char* out = static_cast<char*>(data);
+    size_t buffered = std::min(length, read_buffer_.size() - read_offset_);
+    std::memcpy(out, read_buffer_.data() + read_offset_, buffered);
+    read_offset_ += buffered;
+    if (read_offset_ == read_buffer_.size()) {
+        read_buffer_.clear();
+        read_offset_ = 0;
+    }
+
+    size_t done = buffered;
+    while (done < length) {
+        ssize_t n = recv(fd_, out + done, length - done, 0);
+        if (n <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+WebSocketConnection::ReadStatus WebSocketConnection::readMessage(Message& message) {
+    message.payload.clear();
+    bool in_message = false;
+
+    while (true) {
+        uint8_t header[2];
+        if (!readExact(header, 2)) {
+            open_.store(false);
+            return ReadStatus::Closed;
+        }
+        const bool fin = (header[0] & 0x80) != 0;
+        const Opcode opcode = static_cast<Opcode>(header[0] & 0x0F);
+        const bool masked = (header[1] & 0x80) != 0;
+        uint64_t length = header[1] & 0x7F;
+
+        if (length == 126) {
+            uint8_t ext[2];
+            if (!readExact(ext, 2)) {
+                return ReadStatus::Error;
+            }
+            length = (uint64_t(ext[0]) << 8) | ext[1];
+        } else if (length == 127) {
+            uint8_t ext[8];
+            if (!readExact(ext, 8)) {
+                return ReadStatus::Error;
+            }
+            length = 0;
+            for (uint8_t byte : ext) {
+                length = (length << 8) | byte;
+            }
+            // The most significant bit of a 64-bit length must be 0 (RFC 6455 5.2)
+            if (length >> 63) {
+                close(1002, "bad frame length");
+                return ReadStatus::Error;
+            }
+        }
+
+        // Clients must mask every frame (RFC 6455 5.1)
+        if (!masked) {
+            close(1002, "unmasked frame");
+            return ReadStatus::Error;
+        }
+        const bool control = (static_cast<uint8_t>(opcode) & 0x08) != 0;
+        if (control && (length > 125 || !fin)) {
+            close(1002, "bad control frame");
+            return ReadStatus::Error;
+        }
+        // Compared against the remaining budget so a huge client length cannot wrap the sum
+        if (!control && (message.payload.size() > max_message_bytes_ ||
+                         length > max_message_bytes_ - message.payload.size())) {
+            return ReadStatus::TooBig;
+        }
+
+        uint8_t mask[4];
+        if (!readExact(mask, 4)) {
+            return ReadStatus::Error;
+        }
+        std::string payload(static_cast<size_t>(length), '\0');
+        if (length > 0 && !readExact(&payload[0], payload.size())) {
+            return ReadStatus::Error;
+        }
+        for (size_t i = 0; i < payload.size(); ++i) {
+            payload[i] = static_cast<char>(payload[i] ^ mask[i % 4]);
+        }
+
+        if (opcode == Opcode::Ping) {
+            std::lock_guard<std::mutex> lock(send_mutex_);
+            sendFrame(Opcode::Pong, payload.data(), payload.size());
+            continue;
+        }
+        if (opcode == Opcode::Pong) {
+            continue;
+        }
+        if (opcode == Opcode::Close) {
+            close(1000);
+            return ReadStatus::Closed;
+        }
+
+        if (opcode == Opcode::Continuation) {
+            if (!in_message) {
+                close(1002, "unexpected continuation");
+                return ReadStatus::Error;
+            }
+        } else {
+            if (in_message) {
+                close(1002, "interleaved message");
+                return ReadStatus::Error;
+            }
+            message.opcode = opcode;
+            in_message = true;
+        }
+        message.payload += payload;
+        if (fin) {
+            return ReadStatus::Message;
+        }
+    }
+}
+
+bool WebSocketConnection::sendAll(const char* data, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = send(fd_, data + done, length - done, MSG_NOSIGNAL);
+        if (n <= 0) {
+            open_.store(false);
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool WebSocketConnection::sendFrame(Opcode opcode, const char* data, size_t length) {
+    std::string frame;
+    frame.reserve(length + 10);
+    frame += static_cast<char>(0x80 | static_cast<uint8_t>(opcode));
+    if (length < 126) {
+        frame += static_cast<char>(length);
+    } else if (length <= 0xFFFF) {
+        frame += static_cast<char>(126);
+        frame += static_cast<char>((length >> 8) & 0xFF);
+        frame += static_cast<char>(length & 0xFF);
+    } else {
+        frame += static_cast<char>(127);
+        for (int i = 7; i >= 0; --i) {
+            frame += static_cast<char>((static_cast<uint64_t>(length) >> (i * 8)) & 0xFF);
+        }
+    }
+    frame.append(data, length);
+    return sendAll(frame.data(), frame.size());
+}
+
+bool WebSocketConnection::sendText(const std::string& text) {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    return open_.load() && sendFrame(Opcode::Text, text.data(), text.size());
+}
+
+bool WebSocketConnection::sendBinary(const void* data, size_t length) {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    return open_.load() && sendFrame(Opcode::Binary, static_cast<const char*>(data), length);
+}
+
+void WebSocketConnection::close(uint16_t code, const std::string& reason) {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    if (!open_.load()) {
+        return;
+    }
+    std::string payload;
+    payload += static_cast<char>((code >> 8) & 0xFF);
+    payload += static_cast<char>(code & 0xFF);
+    payload += reason.substr(0, 123);
+    sendFrame(Opcode::Close, payload.data(), payload.size());
+    open_.store(false);
+    shutdown(fd_, SHUT_WR);
+}